@@ -1,16 +1,16 @@
-C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.YEX: C1.OBJ ecu.OBJ r_can_api.OBJ rtc.OBJ sci.OBJ main.OBJ timer.OBJ r_Flash_API_RX600.OBJ usb.OBJ flash_data.OBJ uSD_rspi1.OBJ can3_spi2.OBJ obd2.OBJ reprogram.OBJ flash_rom.OBJ cantp.OBJ uds.OBJ 
+C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.YEX: C1.OBJ ecu.OBJ r_can_api.OBJ rtc.OBJ sci.OBJ main.OBJ timer.OBJ r_Flash_API_RX600.OBJ usb.OBJ flash_data.OBJ uSD_rspi1.OBJ can3_spi2.OBJ obd2.OBJ reprogram.OBJ flash_rom.OBJ cantp.OBJ uds.OBJ trace.OBJ 
 	YLINK @C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.res
 C1.OBJ: C1.C
 	YCRX /i /o /p /b /m /c /R /W /K  /u C1.C
-ecu.OBJ: ecu.c altypes.h iodefine.h timer.h sci.h ecu.h usb.h r_can_api.h config_r_can_rapi.h flash_data.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h memo.h ecu_io.h can3_spi2.h uSD_rspi1.h cantp.h ecu_def_config.h 
+ecu.OBJ: ecu.c altypes.h iodefine.h timer.h sci.h ecu.h usb.h r_can_api.h config_r_can_rapi.h flash_data.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h memo.h ecu_io.h can3_spi2.h uSD_rspi1.h cantp.h uds.h ecu_def_config.h trace.h 
 	YCRX /i /o /p /b /m /c /R /W /K  ecu.c
-r_can_api.OBJ: r_can_api.c altypes.h iodefine.h config_r_can_rapi.h r_can_api.h libs.h ecu.h timer.h cantp.h 
+r_can_api.OBJ: r_can_api.c altypes.h iodefine.h config_r_can_rapi.h r_can_api.h libs.h ecu.h timer.h cantp.h trace.h 
 	YCRX /i /o /p /b /m /c /R /W /K  r_can_api.c
 rtc.OBJ: rtc.c iodefine.h macros.h altypes.h libs.h cmnsys.h rtc.h timer.h 
 	YCRX /i /o /p /b /m /c /R /W /K  rtc.c
-sci.OBJ: sci.c iodefine.h ecu.h sci.h 
+sci.OBJ: sci.c iodefine.h ecu.h sci.h trace.h 
 	YCRX /i /o /p /b /m /c /R /W /K  sci.c
-main.OBJ: main.c altypes.h iodefine.h sci.h ecu.h rtc.h timer.h flash_data.h flash_rom.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h usb.h can3_spi2.h uSD_rspi1.h cantp.h uds.h 
+main.OBJ: main.c altypes.h iodefine.h sci.h ecu.h rtc.h timer.h flash_data.h flash_rom.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h usb.h can3_spi2.h uSD_rspi1.h cantp.h uds.h obd2.h trace.h 
 	YCRX /i /o /p /b /m /c /R /W /K  main.c
 timer.OBJ: timer.c iodefine.h timer.h 
 	YCRX /i /o /p /b /m /c /R /W /K  timer.c
@@ -22,15 +22,17 @@ flash_data.OBJ: flash_data.c altypes.h iodefine.h flash_data.h r_Flash_API_RX600
 	YCRX /i /o /p /b /m /c /R /W /K  flash_data.c
 uSD_rspi1.OBJ: uSD_rspi1.c iodefine.h ecu.h uSD_rspi1.h 
 	YCRX /i /o /p /b /m /c /R /W /K  uSD_rspi1.c
-can3_spi2.OBJ: can3_spi2.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h 
+can3_spi2.OBJ: can3_spi2.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h trace.h 
 	YCRX /i /o /p /b /m /c /R /W /K  can3_spi2.c
-obd2.OBJ: obd2.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h obd2.h 
+obd2.OBJ: obd2.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h uds.h obd2.h altypes.h r_flash_api_rx600_config.h mcu_info.h r_flash_api_rx600.h r_flash_api_rx600_private.h flash_data.h 
 	YCRX /i /o /p /b /m /c /R /W /K  obd2.c
-reprogram.OBJ: reprogram.c iodefine.h altypes.h timer.h flash_data.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h flash_rom.h ecu.h can3_spi2.h 
+reprogram.OBJ: reprogram.c iodefine.h altypes.h timer.h flash_data.h r_Flash_API_RX600.h mcu_info.h r_flash_api_rx600_config.h flash_rom.h ecu.h can3_spi2.h cantp.h uds.h 
 	YCRX /i /o /p /b /m /c /R /W /K  reprogram.c
 flash_rom.OBJ: flash_rom.c iodefine.h timer.h flash_rom.h 
 	YCRX /i /o /p /b /m /c /R /W /K  flash_rom.c
 cantp.OBJ: cantp.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h obd2.h uds.h 
 	YCRX /i /o /p /b /m /c /R /W /K  cantp.c
-uds.OBJ: uds.c iodefine.h timer.h ecu.h can3_spi2.h cantp.h uds.h altypes.h r_flash_api_rx600_config.h mcu_info.h r_flash_api_rx600.h r_flash_api_rx600_private.h 
+uds.OBJ: uds.c iodefine.h timer.h ecu.h ecu_io.h can3_spi2.h cantp.h uds.h altypes.h r_flash_api_rx600_config.h mcu_info.h r_flash_api_rx600.h r_flash_api_rx600_private.h flash_data.h obd2.h 
 	YCRX /i /o /p /b /m /c /R /W /K  uds.c
+trace.OBJ: trace.c iodefine.h timer.h sci.h trace.h 
+	YCRX /i /o /p /b /m /c /R /W /K  trace.c
@@ -1 +1 @@
-/O:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.YEX /M:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.MAP /A:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.DEF /SE /OF:E /YU  C1.OBJ ecu.OBJ r_can_api.OBJ rtc.OBJ sci.OBJ main.OBJ timer.OBJ r_Flash_API_RX600.OBJ usb.OBJ flash_data.OBJ uSD_rspi1.OBJ can3_spi2.OBJ obd2.OBJ reprogram.OBJ flash_rom.OBJ cantp.OBJ uds.OBJ C:\YellowIDE7\LIB\RX\LITTLE\LRX.LIB
\ No newline at end of file
+/O:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.YEX /M:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.MAP /A:C:\Users\yamagami20\Downloads\PASTA1.0-master_20220608A\ecu-fw\CAN2ECU.DEF /SE /OF:E /YU  C1.OBJ ecu.OBJ r_can_api.OBJ rtc.OBJ sci.OBJ main.OBJ timer.OBJ r_Flash_API_RX600.OBJ usb.OBJ flash_data.OBJ uSD_rspi1.OBJ can3_spi2.OBJ obd2.OBJ reprogram.OBJ flash_rom.OBJ cantp.OBJ uds.OBJ trace.OBJ C:\YellowIDE7\LIB\RX\LITTLE\LRX.LIB
\ No newline at end of file
@@ -45,6 +45,7 @@
 #include "ecu.h"       // ECU common definition 
 #include "can3_spi2.h" // CAN3 definition 
 #include "cantp.h"     // CAN-TP definition 
+#include "trace.h"     // Event trace 
 
 // Enable if usage of mailbox is fixed 
 #define MB_LOCKED_TYPE
@@ -798,7 +799,7 @@ void interrupt __vectno__ {VECT_RSPI2_SPTI2} RSPI2_SPTI2_ISR(void)
 void interrupt __vectno__ {VECT_RSPI2_SPII2} RSPI2_SPII2_ISR(void)
 {
     RSPI2.SPCR2.BIT.SPIIE = 0; // 0:Disable generation of idle interrupt request 
-    logging("IDLE\r");
+    TRACE(TRC_SPI_IDLE, 2, 0);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -917,7 +918,7 @@ void CAN3_CallbackTxSet0(MCP2515REG_TXBUF *rxd)
         tx_act[0]        = 2;
         CAN3_TX0RTS_PORT = 1; // TX0 transmit request 
     } else {
-        logging("CAN3 TX0-Readback Error\r");
+        TRACE(TRC_CAN3_RDBK, 0, 0);
         can3_request(MCP2515CMD_WRITE, MCP2515AD_TXB0CTRL, 7, 0, 0, &mcp_txb[0]);
         can3_request(MCP2515CMD_READ , MCP2515AD_TXB0CTRL, 0, 7, CAN3_CallbackTxSet0, 0);
     }
@@ -929,7 +930,7 @@ void CAN3_CallbackTxSet1(MCP2515REG_TXBUF *rxd)
         tx_act[1]        = 2;
         CAN3_TX1RTS_PORT = 1; // TX1 transmit request 
     } else {
-        logging("CAN3 TX1-Readback Error\r");
+        TRACE(TRC_CAN3_RDBK, 1, 0);
         can3_request(MCP2515CMD_WRITE, MCP2515AD_TXB1CTRL, 7, 0, 0, &mcp_txb[1]);
         can3_request(MCP2515CMD_READ , MCP2515AD_TXB1CTRL, 0, 7, CAN3_CallbackTxSet1, 0);
     }
@@ -941,7 +942,7 @@ void CAN3_CallbackTxSet2(MCP2515REG_TXBUF *rxd)
         tx_act[2]        = 2;
         CAN3_TX2RTS_PORT = 1; // TX2 transmit request 
     } else {
-        logging("CAN3 TX2-Readback Error\r");
+        TRACE(TRC_CAN3_RDBK, 2, 0);
         can3_request(MCP2515CMD_WRITE, MCP2515AD_TXB2CTRL, 7, 0, 0, &mcp_txb[2]);
         can3_request(MCP2515CMD_READ , MCP2515AD_TXB2CTRL, 0, 7, CAN3_CallbackTxSet2, 0);
     }
@@ -962,7 +963,7 @@ int CAN3_GetTxMCTL(int mb)
     }
     if (tx_act_timer[0] == 0) {
         tx_act[0] = 0;
-        logging("CAN3 TXMB0:Timeout\r");
+        TRACE(TRC_CAN3_TMO, 0, 0);
         return 0;   // Timeout free 
     }
 #else // ifdef  MB_USED_ONLYONE
@@ -1256,7 +1257,7 @@ void can3_sts_event(MCP2515REG_INTERR *rxd)
     }
 
     if (rxd->BYTE.CANINTF.BIT.ERRIF) { // Error interrupt 
-        logging("CAN3:Error %02X\r", (int)rxd->BYTE.EFLG.BYTE);
+        TRACE(TRC_CAN3_ERR, rxd->BYTE.EFLG.BYTE, 0);
         ec.BYTE.MSK.BYTE = rxd->BYTE.EFLG.BYTE;
         ec.BYTE.PAT.BYTE = 0;
         can3_request(
@@ -1267,10 +1268,10 @@ void can3_sts_event(MCP2515REG_INTERR *rxd)
     }
 
     if (rxd->BYTE.CANINTF.BIT.WAKIF) { // Wakeup interrupt 
-        logging("CAN3:Wakeup\r");
+        TRACE(TRC_CAN3_WAKE, 0, 0);
     }
     if (rxd->BYTE.CANINTF.BIT.MERRF) { // Message error interrupt 
-        logging("CAN3:MsgErr\r");
+        TRACE(TRC_CAN3_MERR, 0, 0);
     }
 
     can3_request(
@@ -102,6 +102,17 @@ CAN_TP_PACK tp_pack;         // TP control variable
 void can_tp_init(void)
 {
     memset(&tp_pack, 0, sizeof(CAN_TP_PACK));
+    tp_pack.TXP = tp_pack.TXD.BUF;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * CAN-TP prepared response handover
+ *  The response data is sent directly from 'dp' instead of TXD.BUF (no copy).
+ *  The data must not change until the transmission is completed.
+ * ---------------------------------------------------------------------------------------- */
+void can_tp_handoff(unsigned char *dp)
+{
+    tp_pack.TXP = dp;
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -117,6 +128,7 @@ int can_tp_build(unsigned char *dp, int sz)
             tp_pack.RXD.BUF[tp_pack.RXD.WPOS++] = *dp++;
         }
         if (tp_pack.RXD.WPOS == tp_pack.SIZE) { // All data reception completed 
+            tp_pack.TXP = tp_pack.TXD.BUF; // Default response buffer 
             if (tp_pack.RXD.BUF[0] < 0x10) {    // OBD2 protocol 
                 f = obd2_job(tp_pack.RXD.BUF, tp_pack.RXD.WPOS, tp_pack.TXD.BUF);
             } else {  // UDS protocol 
@@ -179,7 +191,7 @@ int can_tp_send(void)
         }
         // Data copy 
         for (i = 0; i < sz && tp_pack.TXD.RPOS < tp_pack.TXD.WPOS; i++) {
-            *dp++ = tp_pack.TXD.BUF[tp_pack.TXD.RPOS++];
+            *dp++ = tp_pack.TXP[tp_pack.TXD.RPOS++];
         }
         if (tp_pack.TXD.RPOS == tp_pack.SIZE) {  // All data transmission completed 
             tp_pack.MODE = 0;
@@ -248,6 +260,7 @@ void can_tp_consecutive(void)
     }
     if (f != 0) { // Reply 
         memcpy(&can_buf.ID[id], tp_pack.TXF.B, 8);
+        CANID_DIRTY(id);
         add_mbox_frame(tp_pack.CH, 8, CAN_DATA_FRAME, id);   // Stack buffer for transmission 
     }
 }
@@ -282,6 +295,37 @@ void can_tp_txecheck(int ch, int id)
     }
 }
 
+/* ----------------------------------------------------------------------------------------
+ * CAN-TP deferred response transmission (call from main)
+ * ---------------------------------------------------------------------------------------- */
+int can_tp_response(unsigned char *dp, int sz)
+{
+    int id = SELECT_ECU_UNIT + 0x7E8;
+
+    if (tp_pack.MODE != 0) { // Transmitting, retry later 
+        return 0;
+    }
+    if (sz <= 0 || sz > CAN_TP_MAX_BUF) {
+        return -1;
+    }
+    if (dp != tp_pack.TXD.BUF) { // Built elsewhere 
+        memcpy(tp_pack.TXD.BUF, dp, sz);
+    }
+    tp_pack.TXP         = tp_pack.TXD.BUF;
+    tp_pack.TXD.RPOS    = 0;
+    tp_pack.TXD.WPOS    = sz;
+    if (can_tp_send() == 0) {
+        return -1;
+    }
+    tp_pack.TXID = id;
+    memcpy(&can_buf.ID[id], tp_pack.TXF.B, 8);
+    CANID_DIRTY(id);
+    if (tp_pack.CH >= 0) {
+        add_mbox_frame(tp_pack.CH, 8, CAN_DATA_FRAME, id); // Stack buffer for transmission 
+    }
+    return sz;
+}
+
 /* ----------------------------------------------------------------------------------------
  * CAN-TP processing
  * ---------------------------------------------------------------------------------------- */
@@ -414,6 +458,7 @@ int can_tp_job(int ch, int id, void *frame)
         sw              += 8;
         tp_pack.TXID    = sw;
         memcpy(&can_buf.ID[sw], tp_pack.TXF.B, 8);
+        CANID_DIRTY(sw);
         if (ch >= 0) {
             add_mbox_frame(ch, 8, CAN_DATA_FRAME, sw); // Stack buffer for transmission 
         }
@@ -223,6 +223,7 @@ typedef struct  __can_tp_packet__ {
     CAN_TP_FRAME TXF;   // Transmit frame 
     CAN_TP_BUF   RXD;   // Receive buffer 
     CAN_TP_BUF   TXD;   // Transmit buffer 
+    unsigned char * TXP; // Transmit data (TXD.BUF or a prepared response handed over by can_tp_handoff) 
 }   CAN_TP_PACK;
 
 extern CAN_TP_PACK tp_pack;         // TP control variable 
@@ -251,6 +252,14 @@ extern void can_tp_txendreq(void);
  * CAN-TP transmission completion wait release check
  * ---------------------------------------------------------------------------------------- */
 extern void can_tp_txecheck(int ch, int id);
+/* ----------------------------------------------------------------------------------------
+ * CAN-TP deferred response transmission
+ * ---------------------------------------------------------------------------------------- */
+extern int can_tp_response(unsigned char *dp, int sz);
+/* ----------------------------------------------------------------------------------------
+ * CAN-TP prepared response handover (call from the upper layer job)
+ * ---------------------------------------------------------------------------------------- */
+extern void can_tp_handoff(unsigned char *dp);
 /* ----------------------------------------------------------------------------------------
  * CAN-TP processing
  * ---------------------------------------------------------------------------------------- */
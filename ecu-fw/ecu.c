@@ -58,6 +58,8 @@
 #include "can3_spi2.h"
 #include "uSD_rspi1.h"
 #include "cantp.h"  // CAN-TP definition 
+#include "uds.h"    // CAN-UDS definition 
+#include "trace.h"  // Event trace 
 
 // Built-in initial value setting header 
 #include "ecu_def_config.h"
@@ -100,6 +102,11 @@ int status_timer;
 void logging(char *fmt, ...);
 void SendPC(char *msg);
 
+// Checklist index 
+void extern_io_index(unsigned char *ofs, unsigned char *slot, int max, int key);
+void extern_io_set(unsigned long *set, const short *tbl, int stop);
+void extern_io_mode(int mode);
+
 // CAN module list (CH0 to 3) 
 extern const can_st_ptr CAN_CHANNELS[];
 
@@ -107,6 +114,18 @@ extern const can_st_ptr CAN_CHANNELS[];
 EXT_IO_STATUS exiosts;
 unsigned char exio_chg[EX_IO_MAX];
 int           exio_chg_mark;
+// extern_io_update_ex update requests and checklist index 
+unsigned long exio_dirty[(EX_IO_MAX + 31) / 32];
+unsigned long canid_dirty[CAN_ID_MAX / 32];
+unsigned long canid_dirty_sum[(CAN_ID_MAX / 32 + 31) / 32];
+int           ext_rescan = 1;
+unsigned char ext_nm_ofs[EX_IO_MAX + 1];    // Entries of the I/O number n : ext_nm_slot[ofs[n]..ofs[n+1]-1] 
+unsigned char ext_nm_slot[ECU_EXT_MAX];
+unsigned char ext_id_ofs[CAN_ID_MAX + 1];   // Entries of the CAN-ID n : ext_id_slot[ofs[n]..ofs[n+1]-1] 
+unsigned char ext_id_slot[ECU_EXT_MAX];
+unsigned long ext_mode_set[ECU_OPMODE_MAX][(ECU_EXT_MAX + 31) / 32];  // Entries switched to CAN output by the mode 
+unsigned long ext_mode_clr[ECU_OPMODE_MAX][(ECU_EXT_MAX + 31) / 32];  // Entries switched to ECU input by the mode 
+EXT_IO_OP     ext_op[ECU_EXT_MAX];          // Compiled checklist 
 char		  exio_bridge[EX_IO_MAX];
 // Automatic brake control
 int aebs_active = 0;
@@ -124,6 +143,18 @@ int stat_comm = 1;       // Communication port number 0 to 6 to notify LCD
 #else
 int stat_comm = 0;       // Communication port number 0 to 6 to notify LCD 
 #endif
+char stat_line[128];     // Status line being transmitted 
+int stat_line_len   = 0; // Status line bytes 
+int stat_line_pos   = 0; // Status line bytes written (resume position) 
+char stat_dump      = 0; // Parameter dump in progress (L / W / S, 0=None) 
+int stat_dump_pos   = 0; // Parameter dump position (resumed by ecu_status_job) 
+int stat_dump_port  = 0; // Parameter dump port (reply port of the command) 
+char stat_dump_line[ECU_DUMP_LINE]; // Parameter dump line waiting for the transmission buffer 
+int stat_dump_len   = 0; // Parameter dump line bytes (0=Not built) 
+int stat_bin        = 0; // Status notification format 0:EXU text 1:Binary delta stream 
+int stat_key        = 0; // Binary stream keyframe in progress 
+unsigned char stat_seq  = 0;            // Binary stream frame sequence 
+unsigned long stat_sent[EX_IO_MAX];     // Binary stream value last sent (delta base) 
 int ds_x_lost_counter   = 0;  // Driving simulator competition end detection counter 
 
 //	DS operaion mode
@@ -466,7 +497,7 @@ void can_tx_mb(int ch, int mb)
                     send_msg[ch].BOX[mb].CNT--;
                     act->ID.LONG = 0;       // Delete 
                 } else { // Error occurred 
-                    logging("CAN_TxSet Err = %08lX\r",lwk);
+                    TRACE(TRC_CAN_TXERR, lwk, (ch << 8) | mb);
                 }
             } else { // Chain error 
                 send_msg[ch].BOX[mb].WP  =  0;
@@ -615,7 +646,6 @@ int can_recv_frame(int ch, CAN_MBOX *mbox)
     unsigned char txmsk; // Channel transmission mask 
     unsigned char cgw;   // Transfer flag 
     unsigned char c1, c2, c3; // Counter 
-    static	 char s[16];
 
     id = mbox->ID.BIT.SID;
 
@@ -778,138 +808,7 @@ int can_recv_frame(int ch, CAN_MBOX *mbox)
 	        		}
 	        	}
 	        }
-	        // CARLA DS switch
-			if(ds_conect_active[0] != ds_conect_active[1])
-			{ // DS Switching
-				ds_conect_active[0] = ds_conect_active[1];
-				ecu_opmode.mode = ds_conect_active[1];
-	        //	if(ecu_opmode.mode_bk != ecu_opmode.mode)
-	        	{	//	mode chainge
-	        		ecu_opmode.mode_bk = ecu_opmode.mode;
-					memset(exio_bridge, 0, sizeof(exio_bridge));
-					sprintf(s, "MOD%d\r", ecu_opmode.mode);
-					sci_puts(0, s);
-					switch(ecu_opmode.mode)
-					{
-					//----------------------------------------
-					case ECU_OPMODE_0:	//	PASTA
-						switch(SELECT_ECU_UNIT)
-						{
-						case ECU_UNIT_POWERTRAIN:
-							for(j = 0; CARLA_POWERTRAIN_SEND_ID[j] != 0 && j < 27; j++)
-							{
-								i = can_to_exio[CARLA_POWERTRAIN_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE &= 3;	//	CAN output -> ECU input
-								} else break;
-							}
-							break;
-						case ECU_UNIT_CHASSIS:
-							for(j = 0; CARLA_CHASSIS_SEND_ID[j] != 0 && j < 15; j++)
-							{
-								i = can_to_exio[CARLA_CHASSIS_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE &= 3;	//	CAN output -> ECU input
-								}
-								else break;
-							}
-							break;
-						case ECU_UNIT_BODY:
-							for(j = 0; CARLA_BODY_SEND_ID[j] != 0 && j < 22; j++)
-							{
-								i = can_to_exio[CARLA_BODY_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE &= 3;	//	CAN output -> ECU input
-								}
-							}
-							break;
-						case ECU_UNIT_PTBD:
-							for(j = 0; CARLA_PTBD_SEND_ID[j] != 0 && j < 49; j++)
-							{
-								i = can_to_exio[CARLA_PTBD_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE &= 3;	//	CAN output -> ECU input
-								}
-							}
-							break;
-						}
-						break;
-					//----------------------------------------
-					case ECU_OPMODE_1:	//	PASTA.Chassis.COM0 -> CAN -> CARLA -> CAN -> PASTA.Powertrain.COM0
-						switch(SELECT_ECU_UNIT)
-						{
-						case ECU_UNIT_POWERTRAIN:
-							for(j = 0; CARLA_POWERTRAIN_SEND_ID[j] != 0 && j < 27; j++)
-							{
-								i = can_to_exio[CARLA_POWERTRAIN_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE |= 4;	//	ECU input -> CAN output
-								}
-								else break;
-							}
-							break;
-						case ECU_UNIT_CHASSIS:
-							for(j = 0; CARLA_CHASSIS_SEND_ID[j] != 0 && j < 15; j++)
-							{
-								i = can_to_exio[CARLA_CHASSIS_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE &= 3;	//	CAN output -> ECU input
-								}
-							}
-							break;
-						case ECU_UNIT_BODY:
-							for(j = 0; CARLA_BODY_SEND_ID[j] != 0 && j < 22; j++)
-							{
-								i = can_to_exio[CARLA_BODY_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE |= 4;	//	ECU input -> CAN output
-								}
-								else break;
-							}
-							break;
-						case ECU_UNIT_PTBD:
-							for(j = 0; CARLA_PTBD_SEND_ID[j] != 0 && j < 49; j++)
-							{
-								i = can_to_exio[CARLA_PTBD_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE |= 4;	//	ECU input -> CAN output
-								}
-								else break;
-							}
-							break;
-						}
-						break;
-
-					//----------------------------------------
-					case ECU_OPMODE_5:	//	PASTA.Chassis.COM0 -> ECU.CS -> CAN -> CARLA.Phase1 -> CAN -> EUC.CS -> PASTA.Chassis.COM0
-						switch(SELECT_ECU_UNIT)
-						{
-						case ECU_UNIT_POWERTRAIN:
-							can_buf.ID[VI_POWERTRAIN_SWID].BYTE[0] |= 0x80;
-							for(j = 0; VI_POWERTRAIN_SEND_ID[j] != 0 && j < 27; j++)
-							{
-								i = can_to_exio[VI_POWERTRAIN_SEND_ID[j]];
-								if(i < EX_IO_MAX)
-								{
-									ext_list[i].PORT.BIT.MODE |= 4;	//	ECU input -> CAN output
-								}
-								else break;
-							}
-							break;
-						}
-						break;
-					}
-				}
-	            return 0;
-			}
+	        // CARLA DS switch : ds_conect_active[1] is applied by ecu_mode_job
 			if(SELECT_ECU_UNIT == ECU_UNIT_POWERTRAIN && ds_conect_active[0] >= ECU_OPMODE_5 && id == VI_POWERTRAIN_SWID)
 			{
 				data.BYTE[0] |= 0x80;	//	Vi mode flag set.
@@ -924,6 +823,7 @@ RETURN_AND_NEXTSEND:
 
         can_buf.ID[id].LONG[0] = data.LONG[0];
         can_buf.ID[id].LONG[1] = data.LONG[1];
+        CANID_DIRTY(id);
         ret                    = 1;
         /* ---------------------------------
          * Transport layer processing
@@ -1008,7 +908,7 @@ RETURN_AND_NEXTSEND:
  *---------------------------------------------------------------------------------------*/
 void can_send_proc(ECU_CYC_EVE *ev)
 {
-    int            id, exid;  // Get ID 
+    int            id, e;  // Get ID 
     int            dlc; // Number of data bytes 
     unsigned char  msk; // Channel mask 
     CAN_DATA_BYTE *act; // Active data 
@@ -1020,10 +920,9 @@ void can_send_proc(ECU_CYC_EVE *ev)
     msk = rout_map.ID[id].BYTE & ((repro_mode == 0) ? 0x0F : 0xF0);
 
     if (ev->ID.BIT.RTR == 0) { // Data frame 
-		exid = can_to_exio[id];
-		if(exid < EX_IO_MAX)
-		{
-			if(ext_list[exid].PORT.BIT.MODE > 3)
+		for(e = ext_id_ofs[id]; e < ext_id_ofs[id + 1]; e++)
+		{	//	All signals of the frame
+			if(ext_list[ext_id_slot[e]].PORT.BIT.MODE > 3)
 			{	//	CAN input mode is cancel.(DS Connected)
 		        if (id == VI_POWERTRAIN_SWID && ecu_opmode.mode == ECU_OPMODE_5) {
                     if (ds_x_lost_counter > 0) { // Wait 1 seconds without receiving 
@@ -1050,6 +949,7 @@ void can_send_proc(ECU_CYC_EVE *ev)
             act->LONG[1] = 
                 ((act->LONG[1] - val.LONG[1]) & (~rms->LONG[1])) |
                  (act->LONG[1] & rms->LONG[1]);
+            CANID_DIRTY(id);
         }
         if ((msk & 0x01) != 0) { // CAN0 transfer enable 
             add_mbox_frame(0, dlc, CAN_DATA_FRAME, id);
@@ -1167,7 +1067,7 @@ void can_timer_send(int tcnt)
         old = act;
         if (i == n || c >= MESSAGE_MAX) { // Queue disorder 
             wait_tup.TOP = -1;
-            logging("Chain Error\r");
+            TRACE(TRC_WAIT_CHAIN, 0, ((unsigned long)i << 16) | n);
             break;
         }
         i = n;
@@ -1228,20 +1128,20 @@ int add_cyceve_list(int rtr, int id, int dlc, int enb, int rep, int time, int cn
     mp = conf_ecu.TOP;
     if (mp < 0) { // As it is no waiting, make it to beginning 
         conf_ecu.TOP = mi;  // First message 
-        logging("conf new %d\r", mi);
+        TRACE(TRC_CONF_NEW, mi, id);
     } else { // As it has waiting, connect chain 
         msg = &conf_ecu.LIST[mp];
         if (msg->ID.BIT.SID > id) { // Priorize than beginning message 
             conf_ecu.TOP    = mi;
             act->ID.BIT.NXT = mp;
-            logging("conf top %d\r", mi);
+            TRACE(TRC_CONF_TOP, mi, id);
         } else { // Connect behind 
             for (i = 0; i < MESSAGE_MAX; i++) {
                 old = msg;               // Keep previous one 
                 mp  = msg->ID.BIT.NXT;   // Next message 
                 if (mp >= MESSAGE_MAX) { // As there is no continuation, append at the end 
                     msg->ID.BIT.NXT = mi;
-                    logging("conf add %d\r", mi);
+                    TRACE(TRC_CONF_ADD, mi, id);
                     break;
                 }
                 // Continuation message 
@@ -1249,7 +1149,7 @@ int add_cyceve_list(int rtr, int id, int dlc, int enb, int rep, int time, int cn
                 if (msg->ID.BIT.SID > id) { // As it is low priority message, insert before this 
                     act->ID.BIT.NXT = mp;
                     old->ID.BIT.NXT = mi;
-                    logging("conf ins %d\r", mi);
+                    TRACE(TRC_CONF_INS, mi, id);
                     break;
                 }
             }
@@ -1290,20 +1190,20 @@ void insert_cyceve_list(int mi)
     mp = conf_ecu.TOP;
     if (mp < 0) { // As it has no waiting messages, make it the first message
         conf_ecu.TOP = mi; // First message 
-        logging("conf new %d\r", mi);
+        TRACE(TRC_CONF_NEW, mi, id);
     } else { // As there are waitint messages, connect chain 
         msg = &conf_ecu.LIST[mp];
         if (msg->ID.BIT.SID > id) { // Prioritize first message 
             conf_ecu.TOP    = mi;
             act->ID.BIT.NXT = mp;
-            logging("conf top %d\r", mi);
+            TRACE(TRC_CONF_TOP, mi, id);
         } else { // Connect behind 
             for (i = 0; i < MESSAGE_MAX; i++) {
                 old = msg;               // Keep previous one 
                 mp  = msg->ID.BIT.NXT;   // Next message 
                 if (mp >= MESSAGE_MAX) { // As there is no continuation, append at the end 
                     msg->ID.BIT.NXT = mi;
-                    logging("conf add %d\r", mi);
+                    TRACE(TRC_CONF_ADD, mi, id);
                     break;
                 }
                 // Continuation message 
@@ -1311,7 +1211,7 @@ void insert_cyceve_list(int mi)
                 if (msg->ID.BIT.SID > id) { // As it is low priority message, insert before this 
                     act->ID.BIT.NXT = mp;
                     old->ID.BIT.NXT = mi;
-                    logging("conf ins %d\r", mi);
+                    TRACE(TRC_CONF_INS, mi, id);
                     break;
                 }
             }
@@ -1422,7 +1322,7 @@ int can_id_event(int id, int tp)
     if (i < 0) { // No waiting (top) 
         wait_tup.TOP = p; // Make it the beginning 
         wait_tup.CNT = 1; // One waiting now 
-        logging("Wait new %08lX:%d\r", new->ID.LONG, p);
+        TRACE(TRC_WAIT_NEW, new->ID.LONG, p);
         return at; // Delay time of continuous registration (ms) 
     }
     // Insert destination search 
@@ -1436,25 +1336,25 @@ int can_id_event(int id, int tp)
                     wait_tup.TOP    = p;
                     new->ID.BIT.NXT = i;
                     wait_tup.CNT++; // Increase waiting number 
-                    logging("Wait top %08lX:%d→%d\r", new->ID.LONG, p, i);
+                    TRACE(TRC_WAIT_TOP, new->ID.LONG, ((unsigned long)p << 16) | i);
                     return at;
                 } else { // Add in the middle 
                     old->ID.BIT.NXT = p;
                     new->ID.BIT.NXT = i;
                     wait_tup.CNT++; // Increase waiting number 
-                    logging("Wait ins %08lX:%d→%d\r", new->ID.LONG, p, i);
+                    TRACE(TRC_WAIT_INS, new->ID.LONG, ((unsigned long)p << 16) | i);
                     return at;
                 }
             } else if (n >= MESSAGE_MAX) { // Add to the end 
                 act->ID.BIT.NXT = p;
                 wait_tup.CNT++; // Increase waiting number 
-                logging("Wait add %08lX:→%d\r", new->ID.LONG, p);
+                TRACE(TRC_WAIT_ADD, new->ID.LONG, p);
                 return at;
             }
         }
         old = act;  // Previous information 
         if (i == n) { // Chain error 
-            logging("Wait chain error %08lX:%d→%d\r", new->ID.LONG, i, n);
+            TRACE(TRC_WAIT_CHAIN, new->ID.LONG, ((unsigned long)i << 16) | n);
             break;
         }
         i = n; // Continuation pointer 
@@ -1557,6 +1457,7 @@ void port_output_ex(int nom, int val, int md)
             if (exio_chg[nom] < 100) {
                 exio_chg[nom]++;// Data update notification 
             }
+            EXIO_DIRTY(nom);
             exio_chg_mark++; // Update mark 
         }
         exiosts.DATA[nom].BIT.B0 = (val == 0) ? 0 : 1;
@@ -1566,6 +1467,7 @@ void port_output_ex(int nom, int val, int md)
             if (exio_chg[nom] < 100) {
                 exio_chg[nom]++; // Data update notification 
             }
+            EXIO_DIRTY(nom);
             exio_chg_mark++; // Update mark 
         }
         exiosts.DATA[nom].BYTE[0] = (unsigned char)val;
@@ -1575,6 +1477,7 @@ void port_output_ex(int nom, int val, int md)
             if (exio_chg[nom] < 100) {
                 exio_chg[nom]++; // Data update notification 
             }
+            EXIO_DIRTY(nom);
             exio_chg_mark++; // Update mark 
         }
         exiosts.DATA[nom].WORD[0] = (unsigned short)val;
@@ -1584,6 +1487,7 @@ void port_output_ex(int nom, int val, int md)
             if (exio_chg[nom] < 100) {
                 exio_chg[nom]++; // Data update notification 
             }
+            EXIO_DIRTY(nom);
             exio_chg_mark++; // Update mark 
         }
         exiosts.DATA[nom].INTE = val;
@@ -1591,6 +1495,297 @@ void port_output_ex(int nom, int val, int md)
     }
 }
 
+/* ---------------------------------------------------------------------------------------
+ * extern_io_compile
+ * 
+ * Outline
+ *     External I/O checklist compilation
+ *
+ * Argument
+ *     None
+ *
+ * Description
+ *     Lowers each ext_list entry into an EXT_IO_OP with resolved frame / I/O pointers,
+ *     so the update does not decode the bit fields. Entries whose field runs past the
+ *     frame end are disabled.
+ *     Also builds the index of the entries of each I/O number and each CAN-ID
+ *     (several signals may share one frame), so the update requests reach only the
+ *     related entries, and the MODE masks of each operation mode (ecu_mode_job).
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void extern_io_compile(void)
+{
+    static const unsigned char  width[8] = { 1, 1, 2, 4, 1, 1, 2, 4 };  // Field bytes 
+    int                         i, id, nm, md, bp;
+    EXTERNUL_IO                 *act;
+    EXT_IO_OP                   *op;
+
+    for (i = ext_list_count - 1; i >= 0; i--) {
+        act     = &ext_list[i];
+        op      = &ext_op[i];
+        id      = act->SID;
+        nm      = act->PORT.BIT.NOM;
+        md      = act->PORT.BIT.MODE;
+        bp      = act->PORT.BIT.BPOS;
+        op->OP  = EXT_OP_NONE;
+        if (id < 0 || id >= CAN_ID_MAX || nm >= EX_IO_MAX || bp + width[md] > 8) { // Disable 
+            continue;
+        }
+        op->FRM = &can_buf.ID[id].BYTE[bp];
+        op->IO  = &exiosts.DATA[nm];
+        op->SID = (short)id;
+        op->OP  = (unsigned char)md;
+        op->MSK = (unsigned char)act->PORT.BIT.MSK;
+        op->NOM = (unsigned char)nm;
+    }
+    extern_io_index(ext_nm_ofs, ext_nm_slot, EX_IO_MAX, 0);
+    extern_io_index(ext_id_ofs, ext_id_slot, CAN_ID_MAX, 1);
+    /* Operation mode masks, entries of the CARLA / VI send IDs of this unit
+     * (stop=1 : the table ends at the first unmapped ID, as in the former mode switch)*/
+    memset(ext_mode_set, 0, sizeof(ext_mode_set));
+    memset(ext_mode_clr, 0, sizeof(ext_mode_clr));
+    switch (SELECT_ECU_UNIT) {
+    case ECU_UNIT_POWERTRAIN:
+        extern_io_set(ext_mode_clr[ECU_OPMODE_0], CARLA_POWERTRAIN_SEND_ID, 1); // PASTA : CAN output -> ECU input 
+        extern_io_set(ext_mode_set[ECU_OPMODE_1], CARLA_POWERTRAIN_SEND_ID, 1); // CARLA : ECU input -> CAN output 
+        extern_io_set(ext_mode_set[ECU_OPMODE_5], VI_POWERTRAIN_SEND_ID, 1);    // VI : ECU input -> CAN output 
+        break;
+    case ECU_UNIT_CHASSIS:
+        extern_io_set(ext_mode_clr[ECU_OPMODE_0], CARLA_CHASSIS_SEND_ID, 1);    // PASTA : CAN output -> ECU input 
+        extern_io_set(ext_mode_clr[ECU_OPMODE_1], CARLA_CHASSIS_SEND_ID, 0);    // CARLA : Chassis CAN output -> ECU input 
+        break;
+    case ECU_UNIT_BODY:
+        extern_io_set(ext_mode_clr[ECU_OPMODE_0], CARLA_BODY_SEND_ID, 0);       // PASTA : CAN output -> ECU input 
+        extern_io_set(ext_mode_set[ECU_OPMODE_1], CARLA_BODY_SEND_ID, 1);       // CARLA : ECU input -> CAN output 
+        break;
+    case ECU_UNIT_PTBD:
+        extern_io_set(ext_mode_clr[ECU_OPMODE_0], CARLA_PTBD_SEND_ID, 0);       // PASTA : CAN output -> ECU input 
+        extern_io_set(ext_mode_set[ECU_OPMODE_1], CARLA_PTBD_SEND_ID, 1);       // CARLA : ECU input -> CAN output 
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------
+ * extern_io_index
+ * 
+ * Outline
+ *     Checklist index creation
+ *
+ * Argument
+ *     unsigned char *ofs   Start position of each key (max + 1 elements)
+ *     unsigned char *slot  Checklist numbers sorted by key
+ *     int max              Number of keys
+ *     int key              0=I/O number, 1=CAN-ID
+ *
+ * Description
+ *     The entries of key n are slot[ofs[n]] to slot[ofs[n + 1] - 1], in checklist order.
+ *     The CAN-ID of an entry is ext_list[].SID. Entries with an out of range key are not indexed.
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void extern_io_index(unsigned char *ofs, unsigned char *slot, int max, int key)
+{
+    int i, n, c;
+
+    memset(ofs, 0, max + 1);
+    for (i = 0; i < ext_list_count; i++) { // Count 
+        n = (key == 0) ? ext_list[i].PORT.BIT.NOM : ext_list[i].SID;
+        if (n >= 0 && n < max) {
+            ofs[n]++;
+        }
+    }
+    for (c = 0, n = 0; n < max; n++) { // End position 
+        c       += ofs[n];
+        ofs[n]  = (unsigned char)c;
+    }
+    ofs[max] = (unsigned char)c;
+    for (i = ext_list_count - 1; i >= 0; i--) { // Place, end position -> start position 
+        n = (key == 0) ? ext_list[i].PORT.BIT.NOM : ext_list[i].SID;
+        if (n >= 0 && n < max) {
+            slot[--ofs[n]] = (unsigned char)i;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------
+ * extern_io_set
+ * 
+ * Outline
+ *     Checklist entry set creation
+ *
+ * Argument
+ *     unsigned long *set   Entry bitmap
+ *     const short *tbl     CAN-ID table (0=End)
+ *     int stop             1=End at the first ID without a checklist entry (can_to_exio)
+ *
+ * Description
+ *     Marks every entry of the CAN-IDs in the table (all signals of the frame).
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void extern_io_set(unsigned long *set, const short *tbl, int stop)
+{
+    int j, e, id;
+
+    memset(set, 0, ((ECU_EXT_MAX + 31) / 32) * sizeof(unsigned long));
+    for (j = 0; (id = tbl[j]) != 0; j++) {
+        if (stop != 0 && (id <= 0 || id >= CAN_ID_MAX || can_to_exio[id] >= EX_IO_MAX)) { // Unmapped ID 
+            break;
+        }
+        if (id > 0 && id < CAN_ID_MAX) {
+            for (e = ext_id_ofs[id]; e < ext_id_ofs[id + 1]; e++) {
+                set[ext_id_slot[e] >> 5] |= 1ul << (ext_id_slot[e] & 31);
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------
+ * extern_io_mode
+ * 
+ * Outline
+ *     I/O direction switching of the checklist for an operation mode
+ *
+ * Argument
+ *     int mode     Operation mode ECU_OPMODE_0 to ECU_OPMODE_6
+ *
+ * Description
+ *     Clears / sets the MODE output bit of the entries in the mode masks
+ *     (extern_io_compile), the caller requests EXT_RESCAN.
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void extern_io_mode(int mode)
+{
+    unsigned long   b;
+    int             i;
+
+    if (mode < 0 || mode >= ECU_OPMODE_MAX) {
+        return;
+    }
+    for (i = 0; i < ext_list_count; i++) {
+        b = 1ul << (i & 31);
+        if (ext_mode_clr[mode][i >> 5] & b) {
+            ext_list[i].PORT.BIT.MODE &= 3; // CAN output -> ECU input 
+        }
+        if (ext_mode_set[mode][i >> 5] & b) {
+            ext_list[i].PORT.BIT.MODE |= 4; // ECU input -> CAN output 
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------
+ * extern_io_entry
+ * 
+ * Outline
+ *     External I/O update processing of one compiled checklist entry
+ *
+ * Argument
+ *     int i    Checklist number
+ *     int tp   Time difference setting for simultaneous input change
+ *
+ * Description
+ *     Input operations write only the field bytes of the frame, output operations
+ *     update the I/O status (same notification as port_output_ex).
+ *
+ * Return
+ *     int Time difference for the next entry
+*---------------------------------------------------------------------------------------*/
+int extern_io_entry(int i, int tp)
+{
+    EXT_IO_OP       *op = &ext_op[i];
+    unsigned char   *f  = op->FRM;
+    EX_IO_MEM       *io = op->IO;
+    unsigned long   d;
+
+    switch (op->OP) {
+    default:    // Disable 
+        return tp;
+    case EXT_OP_IN_BIT:
+        d = (io->BIT.B0 != 0) ? (f[0] | op->MSK) : (f[0] & ~op->MSK);
+        if (f[0] == (unsigned char)d) {
+            return tp;
+        }
+        f[0] = (unsigned char)d;
+        break;
+    case EXT_OP_IN_BYTE:
+        if (f[0] == io->BYTE[0]) {
+            return tp;
+        }
+        f[0] = io->BYTE[0];
+        break;
+    case EXT_OP_IN_WORD:
+        d = io->WORD[0];
+        if (f[0] == (unsigned char)(d >> 8) && f[1] == (unsigned char)d) {
+            return tp;
+        }
+        f[0] = (unsigned char)(d >> 8);
+        f[1] = (unsigned char)d;
+        break;
+    case EXT_OP_IN_LONG:
+        d = io->LONG;
+        if (
+            f[0] == (unsigned char)(d >> 24) && f[1] == (unsigned char)(d >> 16) &&
+            f[2] == (unsigned char)(d >> 8)  && f[3] == (unsigned char)d
+        ) {
+            return tp;
+        }
+        f[0] = (unsigned char)(d >> 24);
+        f[1] = (unsigned char)(d >> 16);
+        f[2] = (unsigned char)(d >> 8);
+        f[3] = (unsigned char)d;
+        break;
+    case EXT_OP_OUT_BIT:
+        d = ((f[0] & op->MSK) == 0) ? 0 : 1;
+        if (io->BIT.B0 == d) {
+            return tp;
+        }
+        io->BIT.B0 = d;
+        goto OUTPUT_CHANGED;
+    case EXT_OP_OUT_BYTE:
+        if (io->BYTE[0] == f[0]) {
+            return tp;
+        }
+        io->BYTE[0] = f[0];
+        goto OUTPUT_CHANGED;
+    case EXT_OP_OUT_WORD:
+        d = ((unsigned long)f[0] << 8) | (unsigned long)f[1];
+        if (io->WORD[0] == (unsigned short)d) {
+            return tp;
+        }
+        io->WORD[0] = (unsigned short)d;
+        goto OUTPUT_CHANGED;
+    case EXT_OP_OUT_LONG:
+        d = ((unsigned long)f[0] << 24) | ((unsigned long)f[1] << 16) |
+            ((unsigned long)f[2] << 8)  |  (unsigned long)f[3];
+        if (io->LONG == d) {
+            return tp;
+        }
+        io->LONG = d;
+        goto OUTPUT_CHANGED;
+    }
+    // Frame changed by input 
+    CANID_DIRTY(op->SID); // Other entries of the frame 
+    if (exio_chg[op->NOM] < 100) {
+        exio_chg[op->NOM]++; // CAN data update count 
+    }
+    exio_chg_mark++; // Update mark 
+    return can_id_event(op->SID, tp); // CAN data update notification 
+
+OUTPUT_CHANGED:
+    EXIO_DIRTY(op->NOM);
+    if (exio_chg[op->NOM] < 100) {
+        exio_chg[op->NOM]++; // Data update notification 
+    }
+    exio_chg_mark++; // Update mark 
+    return tp;
+}
+
 /* ---------------------------------------------------------------------------------------
  * extern_io_update_ex
  * 
@@ -1602,89 +1797,83 @@ void port_output_ex(int nom, int val, int md)
  *
  * Description
  *     Acquires the input status of the ECU external I/O connector 
- *     and updates the application data buffer
+ *     and updates the application data buffer.
+ *     Only the entries linked to a marked I/O number (EXIO_DIRTY) or CAN-ID (CANID_DIRTY)
+ *     are processed, all entries after EXT_RESCAN (checklist recompiled).
+ *     Every mark is set from the main loop (CAN reception is processed by ecu_rxmb_proc,
+ *     the ecu_job polling and can3_job), so the marks are taken without disabling
+ *     interrupts.
  *
  * Return
  *     None
 *---------------------------------------------------------------------------------------*/
 void extern_io_update_ex(void)
 {
-    int i, d, m, tp;
-    int id;             // ID number 
-    int md;             // I/O processing mode 
-    int bp;             // Byte position 
-    int nm;             // I/O port number 
-    int msk;            // Bit mode mask 
-    EXTERNUL_IO *act;   // Active definition pointer 
-    CAN_DATA_BYTE *buf; // Frame data buffer 
-    CAN_DATA_BYTE  val; // Copy frame data 
+    unsigned long   ent[(ECU_EXT_MAX + 31) / 32];       // Entries to process 
+    unsigned long   nmw[(EX_IO_MAX + 31) / 32];         // Marked I/O numbers 
+    unsigned long   idw[CAN_ID_MAX / 32];               // Marked CAN-ID words 
+    unsigned long   sum[(CAN_ID_MAX / 32 + 31) / 32];   // Marked word positions 
+    unsigned long   w, u;
+    int             i, k, n, e, tp;
 
     tp = 0; // Time difference setting for simultaneous input change 
 
-    for (i = 0; i < ext_list_count; i++) {
-        act = &ext_list[i];
-        id  = act->SID;
-        if (id >= 0 && id < CAN_ID_MAX) {     // Setting enable 
-            nm          = act->PORT.BIT.NOM;  // Buffer number 
-            md          = act->PORT.BIT.MODE; // Mode   Input 0:bit / 1:byte / 2:word / 3:long Output 4:bit / 5:byte / 6:word / 7:long 
-            bp          = act->PORT.BIT.BPOS; // Byte position 
-            msk         = act->PORT.BIT.MSK;  // Mask pattern 
-            buf         = &can_buf.ID[id];    // Pointer to data buffer 
-            val.LONG[0] = buf->LONG[0];       // Get data 1 
-            val.LONG[1] = buf->LONG[1];       // Get data 2 
-            // Get status 
-            d = port_input_ex(nm, (md & 3));  // Acquisition of input status via communication 
-            // Process mode 
-            switch (md) {
-            default:        // Disable 
-                break;
-            case 0: // Input bit 
-                val.BYTE[bp] &= ~msk;
-                val.BYTE[bp] |= (d == 0) ? 0 : msk;
-                break;
-            case 4: // Output bit 
-                d = ((val.BYTE[bp] & msk) == 0) ? 0 : 1;
-                port_output_ex(nm, d, md);
-                break;
-            case 1: // Input byte 
-                val.BYTE[bp] = (unsigned char)d;
-                break;
-            case 5: // Output byte 
-                d = (int)((unsigned long)val.BYTE[bp]);
-                port_output_ex(nm, d, md);
-                break;
-            case 2: // Input word 
-                val.BYTE[bp]     = (unsigned char)(d >> 8);
-                val.BYTE[bp + 1] = (unsigned char)d;
-                break;
-            case 6: // Output word 
-                d = (int)((((unsigned long)val.BYTE[bp]) << 8) | ((unsigned long)val.BYTE[bp + 1]));
-                port_output_ex(nm, d, md);
-                break;
-            case 3: // Input long word 
-                val.BYTE[bp]     = (unsigned char)(d >> 24);
-                val.BYTE[bp + 1] = (unsigned char)(d >> 16);
-                val.BYTE[bp + 2] = (unsigned char)(d >> 8);
-                val.BYTE[bp + 3] = (unsigned char)d;
-                break;
-            case 7: // Output long word 
-                d = (int)
-                      ((((unsigned long)val.BYTE[bp])  << 24)    |
-                       (((unsigned long)val.BYTE[bp + 1]) << 16) |
-                       (((unsigned long)val.BYTE[bp + 2]) << 8)  |
-                        ((unsigned long)val.BYTE[bp + 3])
-                );
-                port_output_ex(nm, d, md);
-                break;
+    if (ext_rescan != 0) { // Checklist changed 
+        ext_rescan = 0;
+        memset(exio_dirty, 0, sizeof(exio_dirty));
+        memset(canid_dirty, 0, sizeof(canid_dirty));
+        memset(canid_dirty_sum, 0, sizeof(canid_dirty_sum));
+        extern_io_compile();
+        for (i = 0; i < ext_list_count; i++) {
+            tp = extern_io_entry(i, tp);
+        }
+        return;
+    }
+    // Take the marks 
+    for (k = 0; k < (int)(sizeof(sum) / sizeof(sum[0])); k++) {
+        sum[k] = canid_dirty_sum[k];
+        canid_dirty_sum[k] = 0;
+        for (w = sum[k], n = k * 32; w != 0; w >>= 1, n++) {
+            if (w & 1) {
+                idw[n]          = canid_dirty[n];
+                canid_dirty[n]  = 0;
+            }
+        }
+    }
+    for (k = 0; k < (int)(sizeof(nmw) / sizeof(nmw[0])); k++) {
+        nmw[k]          = exio_dirty[k];
+        exio_dirty[k]   = 0;
+    }
+    // Collect the linked entries 
+    memset(ent, 0, sizeof(ent));
+    for (k = 0; k < (int)(sizeof(nmw) / sizeof(nmw[0])); k++) {
+        for (w = nmw[k], n = k * 32; w != 0; w >>= 1, n++) {
+            if (w & 1) {
+                for (e = ext_nm_ofs[n]; e < ext_nm_ofs[n + 1]; e++) {
+                    ent[ext_nm_slot[e] >> 5] |= 1ul << (ext_nm_slot[e] & 31);
+                }
+            }
+        }
+    }
+    for (k = 0; k < (int)(sizeof(sum) / sizeof(sum[0])); k++) {
+        for (w = sum[k], i = k * 32; w != 0; w >>= 1, i++) {
+            if ((w & 1) == 0) {
+                continue;
             }
-            if (val.LONG[0] != buf->LONG[0] || val.LONG[1] != buf->LONG[1]) { // With change 
-                buf->LONG[0] = val.LONG[0]; // Data update 1 
-                buf->LONG[1] = val.LONG[1]; // Data update 2 
-                if (exio_chg[nm] < 100) {
-                    exio_chg[nm]++; // CAN data update count 
+            for (u = idw[i], n = i * 32; u != 0; u >>= 1, n++) {
+                if (u & 1) {
+                    for (e = ext_id_ofs[n]; e < ext_id_ofs[n + 1]; e++) {
+                        ent[ext_id_slot[e] >> 5] |= 1ul << (ext_id_slot[e] & 31);
+                    }
                 }
-                exio_chg_mark++; // Update mark 
-                tp = can_id_event(id, tp); // CAN data update notification 
+            }
+        }
+    }
+    // Update in checklist order 
+    for (k = 0; k < (int)(sizeof(ent) / sizeof(ent[0])); k++) {
+        for (w = ent[k], i = k * 32; w != 0; w >>= 1, i++) {
+            if ((w & 1) != 0 && i < ext_list_count) {
+                tp = extern_io_entry(i, tp);
             }
         }
     }
@@ -1955,7 +2144,8 @@ int add_extern_io(int id, int mode, int neg, int size, int bpos, int dlc, int no
     i = ext_list_count;
     if (i >= 0 && i < ECU_EXT_MAX) {
         ext_list_count++;          // Total update 
-        can_to_exio[id] = i;       // Reverse map setting 
+        can_to_exio[id] = i;       // Reverse map setting (last entry, all entries of the ID : ext_id_ofs) 
+        EXT_RESCAN();              // Checklist recompile 
         act = &ext_list[i];        // Registration pointer 
         act->SID = id;             // Frame ID number 
         act->PORT.BIT.MODE = mode; // I/O processing mode 
@@ -2023,161 +2213,254 @@ void set_frame_data(int id, int dlc, unsigned char *dat)
 
     act = &can_buf.ID[id];  // Select data buffer 
     memcpy(act, dat, dlc);  // Copy 
+    CANID_DIRTY(id);
 }
 
 /* ---------------------------------------------------------------------------------------
- * ecu_init
+ * ecu_config_index
  * 
  * Outline
- *     ECU initialization processing
+ *     Rebuilding of configuration derived information
  *
  * Argument
  *     None
  *
  * Description
- *     Initialization of ECU data area and registration of periodic message
+ *     Re-link the cycle/event chain in ID order and re-create the CAN-ID -> EX-I/O-ID
+ *     conversion table and the random code mask from the I/O checklist
  *
  * Return
  *     None
 *---------------------------------------------------------------------------------------*/
-void ecu_init(void)
+void ecu_config_index(void)
 {
-    int                     i, j, addr;
-    POINTER_MULTI_ACCESS    s, d;
-    EXTERNUL_IO *           act;
-    CAN_DATA_BYTE *         cmk;
-
-    Init_FlashData();
-
-    // Variable initialization 
-    memset(&wait_tup, 0, sizeof(wait_tup)); // Period / event wait initialization 
-    memset(&send_msg, 0, sizeof(send_msg)); // Initialize the transmission waiting buffer for each message box 
-    memset(&can_buf, 0, sizeof(can_buf));   // Initialize CAN data buffer 
-    memset(&mbox_sel, 0, sizeof(mbox_sel)); // Initialize message box range 
-    memset(&exiosts, 0, sizeof(exiosts));   // Initialize external I/O state 
-    memset(&exio_chg, 0, sizeof(exio_chg)); // Initialize external I/O state 
-    memset(&can_random_mask, 0, sizeof(can_random_mask)); // Initialize random code mask 
-    memset(&rxmb_buf, 0, sizeof(rxmb_buf)); // Receive buffer 
-    memset(&conf_ecu, 0, sizeof(conf_ecu)); // Event list 
-    memset(ext_list, 0, sizeof(ext_list));  // ECU I/O checklist initialization 
-    memset(can_to_exio, -1, sizeof(can_to_exio)); // Initialization of ECU I/O conversion table 
+    int             i, mp;
+    ECU_CYC_EVE *   act, *old;
+    EXTERNUL_IO *   exl;
+    CAN_DATA_BYTE * cmk;
 
-    exio_chg_mark = 0;
+    // Cycle / event chain 
+    conf_ecu.TOP = -1;
+    conf_ecu.CNT = 0;
+    for (i = 0; i < MESSAGE_MAX; i++) {
+        act = &conf_ecu.LIST[i];
+        if (act->ID.LONG == 0) { // Terminus 
+            break;
+        }
+        conf_ecu.CNT++;
+        old = 0;
+        mp  = conf_ecu.TOP;
+        while (mp >= 0 && mp < MESSAGE_MAX && conf_ecu.LIST[mp].ID.BIT.SID <= act->ID.BIT.SID) { // Find insertion point 
+            old = &conf_ecu.LIST[mp];
+            mp  = old->ID.BIT.NXT;
+        }
+        act->ID.BIT.NXT = (mp >= 0 && mp < MESSAGE_MAX) ? mp : MESSAGE_END;
+        if (old == 0) { // First message 
+            conf_ecu.TOP = i;
+        } else {
+            old->ID.BIT.NXT = i;
+        }
+    }
+    conf_ecu.WP = i & MESSAGE_MSK;
 
-    ext_list_count = 0; // Checklist number reset 
-    wait_tup.TOP   = -1;
-    for (i = 0; i < CAN_CH_MAX; i++) {
-        // MBOX0 : ID=000 to MBOX_POINT_1
-        mbox_sel.CH[i].MB1 = MBOX_POINT_1; 
-        // MBOX1 : ID=MBOX_POINT_1 to MBOX_POINT_2 , if more, MBOX2  
-        mbox_sel.CH[i].MB2 = MBOX_POINT_2; 
-        for (j = 0; j < MESSAGE_BOXS; j++) {
-            send_msg[i].BOX[j].TOP = -1;
+    // CAN-ID -> EX-I/O-ID conversion table and random code mask 
+    memset(can_to_exio, -1, sizeof(can_to_exio));
+    memset(&can_random_mask, 0, sizeof(can_random_mask));
+    for (ext_list_count = 0; ext_list_count < ECU_EXT_MAX; ext_list_count++) {
+        exl = &ext_list[ext_list_count];
+        if (exl->PORT.LONG == 0) { // Terminus 
+            break;
+        }
+        if (exl->SID < 0 || exl->SID >= CAN_ID_MAX) { // Disable 
+            continue;
+        }
+        can_to_exio[exl->SID] = ext_list_count; // Reverse map setting 
+        cmk = &can_random_mask.ID[exl->SID];
+        // Mask processing 
+        switch (exl->PORT.BIT.MODE) {
+        default:    // Mask disable 
+            cmk->LONG[0] = -1;
+            cmk->LONG[1] = -1;
+            break;
+        case 0: // Bit input 
+            cmk->BYTE[exl->PORT.BIT.BPOS] = exl->PORT.BIT.MSK;
+            break;
+        case 1: // Byte input 
+            cmk->BYTE[exl->PORT.BIT.BPOS] = 0xFF;
+            break;
+        case 2: // Word input 
+            cmk->BYTE[exl->PORT.BIT.BPOS]     = 0xFF;
+            cmk->BYTE[exl->PORT.BIT.BPOS + 1] = 0xFF;
+            break;
+        case 3: // Long word input 
+            cmk->BYTE[exl->PORT.BIT.BPOS]     = 0xFF;
+            cmk->BYTE[exl->PORT.BIT.BPOS + 1] = 0xFF;
+            cmk->BYTE[exl->PORT.BIT.BPOS + 2] = 0xFF;
+            cmk->BYTE[exl->PORT.BIT.BPOS + 3] = 0xFF;
+            break;
         }
     }
+    EXT_RESCAN(); // extern_io_update_ex checklist recompile 
+}
 
-    // Get map 
-    addr = g_flash_BlockAddresses[BLOCK_DB0];
-    // Blank check 
-    if (
-        (i = R_FlashDataAreaBlankCheck(addr, BLANK_CHECK_ENTIRE_BLOCK)
-       ) == FLASH_NOT_BLANK
-    ) { /* Data flash enabled (8KB: 0x00100000 - 0x00101FFF)
+/* ---------------------------------------------------------------------------------------
+ * ecu_config_load
+ * 
+ * Outline
+ *     Loading of configuration
+ *
+ * Argument
+ *     None
+ *
+ * Description
+ *     Read the routing map, cycle/event list and I/O checklist from the newest valid
+ *     configuration slot, or set the built-in initial values when nothing is saved.
+ *     Call only while no data flash job is running (ecu_init, or uds_pending_job
+ *     after the job has finished), the slot is read directly.
+ *
+ * Return
+ *     int  FLASH_NOT_BLANK=Saved configuration / FLASH_BLANK=Initial values
+ *---------------------------------------------------------------------------------------*/
+int ecu_config_load(void)
+{
+    int                     i, k, addr;
+    POINTER_MULTI_ACCESS    s, d;
+
+    memset(&conf_ecu, 0, sizeof(conf_ecu));         // Event list 
+    memset(ext_list, 0, sizeof(ext_list));          // ECU I/O checklist initialization 
+    memset(can_to_exio, -1, sizeof(can_to_exio));   // Initialization of ECU I/O conversion table 
+    memset(&can_random_mask, 0, sizeof(can_random_mask)); // Initialize random code mask 
+    ext_list_count  = 0;  // Checklist number reset 
+    conf_ecu.TOP    = -1;
+
+    // Newest valid configuration slot (header and CRC32 checked) 
+    if ((k = ecu_cfg_select()) >= 0) { /* Saved configuration
          * Read routing map*/
-        s.LONG = ADDRESS_OF_ROOTMAP;
+        addr   = ecu_cfg_addr(k);
+        s.LONG = addr;
         d.MAP  = &rout_map;
         memcpy(d.UB, s.UB, sizeof(rout_map)); // Initialize map 
         // Read event list 
-        s.LONG = ADDRESS_OF_CYCEVE;
+        s.LONG = addr + ECU_IMAGE_BLOCK;
         d.CYE  = &conf_ecu.LIST[0];
          // Initialization of cycle / event / remote management definition 
         memcpy(d.UB, s.UB, sizeof(ECU_CYC_EVE) * MESSAGE_MAX); 
-        j = CAN_ID_MAX;
-        for (i = 0; i < MESSAGE_MAX; i++) {
-            if (conf_ecu.LIST[i].ID.LONG == 0) { //ID.BIT.ENB != 0) 
-                // Terminus 
-                conf_ecu.WP = i;
-                break;
-            }
-            if (conf_ecu.LIST[i].ID.BIT.SID < j) {
-                j = conf_ecu.LIST[i].ID.BIT.SID;
-                conf_ecu.TOP = i;
-            }
-            conf_ecu.CNT++;
-        }
         // Read I/O setting 
-        s.LONG = ADDRESS_OF_IOLIST;
+        s.LONG = addr + 2 * ECU_IMAGE_BLOCK;
         d.EXL  = ext_list;
         memcpy(d.UB, s.UB, sizeof(ext_list)); // ECU I/O checklist initialization 
-        // Check list valid registration number 
-        for (i = 0; i < ECU_EXT_MAX; i++, ext_list_count++) {
-            if (ext_list[i].PORT.LONG == 0) {
-                // Terminus 
-                break;
-            }
-            ext_list_count++; // Update total number 
-            act = &ext_list[i]; // Registration pointer 
-            can_to_exio[act->SID] = i; // Reverse map setting 
-            cmk = &can_random_mask.ID[act->SID];
-            // Mask processing 
-            switch (act->PORT.BIT.MODE) {
-            default:    // Mask disable 
-                cmk->LONG[0] = -1;
-                cmk->LONG[1] = -1;
-                break;
-            case 0: // Bit input 
-                cmk->BYTE[act->PORT.BIT.BPOS] = act->PORT.BIT.MSK;
-                break;
-            case 1: // Byte input 
-                cmk->BYTE[act->PORT.BIT.BPOS] = 0xFF;
-                break;
-            case 2: // Word input 
-                cmk->BYTE[act->PORT.BIT.BPOS]     = 0xFF;
-                cmk->BYTE[act->PORT.BIT.BPOS + 1] = 0xFF;
-                break;
-            case 3: // Long word input 
-                cmk->BYTE[act->PORT.BIT.BPOS]     = 0xFF;
-                cmk->BYTE[act->PORT.BIT.BPOS + 1] = 0xFF;
-                cmk->BYTE[act->PORT.BIT.BPOS + 2] = 0xFF;
-                cmk->BYTE[act->PORT.BIT.BPOS + 3] = 0xFF;
-                break;
-            }
-        }
-    } else if (i == FLASH_BLANK) { /* No saved information
-                                    * Default setting call*/
+        ecu_jnl_load(); // Apply the saved changes 
+        ecu_config_index();
+        i = FLASH_NOT_BLANK;
+    } else { /* No valid saved information
+              * Default setting call*/
+        i = FLASH_BLANK;
+        ecu_jnl_init();
         defset_rootmap();    // Map initial value 
         defset_confecu();    // Period / event initial value 
         defset_extlist_ex(); // External I/O definition initial value via communication 
     }
-    // Frame data initial value 
-    defset_framedat();
-    // First event registration 
+    return i;
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_event_start
+ * 
+ * Outline
+ *     Start of periodic / event transmission
+ *
+ * Argument
+ *     None
+ *
+ * Description
+ *     Clear the time-up waiting list and register every enabled cycle/event again
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void ecu_event_start(void)
+{
+    int i;
+
+    memset(&wait_tup, 0, sizeof(wait_tup)); // Period / event wait initialization 
+    wait_tup.TOP = -1;
     for (i = 0; i < conf_ecu.CNT; i++) {
         if (conf_ecu.LIST[i].ID.BIT.ENB != 0) { // Period / Event 
-            j = conf_ecu.LIST[i].ID.BIT.SID;
-            can_id_event(j, 0);
+            can_id_event(conf_ecu.LIST[i].ID.BIT.SID, 0);
         }
     }
 }
 
 /* ---------------------------------------------------------------------------------------
- * can_pin_init
+ * ecu_init
  * 
  * Outline
- *     CAN port setting
+ *     ECU initialization processing
  *
  * Argument
  *     None
  *
  * Description
- *     Initialization of port conditions used for CAN
+ *     Initialization of ECU data area and registration of periodic message
  *
  * Return
  *     None
 *---------------------------------------------------------------------------------------*/
-void can_pin_init(void)
+void ecu_init(void)
 {
-    SYSTEM.PRCR.WORD   = 0xA503; // Port setting permission 
+    int                     i, j;
+
+    Init_FlashData();
+
+    // Variable initialization 
+    memset(&wait_tup, 0, sizeof(wait_tup)); // Period / event wait initialization 
+    memset(&send_msg, 0, sizeof(send_msg)); // Initialize the transmission waiting buffer for each message box 
+    memset(&can_buf, 0, sizeof(can_buf));   // Initialize CAN data buffer 
+    memset(&mbox_sel, 0, sizeof(mbox_sel)); // Initialize message box range 
+    memset(&exiosts, 0, sizeof(exiosts));   // Initialize external I/O state 
+    memset(&exio_chg, 0, sizeof(exio_chg)); // Initialize external I/O state 
+    memset(&rxmb_buf, 0, sizeof(rxmb_buf)); // Receive buffer 
+    EXT_RESCAN();
+
+    exio_chg_mark = 0;
+
+    wait_tup.TOP   = -1;
+    for (i = 0; i < CAN_CH_MAX; i++) {
+        // MBOX0 : ID=000 to MBOX_POINT_1
+        mbox_sel.CH[i].MB1 = MBOX_POINT_1; 
+        // MBOX1 : ID=MBOX_POINT_1 to MBOX_POINT_2 , if more, MBOX2  
+        mbox_sel.CH[i].MB2 = MBOX_POINT_2; 
+        for (j = 0; j < MESSAGE_BOXS; j++) {
+            send_msg[i].BOX[j].TOP = -1;
+        }
+    }
+
+    // Get map 
+    ecu_config_load();
+    // Frame data initial value 
+    defset_framedat();
+    // First event registration 
+    ecu_event_start();
+}
+
+/* ---------------------------------------------------------------------------------------
+ * can_pin_init
+ * 
+ * Outline
+ *     CAN port setting
+ *
+ * Argument
+ *     None
+ *
+ * Description
+ *     Initialization of port conditions used for CAN
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void can_pin_init(void)
+{
+    SYSTEM.PRCR.WORD   = 0xA503; // Port setting permission 
     MPC.PWPR.BIT.B0WI  = 0;
     MPC.PWPR.BIT.PFSWE = 1;
 
@@ -2454,6 +2737,50 @@ void ecu_rxmb_proc(void)
     }
 }
 
+/* ---------------------------------------------------------------------------------------
+ * ecu_mode_job
+ * 
+ * Outline
+ *     Operation mode switching
+ *
+ * Argument
+ *     None
+ *
+ * Description
+ *     Applies the mode requested by the CARLA / VI frames (ds_conect_active[1] set in
+ *     can_recv_frame) or the MOD command between the frames, so the reception is not
+ *     delayed by the checklist switching and the notification.
+ *
+ * Return
+ *     None
+*---------------------------------------------------------------------------------------*/
+void ecu_mode_job(void)
+{
+    int     mode;
+    char    s[16];
+
+    mode = ds_conect_active[1];
+    if (SELECT_ECU_UNIT == ECU_UNIT_CGW || mode == ds_conect_active[0]) {
+        return;
+    }
+    TRACE(TRC_OPMODE, mode, ds_conect_active[0]);
+    ds_conect_active[0] = mode;
+    ecu_opmode.mode     = mode;
+    ecu_opmode.mode_bk  = mode;
+    memset(exio_bridge, 0, sizeof(exio_bridge));
+    if (ext_rescan & 1) { // Masks of the changed checklist 
+        extern_io_compile();
+    }
+    if (mode == ECU_OPMODE_5 && SELECT_ECU_UNIT == ECU_UNIT_POWERTRAIN) {
+        can_buf.ID[VI_POWERTRAIN_SWID].BYTE[0] |= 0x80; // Vi mode flag set (can_buf and the marks are main loop only) 
+        CANID_DIRTY(VI_POWERTRAIN_SWID);
+    }
+    extern_io_mode(mode);
+    EXT_RESCAN(); // I/O direction of the checklist changes 
+    sprintf(s, "MOD%d\r", mode);
+    sci_puts(0, s);
+}
+
 /* ---------------------------------------------------------------------------------------
  * ecu_job
  * 
@@ -2476,6 +2803,7 @@ void ecu_job(void)
 
     if (job > 1) {
         ecu_rxmb_proc();   // Check reception every time 
+        ecu_mode_job();    // Operation mode change request 
         send_mbox_frame(); // Check transmission every time 
     }
 
@@ -2526,6 +2854,7 @@ void ecu_job(void)
                 PORT6.PODR.BYTE ^= 0x20; // LED inversion 
             }
             can_timer_send(t); // Time-up processing 
+            uds_periodic_job(t); // UDS periodic transmission 
         }
         break;
     case 4: // CAN transmission processing 
@@ -2568,44 +2897,40 @@ void ecu_job(void)
 #endif // ifndef CAN_RX_INT_ENB
     case 6:     // RS-232C transmission processing 
         job = 2;
-        if (stat_update_id < EX_IO_MAX) { // Send continuation notification 
-            if (sci_txbytes(stat_comm) == 0) { // Free transmission buffer 
+        if (stat_line_pos < stat_line_len) { // Resume the line stopped by a full transmission buffer 
+            stat_line_pos += sci_write(
+                        stat_comm, (unsigned char *)&stat_line[stat_line_pos],
+                        stat_line_len - stat_line_pos
+            );
+        } else if (stat_update_id < EX_IO_MAX) { // Send continuation notification 
+            if (stat_bin != 0) { // Binary delta stream 
+                if (sci_txbytes(stat_comm) == 0) { // Free transmission buffer 
+                    stat_line_len = ecu_stat_frame((unsigned char *)stat_line);
+                    stat_line_pos = 0;
+                    if (stat_line_len > 0) {
+                        stat_line_pos = sci_write(stat_comm, (unsigned char *)stat_line, stat_line_len);
+                    }
+                }
+            } else if (sci_txbytes(stat_comm) == 0) { // Free transmission buffer 
                 int j, k;
                 int r;
-                char buf[128];
                 r = 0;
                 // One message is sent as about 80 characters 
                 for (; r < 80 && stat_update_id < EX_IO_MAX; stat_update_id++) { // Send one line 
                     if (exio_chg[stat_update_id] != 0) { // Data update ID 
                         exio_chg[stat_update_id] = 0;
                         if (r == 0) { // Beginning of line starts with "EXU" 
-                            buf[r++] = 'E';
-                            buf[r++] = 'X';
-                            buf[r++] = 'U';
+                            stat_line[r++] = 'E';
+                            stat_line[r++] = 'X';
+                            stat_line[r++] = 'U';
                         }
                         // 2-digit I/O-ID code 
                         k           = stat_update_id;
-                        buf[r++]    = ' ';
-                        buf[r++]    = HEX_CHAR[((k >> 4) & 15)];
-                        buf[r++]    = HEX_CHAR[(k & 15)];
+                        stat_line[r++]    = ' ';
+                        stat_line[r++]    = HEX_CHAR[((k >> 4) & 15)];
+                        stat_line[r++]    = HEX_CHAR[(k & 15)];
                         // Update data 4 bytes 
-                        k   = exiosts.DATA[stat_update_id].INTE;
-
-		            	if(SELECT_ECU_UNIT == ECU_UNIT_CHASSIS)
-		            	{
-			            	if(ds_conect_active[0] >= ECU_OPMODE_5)
-			            	{	//	Chassis only DS(VI) mode
-			            		if(stat_update_id == VI_POWERTRAIN_SPEED)
-			            		{	//	copy speed value
-			            			k = exiosts.DATA[VI_POWERTRAIN_RPM].INTE & 0xFFFF;
-			            		}
-			            		else
-			            		if(stat_update_id == VI_POWERTRAIN_RPM)
-			            		{	//	update request
-			            			exio_chg[VI_POWERTRAIN_SPEED]++;
-			            		}
-			            	}
-			            }
+                        k   = ecu_stat_value(stat_update_id);
 
                         j   = 8;
                         if (((k >> 28) & 15) == 0) {
@@ -2631,35 +2956,36 @@ void ecu_job(void)
                         }
                         switch (j) {
                         case 8:
-                            buf[r++] = HEX_CHAR[((k >> 28) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 28) & 15)];
                         case 7:
-                            buf[r++] = HEX_CHAR[((k >> 24) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 24) & 15)];
                         case 6:
-                            buf[r++] = HEX_CHAR[((k >> 20) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 20) & 15)];
                         case 5:
-                            buf[r++] = HEX_CHAR[((k >> 16) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 16) & 15)];
                         case 4:
-                            buf[r++] = HEX_CHAR[((k >> 12) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 12) & 15)];
                         case 3:
-                            buf[r++] = HEX_CHAR[((k >> 8) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 8) & 15)];
                         case 2:
-                            buf[r++] = HEX_CHAR[((k >> 4) & 15)];
+                            stat_line[r++] = HEX_CHAR[((k >> 4) & 15)];
                         case 1:
-                            buf[r++] = HEX_CHAR[(k & 15)];
+                            stat_line[r++] = HEX_CHAR[(k & 15)];
                         case 0:
                             break;
                         }
                     }
                 }
                 if (r > 0) {
-                    buf[r++]    = '\r';
-                    buf[r]      = 0;
-                    sci_puts(stat_comm, buf);       // Transmit execution 
+                    stat_line[r++]  = '\r';
+                    stat_line_len   = r;
+                    stat_line_pos   = sci_write(stat_comm, (unsigned char *)stat_line, r); // Transmit execution 
                 }
             }
-        } else if (status_timer >= 500) { // Forced all transmission at 500ms cycle 
+        } else if (status_timer >= ((stat_bin != 0) ? STAT_KEY_TIME : 500)) { // Forced all transmission (keyframe) 
             status_timer    = 0;    // Timer clear 
             stat_update_id  = 0;    // Transmission start ID set 
+            stat_key        = stat_bin;
             exio_chg_mark   = 0;    // Change flag clear 
             for (i = 0; i < ext_list_count; i++) {
                 exio_chg[(ext_list[i].PORT.BIT.NOM)] = 1;
@@ -2667,6 +2993,7 @@ void ecu_job(void)
         } else if (sci_txbytes(stat_comm) == 0 && exio_chg_mark > 0) { // Free transmission buffer, Individual transmission with status change 
             status_timer    = 0;    // Timer clear 
             stat_update_id  = 0;    // Transmission start ID set 
+            stat_key        = 0;
             exio_chg_mark   = 0;    // Change flag clear 
         }
         break;
@@ -2676,6 +3003,105 @@ void ecu_job(void)
     }
 }
 
+/* ---------------------------------------------------------------------------------------
+ * ecu_status_line
+ * 
+ * Outline
+ *     Next line of the parameter dump
+ *
+ * Argument
+ *     char *s  Line buffer (ECU_DUMP_LINE bytes)
+ *
+ * Description
+ *     Builds the line at stat_dump_pos and advances it. Disabled entries are skipped.
+ *     L / W : 0=Header / 1 to MESSAGE_MAX=Entry
+ *     S     : (MESSAGE_MAX + 1) positions per channel and box, header first
+ *
+ * Return
+ *     Line length (0=Dump completed)
+ *---------------------------------------------------------------------------------------*/
+int ecu_status_line(char *s)
+{
+    int             i, ch, mb;
+    CYCLE_EVENTS *  ce;
+    SEND_WAIT_FLAME *mp;
+
+    for (; ; stat_dump_pos++) {
+        switch (stat_dump) {
+        case 'L':   // conf_ecu variable display 
+        case 'W':   // wait_tup variable display 
+            ce = (stat_dump == 'L') ? &conf_ecu : &wait_tup;
+            i  = stat_dump_pos - 1;
+            if (i >= MESSAGE_MAX) {
+                return 0;
+            }
+            if (i < 0) {
+                stat_dump_pos++;
+                return sprintf(s, "%s WP=%d TOP=%d CNT=%d\r", (stat_dump == 'L') ? "conf_ecu" : "wait_tup", ce->WP, ce->TOP, ce->CNT);
+            }
+            if (ce->LIST[i].ID.BIT.ENB == 0) {
+                continue;
+            }
+            stat_dump_pos++;
+            return sprintf(
+                        s,
+                        "No.%d RTR=%d SID=%03X DLC=%d ENB=%d REP=%d NXT=%d TIM=%d CNT=%d "
+                        "DATA=%02X %02X %02X %02X %02X %02X %02X %02X\r",
+                        i,
+                        (int)ce->LIST[i].ID.BIT.RTR,
+                        (int)ce->LIST[i].ID.BIT.SID,
+                        (int)ce->LIST[i].ID.BIT.DLC,
+                        (int)ce->LIST[i].ID.BIT.ENB,
+                        (int)ce->LIST[i].ID.BIT.REP,
+                        (int)ce->LIST[i].ID.BIT.NXT,
+                        (int)conf_ecu.LIST[i].TIMER.WORD.TIME,
+                        (int)conf_ecu.LIST[i].TIMER.WORD.CNT,
+                        (int)can_buf.ID[i].BYTE[0], (int)can_buf.ID[i].BYTE[1], 
+                        (int)can_buf.ID[i].BYTE[2], (int)can_buf.ID[i].BYTE[3],
+                        (int)can_buf.ID[i].BYTE[4], (int)can_buf.ID[i].BYTE[5], 
+                        (int)can_buf.ID[i].BYTE[6], (int)can_buf.ID[i].BYTE[7]
+            );
+        case 'S':   // send_msg variable display 
+            i  = stat_dump_pos % (MESSAGE_MAX + 1) - 1;
+            mb = (stat_dump_pos / (MESSAGE_MAX + 1)) % MESSAGE_BOXS;
+            ch = stat_dump_pos / ((MESSAGE_MAX + 1) * MESSAGE_BOXS);
+            if (ch >= CAN_CH_MAX) {
+                return 0;
+            }
+            if (i < 0) {
+                stat_dump_pos++;
+                return sprintf(
+                            s, "send_msg[%d].BOX[%d] WP=%d TOP=%d CNT=%d\r",
+                            ch, mb, send_msg[ch].BOX[mb].WP, 
+                            send_msg[ch].BOX[mb].TOP, send_msg[ch].BOX[mb].CNT
+                );
+            }
+            mp = &send_msg[ch].BOX[mb].MSG[i];
+            if (mp->ID.BIT.ENB == 0) {
+                continue;
+            }
+            stat_dump_pos++;
+            return sprintf(
+                        s,
+                        "No.%d RTR=%d SID=%03X DLC=%d ENB=%d NXT=%d "
+                        "DATA=%02X %02X %02X %02X %02X %02X %02X %02X\r",
+                        i,
+                        (int)mp->ID.BIT.RTR,
+                        (int)mp->ID.BIT.SID,
+                        (int)mp->ID.BIT.DLC,
+                        (int)mp->ID.BIT.ENB,
+                        (int)mp->ID.BIT.NXT,
+                        (int)mp->FD.BYTE[0], (int)mp->FD.BYTE[1],
+                        (int)mp->FD.BYTE[2], (int)mp->FD.BYTE[3],
+                        (int)mp->FD.BYTE[4], (int)mp->FD.BYTE[5],
+                        (int)mp->FD.BYTE[6], (int)mp->FD.BYTE[7]
+            );
+        default:
+            return 0;
+        }
+    }
+}
+
 /* ---------------------------------------------------------------------------------------
  * ecu_status
  * 
@@ -2683,10 +3109,12 @@ void ecu_job(void)
  *     ECU operating parameter notification
  *
  * Argument
- *     None
+ *     char *cmd  L=conf_ecu / W=wait_tup / S=send_msg
  *
  * Description
- *     Transmit current parameter value to COM1
+ *     Starts the dump on the reply port. The first line is sent as the command reply
+ *     and the rest by ecu_status_job, so a list longer than the transmission buffer
+ *     is not dropped. A USB reply port is sent at once.
  *
  * Return
  *     None
@@ -2695,99 +3123,58 @@ void SendPC(char *msg);
 
 void ecu_status(char *cmd)
 {
-    int     i, j;
-    int     ch, mb, id;
-    char    tx[39], c;
-
     if (cmd == 0 || *cmd == 0) {
         return;
     }
     while (*cmd == ' ') {
         cmd++;
     }
-    switch (*cmd++) {
-    case 'L':   // conf_ecu variable display 
-        logging("conf_ecu WP=%d TOP=%d CNT=%d\r", conf_ecu.WP, conf_ecu.TOP, conf_ecu.CNT);
-        for (i = 0; i < MESSAGE_MAX; i++) {
-            if (conf_ecu.LIST[i].ID.BIT.ENB != 0) {
-                logging(
-                            "No.%d RTR=%d SID=%03X DLC=%d ENB=%d REP=%d NXT=%d TIM=%d CNT=%d "
-                            "DATA=%02X %02X %02X %02X %02X %02X %02X %02X\r",
-                            i,
-                            (int)conf_ecu.LIST[i].ID.BIT.RTR,
-                            (int)conf_ecu.LIST[i].ID.BIT.SID,
-                            (int)conf_ecu.LIST[i].ID.BIT.DLC,
-                            (int)conf_ecu.LIST[i].ID.BIT.ENB,
-                            (int)conf_ecu.LIST[i].ID.BIT.REP,
-                            (int)conf_ecu.LIST[i].ID.BIT.NXT,
-                            (int)conf_ecu.LIST[i].TIMER.WORD.TIME,
-                            (int)conf_ecu.LIST[i].TIMER.WORD.CNT,
-                            (int)can_buf.ID[i].BYTE[0], (int)can_buf.ID[i].BYTE[1], 
-                            (int)can_buf.ID[i].BYTE[2], (int)can_buf.ID[i].BYTE[3],
-                            (int)can_buf.ID[i].BYTE[4], (int)can_buf.ID[i].BYTE[5], 
-                            (int)can_buf.ID[i].BYTE[6], (int)can_buf.ID[i].BYTE[7]
-                );
-            }
-        }
-        break;
-    case 'W':   // wait_tup variable display 
-        logging("wait_tup WP=%d TOP=%d CNT=%d\r", wait_tup.WP, wait_tup.TOP, wait_tup.CNT);
-        for (i = 0; i < MESSAGE_MAX; i++) {
-            if (wait_tup.LIST[i].ID.BIT.ENB != 0) {
-                logging(
-                            "No.%d RTR=%d SID=%03X DLC=%d ENB=%d REP=%d NXT=%d TIM=%d CNT=%d "
-                            "DATA=%02X %02X %02X %02X %02X %02X %02X %02X\r",
-                            i,
-                            (int)wait_tup.LIST[i].ID.BIT.RTR,
-                            (int)wait_tup.LIST[i].ID.BIT.SID,
-                            (int)wait_tup.LIST[i].ID.BIT.DLC,
-                            (int)wait_tup.LIST[i].ID.BIT.ENB,
-                            (int)wait_tup.LIST[i].ID.BIT.REP,
-                            (int)wait_tup.LIST[i].ID.BIT.NXT,
-                            (int)conf_ecu.LIST[i].TIMER.WORD.TIME,
-                            (int)conf_ecu.LIST[i].TIMER.WORD.CNT,
-                            (int)can_buf.ID[i].BYTE[0], (int)can_buf.ID[i].BYTE[1], 
-                            (int)can_buf.ID[i].BYTE[2], (int)can_buf.ID[i].BYTE[3],
-                            (int)can_buf.ID[i].BYTE[4], (int)can_buf.ID[i].BYTE[5], 
-                            (int)can_buf.ID[i].BYTE[6], (int)can_buf.ID[i].BYTE[7]
-                );
-            }
+    stat_dump       = *cmd;
+    stat_dump_pos   = 0;
+    stat_dump_port  = retport;
+    stat_dump_len   = ecu_status_line(stat_dump_line);
+    if (stat_dump_len == 0) { // Unknown list 
+        stat_dump = 0;
+        return;
+    }
+    SendPC(stat_dump_line);
+    stat_dump_len = 0;
+    if (stat_dump_port > 3) { // USB : no transmission buffer limit 
+        while (ecu_status_line(stat_dump_line) > 0) {
+            SendPC(stat_dump_line);
         }
-        break;
+        stat_dump = 0;
+    }
+}
 
-    case 'S':   // send_msg variable display 
-        for (ch = 0; ch < CAN_CH_MAX; ch++) {
-            for (mb = 0; mb < MESSAGE_BOXS; mb++) {
-                logging(
-                    "send_msg[%d].BOX[%d] WP=%d TOP=%d CNT=%d\r",
-                    ch, mb, send_msg[ch].BOX[mb].WP, 
-                    send_msg[ch].BOX[mb].TOP, send_msg[ch].BOX[mb].CNT
-                );
-                for (i = 0; i < MESSAGE_MAX; i++) {
-                    if (send_msg[ch].BOX[mb].MSG[i].ID.BIT.ENB != 0) {
-                        logging(
-                                    "No.%d RTR=%d SID=%03X DLC=%d ENB=%d NXT=%d "
-                                    "DATA=%02X %02X %02X %02X %02X %02X %02X %02X\r",
-                                    i,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].ID.BIT.RTR,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].ID.BIT.SID,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].ID.BIT.DLC,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].ID.BIT.ENB,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].ID.BIT.NXT,
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[0], 
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[1],
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[2], 
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[3],
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[4], 
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[5],
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[6], 
-                                    (int)send_msg[ch].BOX[mb].MSG[i].FD.BYTE[7]
-                        );
-                    }
-                }
+/* ---------------------------------------------------------------------------------------
+ * ecu_status_job
+ * 
+ * Outline
+ *     Parameter dump continuation (call from main loop)
+ *
+ * Description
+ *     Sends whole lines while they fit in the transmission buffer and resumes
+ *     from stat_dump_pos on the next pass.
+ *
+ * Return
+ *     None
+ *---------------------------------------------------------------------------------------*/
+void ecu_status_job(void)
+{
+    while (stat_dump != 0) {
+        if (stat_dump_len == 0) { // Next line 
+            stat_dump_len = ecu_status_line(stat_dump_line);
+            if (stat_dump_len == 0) { // Dump completed 
+                stat_dump = 0;
+                return;
             }
         }
-        break;
+        if (sci_putcheck(stat_dump_port) <= stat_dump_len) { // Transmission buffer full 
+            return;
+        }
+        sci_putb(stat_dump_port, (unsigned char *)stat_dump_line, stat_dump_len);
+        stat_dump_len = 0;
     }
 }
 
@@ -2798,7 +3185,8 @@ void ecu_status(char *cmd)
  *     Get ECU frame data
  *
  * Argument
- *     char *cmd Command string
+ *     int     argc  Number of tokens
+ *     CMD_ARG *argv Tokens of the command
  *
  * Description
  *     Returns the current specified ID frame data
@@ -2806,39 +3194,18 @@ void ecu_status(char *cmd)
  * Return
  *     None
 *---------------------------------------------------------------------------------------*/
-void ecu_get_command(char *cmd)
+void ecu_get_command(int argc, CMD_ARG *argv)
 {
-    int i, j;
-    int id;
+    int i, j, k;
+    unsigned long id;
     char tx[39], c;
 
-    if (cmd == 0 || *cmd == 0) {
-        return;
-    }
-    while (*cmd == ' ') {
-        cmd++;
-    }
-    if (*cmd < '0' || *cmd > '7') {
+    if (argc == 0) {
         return;
     }
     SendPC("ECU ");
-    while (*cmd >= '0' && *cmd <= '7') {
-        id = 0;
-        for (i = 0; i < 4; i++) {
-            c = *cmd;
-            if (c >= 'a' && c <= 'f') {
-                c -= 0x27;
-            }
-            if (c >= 'A' && c <= 'F') {
-                c -= 7;
-            }
-            if (c < 0x30 || c > 0x3F) {
-                break;
-            }
-            id = (id << 4) | (int)(c & 0x0F);
-            cmd++;
-        }
-        if (i == 3 && id < CAN_ID_MAX) { // ID normal 
+    for (k = 0; k < argc; k++) {
+        if (argv[k].LEN == 3 && cmd_hex(argv[k].STR, 3, &id) == 3 && id < CAN_ID_MAX) { // ID normal 
             j       = 0;
             tx[j++] = HEX_CHAR[(id >> 8) & 0x0F];
             tx[j++] = HEX_CHAR[(id >> 4) & 0x0F];
@@ -2848,15 +3215,12 @@ void ecu_get_command(char *cmd)
                 tx[j++] = HEX_CHAR[(c >> 4) & 0x0F];
                 tx[j++] = HEX_CHAR[c & 0x0F];
             }
-            if (*cmd >= ' ') {
+            if (k + 1 < argc) {
                 tx[j++] = ' ';
             }
             tx[j++] = 0;
             SendPC(tx);
         }
-        while (*cmd == ' ') {
-            cmd++;
-        }
     }
     SendPC("\r");
 }
@@ -2868,7 +3232,8 @@ void ecu_get_command(char *cmd)
  *     ECU frame data rewriting
  *
  * Argument
- *     char *cmg Command string
+ *     int     argc  Number of tokens
+ *     CMD_ARG *argv Tokens of the command
  *
  * Description
  *     Rewrite frame data of specified ID
@@ -2876,92 +3241,29 @@ void ecu_get_command(char *cmd)
  * Return
  *     None
  *---------------------------------------------------------------------------------------*/
-void ecu_set_command(char *cmd)
+void ecu_set_command(int argc, CMD_ARG *argv)
 {
-    int i, j, f;
-    int id, tp;
-    int xid[32];
+    int i, k, tp;
     int xwp = 0;
-    char tx[39], c;
-    unsigned char d;
+    unsigned long id;
 
-    if (cmd == 0 || *cmd == 0) {
-        return;
-    }
-    while (*cmd == ' ') {
-        cmd++;
-    }
-    if (*cmd < '0' || *cmd > '7') {
-        return;
-    }
     // Rewriting process 
     tp = 0; // Initialize delay time 
-    while (*cmd >= '0' && *cmd <= '7') {
-        // Get target ID 
-        id = 0;
-        // Get binary data hexadecimal 3 digits (0x000 to FFF) from hexadecimal character string 
-        for (i = 0; i < 3; i++) {
-            c = *cmd;
-            if (c >= 'a' && c <= 'f') {
-                c -= 0x27;
-            }
-            if (c >= 'A' && c <= 'F') {
-                c -= 7;
-            }
-            if (c < 0x30 || c > 0x3F) {
-                break;
-            }
-            id = (id << 4) | (int)(c & 0x0F);
-            cmd++;
+    for (k = 0; k < argc; k++) {
+        // Get target ID (hexadecimal 3 digits) and up to 8 data bytes 
+        if (cmd_hex(argv[k].STR, 3, &id) != 3 || id >= CAN_ID_MAX) {
+            continue;
         }
-        // ID check 
-        if (i == 3 && id < CAN_ID_MAX) { // ID normal, data processing 
-            f = 0;
-            // Get binary data from hexadecimal string 
-            for (i = 0; i < 8; i++) {
-                c = *cmd;
-                if (c >= 'a' && c <= 'f') {
-                    c -= 0x27;
-                }
-                if (c >= 'A' && c <= 'F') {
-                    c -= 7;
-                }
-                if (c < 0x30 || c > 0x3F) {
-                    break;
-                }
-                d = (unsigned char)(c & 0x0F);
-                cmd++;
-                c = *cmd;
-                if (c >= 'a' && c <= 'f') {
-                    c -= 0x27;
-                }
-                if (c >= 'A' && c <= 'F') {
-                    c -= 7;
-                }
-                if (c < 0x30 || c > 0x3F) {
-                    break;
-                }
-                d = (d << 4) | (unsigned char)(c & 0x0F);
-                cmd++;
-                can_buf.ID[id].BYTE[i] = d;
-                f++;
+        i = cmd_hex_bytes(argv[k].STR + 3, argv[k].LEN - 3, can_buf.ID[id].BYTE, 8);
+        if (i > 0) { // With data rewriting 
+            CANID_DIRTY(id);
+            if (can_tp_job(-1, id, &can_buf.ID[id].BYTE) <= 0) { // Return as is 
+                tp += can_id_event(id, tp);
             }
-            if (f > 0) { // With data rewriting 
-                i = can_tp_job(-1, id, &can_buf.ID[id].BYTE);
-                if (i > 0) { // With response 
-                    xid[xwp++] = i;
-                } else { // Return as is 
-                    tp          += can_id_event(id, tp);
-                    xid[xwp++]  = id;
-                }
-                if (xwp >= 32) {
-                    break; // Quantity limit 
-                }
+            if (++xwp >= 32) {
+                break; // Quantity limit 
             }
         }
-        while (*cmd == ' ') {
-            cmd++;
-        }
     }
 }
 
@@ -2972,7 +3274,8 @@ void ecu_set_command(char *cmd)
  *     ECU frame data transmission
  *
  * Argument
- *     char *cmg Command string
+ *     int     argc  Number of tokens
+ *     CMD_ARG *argv Tokens of the command
  *
  * Description
  *     Rewrite frame data of specified ID
@@ -2980,93 +3283,37 @@ void ecu_set_command(char *cmd)
  * Return
  *     None
  *---------------------------------------------------------------------------------------*/
-void ecu_put_command(char *cmd)
+void ecu_put_command(int argc, CMD_ARG *argv)
 {
     ECU_CYC_EVE mbox;
-    int i, j, f;
-    int id, tp;
-    char c;
-    unsigned char d;
+    int i, k;
+    unsigned long id;
 
-    if (cmd == 0 || *cmd == 0) {
-        return;
-    }
-    while (*cmd == ' ') {
-        cmd++;
-    }
-    if (*cmd < '0' || *cmd > '7') {
-        return;
-    }
     // Rewriting process 
-    while (*cmd >= '0' && *cmd <= '7') {
-        // Get target ID 
-        id = 0;
-        for (i = 0; i < 3; i++) {
-            c = *cmd;
-            if (c >= 'a' && c <= 'f') {
-                c -= 0x27;
-            }
-            if (c >= 'A' && c <= 'F') {
-                c -= 7;
-            }
-            if (c < 0x30 || c > 0x3F) {
-                break;
-            }
-            id = (id << 4) | (int)(c & 0x0F);
-            cmd++;
-        }
-        if (i == 3 && id < CAN_ID_MAX) { // ID normal, data processing 
-            f = 0;
-            for (i = 0; i < 8; i++) {
-                c = *cmd;
-                if (c >= 'a' && c <= 'f') {
-                    c -= 0x27;
-                }
-                if (c >= 'A' && c <= 'F') {
-                    c -= 7;
-                }
-                if (c < 0x30 || c > 0x3F) {
-                    break;
-                }
-                d = (unsigned char)(c & 0x0F);
-                cmd++;
-                c = *cmd;
-                if (c >= 'a' && c <= 'f') {
-                    c -= 0x27;
-                }
-                if (c >= 'A' && c <= 'F') {
-                    c -= 7;
-                }
-                if (c < 0x30 || c > 0x3F) {
-                    break;
-                }
-                d = (d << 4) | (unsigned char)(c & 0x0F);
-                cmd++;
-                can_buf.ID[id].BYTE[i] = d;
-                f++;
-            }
-            if (f > 0) { // With data rewriting 
-                i = can_tp_job(-1, id, &can_buf.ID[id].BYTE);
-                if (i == 0) { // No response 
-                    mbox.ID.LONG    = 0;
-                    mbox.TIMER.LONG = 0;
-                    mbox.ID.BIT.SID = id;
-                    mbox.ID.BIT.ENB = 1;
-                    mbox.ID.BIT.DLC = f;
-                    can_send_proc(&mbox);
-                }
-            } else { // Remote frame issuance 
+    for (k = 0; k < argc; k++) {
+        // Get target ID (hexadecimal 3 digits) and up to 8 data bytes 
+        if (cmd_hex(argv[k].STR, 3, &id) != 3 || id >= CAN_ID_MAX) {
+            continue;
+        }
+        i = cmd_hex_bytes(argv[k].STR + 3, argv[k].LEN - 3, can_buf.ID[id].BYTE, 8);
+        if (i > 0) { // With data rewriting 
+            CANID_DIRTY(id);
+            if (can_tp_job(-1, id, &can_buf.ID[id].BYTE) == 0) { // No response 
                 mbox.ID.LONG    = 0;
                 mbox.TIMER.LONG = 0;
                 mbox.ID.BIT.SID = id;
                 mbox.ID.BIT.ENB = 1;
-                mbox.ID.BIT.RTR = 1;
-                mbox.ID.BIT.DLC = 8;
+                mbox.ID.BIT.DLC = i;
                 can_send_proc(&mbox);
             }
-        }
-        while (*cmd == ' ') {
-            cmd++;
+        } else { // Remote frame issuance 
+            mbox.ID.LONG    = 0;
+            mbox.TIMER.LONG = 0;
+            mbox.ID.BIT.SID = id;
+            mbox.ID.BIT.ENB = 1;
+            mbox.ID.BIT.RTR = 1;
+            mbox.ID.BIT.DLC = 8;
+            can_send_proc(&mbox);
         }
     }
 }
@@ -3093,6 +3340,7 @@ void ecu_put_message(int id, int size, unsigned char *buf)
     ECU_CYC_EVE mbox;
     if (id >= 0 && id < CAN_ID_MAX) { // ID normal, data processing 
         memcpy(can_buf.ID[id].BYTE, buf, size);
+        CANID_DIRTY(id);
         mbox.ID.LONG    = 0;
         mbox.TIMER.LONG = 0;
         mbox.ID.BIT.SID = id;
@@ -3109,7 +3357,8 @@ void ecu_put_message(int id, int size, unsigned char *buf)
  *     Updating external input information via communication
  *
  * Argument
- *     char *cmg Command string
+ *     int     argc  Number of tokens
+ *     CMD_ARG *argv Tokens of the command
  *
  * Description
  *     Rewrite data in specified input buffer
@@ -3117,60 +3366,446 @@ void ecu_put_message(int id, int size, unsigned char *buf)
  * Return
  *     None
 *---------------------------------------------------------------------------------------*/
-void ecu_input_update(char *cmd)
+void ecu_input_update(int argc, CMD_ARG *argv)
 {
-    int i, f;
-    int id;
-    char c;
-    unsigned long d;
+    int k, n;
+    unsigned long id, d;
 
-    if (cmd == 0 || *cmd == 0) {
-        return;
-    }
     // Rewriting process 
-    while (*cmd != 0) {
-        while (*cmd == ' ') {
-            cmd++;
+    for (k = 0; k < argc; k++) {
+        // Get target ID (hexadecimal 2 digits) and up to 8 data digits 
+        if (cmd_hex(argv[k].STR, 2, &id) != 2 || id >= EX_IO_MAX) {
+            break;
+        }
+        n = argv[k].LEN - 2;
+        if (n > 8) {
+            n = 8;
+        }
+        if (cmd_hex(argv[k].STR + 2, n, &d) > 0) { // With data rewriting 
+            exiosts.DATA[id].LONG = d;
+            EXIO_DIRTY(id);
         }
-        // Get target ID 
-        id = 0;
-        for (i = 0; i < 2; i++) {
-            c = *cmd;
-            if (c >= 'a' && c <= 'f') {
-                c -= 0x27;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_bin_command
+ * 
+ * Outline
+ *     Binary host protocol command processing
+ *
+ * Argument
+ *     unsigned char *msg Decoded frame [CMD][SEQ][records...] (CRC removed)
+ *     int  len           Frame bytes
+ *     unsigned char *rsp Reply buffer
+ *     int  max           Reply buffer size
+ *
+ * Description
+ *     Batch version of the SET / PUT / GET / EXD commands.
+ *     ID and data values are big-endian, PUT with DLC=0 issues a remote frame.
+ *     The reply is [CMD|0x80][SEQ][STATUS] followed by the GET / EXR / STS records.
+ *
+ * Return
+ *     int  Reply bytes (0:No reply)
+ *---------------------------------------------------------------------------------------*/
+ECU_BIN_STR ecu_bin;
+
+int ecu_bin_command(unsigned char *msg, int len, unsigned char *rsp, int max)
+{
+    ECU_CYC_EVE mbox;
+    TRACE_EVENT ev;
+    int i, n;
+    int id, tp;
+    int rp, wp, sts;
+    unsigned long d;
+
+    if (len < 2) {
+        ecu_bin.ERR++;
+        return 0;
+    }
+    rsp[0]  = msg[0] | ECU_BIN_ACK;
+    rsp[1]  = msg[1];
+    sts     = ECU_BIN_OK;
+    rp      = 2;
+    wp      = 3;
+    tp      = 0; // Initialize delay time 
+    switch (msg[0]) {
+    case ECU_BIN_SET: // [ID-H][ID-L][DLC][DATA x DLC]... 
+    case ECU_BIN_PUT:
+        while (rp < len) {
+            if (rp + 3 > len || msg[rp + 2] > 8 || rp + 3 + msg[rp + 2] > len) {
+                sts = ECU_BIN_FMT;
+                break;
             }
-            if (c >= 'A' && c <= 'F') {
-                c -= 7;
+            id  = ((int)msg[rp] << 8) | (int)msg[rp + 1];
+            n   = (int)msg[rp + 2];
+            rp  += 3;
+            if (id >= CAN_ID_MAX) {
+                sts = ECU_BIN_RNG;
+            } else if (n > 0) { // With data rewriting 
+                memcpy(can_buf.ID[id].BYTE, &msg[rp], n);
+                CANID_DIRTY(id);
+                i = can_tp_job(-1, id, &can_buf.ID[id].BYTE);
+                if (msg[0] == ECU_BIN_SET) {
+                    if (i <= 0) { // Return as is 
+                        tp += can_id_event(id, tp);
+                    }
+                } else if (i == 0) { // No response 
+                    mbox.ID.LONG    = 0;
+                    mbox.TIMER.LONG = 0;
+                    mbox.ID.BIT.SID = id;
+                    mbox.ID.BIT.ENB = 1;
+                    mbox.ID.BIT.DLC = n;
+                    can_send_proc(&mbox);
+                }
+            } else if (msg[0] == ECU_BIN_PUT) { // Remote frame issuance 
+                mbox.ID.LONG    = 0;
+                mbox.TIMER.LONG = 0;
+                mbox.ID.BIT.SID = id;
+                mbox.ID.BIT.ENB = 1;
+                mbox.ID.BIT.RTR = 1;
+                mbox.ID.BIT.DLC = 8;
+                can_send_proc(&mbox);
+            }
+            rp += n;
+            ecu_bin.REC++;
+        }
+        break;
+    case ECU_BIN_GET: // [ID-H][ID-L]... -> [ID-H][ID-L][8][DATA x 8]... 
+        for (; rp + 2 <= len; rp += 2) {
+            id = ((int)msg[rp] << 8) | (int)msg[rp + 1];
+            if (id >= CAN_ID_MAX) {
+                sts = ECU_BIN_RNG;
+                continue;
             }
-            if (c < 0x30 || c > 0x3F) {
+            if (wp + 11 > max) {
+                sts = ECU_BIN_OVF;
                 break;
             }
-            id = (id << 4) | (int)(c & 0x0F);
-            cmd++;
+            rsp[wp++] = (unsigned char)(id >> 8);
+            rsp[wp++] = (unsigned char)id;
+            rsp[wp++] = 8;
+            memcpy(&rsp[wp], can_buf.ID[id].BYTE, 8);
+            wp += 8;
+            ecu_bin.REC++;
+        }
+        if (sts == ECU_BIN_OK && rp < len) {
+            sts = ECU_BIN_FMT;
         }
-        if (i == 2 && id < EX_IO_MAX) { // ID normal, data processing 
-            f = 0;
+        break;
+    case ECU_BIN_EXD: // [IO][D31-24][D23-16][D15-8][D7-0]... 
+        for (; rp + 5 <= len; rp += 5) {
+            id = (int)msg[rp];
+            if (id >= EX_IO_MAX) {
+                sts = ECU_BIN_RNG;
+                continue;
+            }
             d = 0;
-            for (i = 0; i < 8; i++) {
-                c = *cmd;
-                if (c >= 'a' && c <= 'f') {
-                    c -= 0x27;
-                }
-                if (c >= 'A' && c <= 'F') {
-                    c -= 7;
-                }
-                if (c < 0x30 || c > 0x3F) {
-                    break;
+            for (i = 1; i <= 4; i++) {
+                d = (d << 8) | (unsigned long)msg[rp + i];
+            }
+            exiosts.DATA[id].LONG = d;
+            EXIO_DIRTY(id);
+            ecu_bin.REC++;
+        }
+        if (sts == ECU_BIN_OK && rp < len) {
+            sts = ECU_BIN_FMT;
+        }
+        break;
+    case ECU_BIN_EXR: // [IO]... -> [IO][D31-24][D23-16][D15-8][D7-0]... 
+        for (; rp < len; rp++) {
+            id = (int)msg[rp];
+            if (id >= EX_IO_MAX) {
+                sts = ECU_BIN_RNG;
+                continue;
+            }
+            if (wp + 5 > max) {
+                sts = ECU_BIN_OVF;
+                break;
+            }
+            d           = exiosts.DATA[id].LONG;
+            rsp[wp++]   = (unsigned char)id;
+            for (i = 24; i >= 0; i -= 8) {
+                rsp[wp++] = (unsigned char)(d >> i);
+            }
+            ecu_bin.REC++;
+        }
+        break;
+    case ECU_BIN_STS: // -> [UNIT][RXF x 4][REC x 4][ERR x 4][OVF x 4][TXD x 4] 
+        rsp[wp++] = (unsigned char)SELECT_ECU_UNIT;
+        for (n = 0; n < 5; n++) {
+            d = (n == 0) ? ecu_bin.RXF : (n == 1) ? ecu_bin.REC : (n == 2) ? ecu_bin.ERR :
+                (n == 3) ? ecu_bin.OVF : ecu_bin.TXD;
+            for (i = 24; i >= 0; i -= 8) {
+                rsp[wp++] = (unsigned char)(d >> i);
+            }
+        }
+        break;
+    case ECU_BIN_TRC: // -> [LOST x 4]([EVT x 2][SUB x 2][TIM x 4][A x 4][B x 4])... 
+        for (i = 24; i >= 0; i -= 8) {
+            rsp[wp++] = (unsigned char)(trace.LOST >> i);
+        }
+        while (wp + 16 <= max && trace_get(&ev) != 0) {
+            rsp[wp++] = (unsigned char)(ev.EVT >> 8);
+            rsp[wp++] = (unsigned char)ev.EVT;
+            rsp[wp++] = (unsigned char)(ev.SUB >> 8);
+            rsp[wp++] = (unsigned char)ev.SUB;
+            for (n = 0; n < 3; n++) {
+                d = (n == 0) ? ev.TIM : (n == 1) ? ev.A : ev.B;
+                for (i = 24; i >= 0; i -= 8) {
+                    rsp[wp++] = (unsigned char)(d >> i);
                 }
-                d = (d << 4) | (unsigned char)(c & 0x0F);
-                cmd++;
-                f++;
             }
-            if (f > 0) { // With data rewriting 
-            	exiosts.DATA[id].LONG = d;
+            ecu_bin.REC++;
+        }
+        break;
+    default:
+        sts = ECU_BIN_CMD;
+        break;
+    }
+    rsp[2] = (unsigned char)sts;
+    return wp;
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_bin_encode
+ * 
+ * Outline
+ *     Binary host protocol frame encoding
+ *
+ * Argument
+ *     unsigned char *raw Frame [CMD][SEQ]... (4 spare bytes are used for the CRC32)
+ *     int  n             Frame bytes
+ *     unsigned char *txd Output (n + n / 254 + 7 bytes)
+ *
+ * Description
+ *     Appends the CRC32 (big-endian) and COBS encodes the frame between 0x00 delimiters.
+ *
+ * Return
+ *     int  Output bytes
+ *---------------------------------------------------------------------------------------*/
+int ecu_bin_encode(unsigned char *raw, int n, unsigned char *txd)
+{
+    unsigned long   sum;
+    int             i, rp, wp, cp;
+
+    sum = uds_crc32(0xFFFFFFFFul, raw, n) ^ 0xFFFFFFFFul;
+    for (i = 24; i >= 0; i -= 8) {
+        raw[n++] = (unsigned char)(sum >> i);
+    }
+    // COBS encoding 
+    txd[0]  = 0;
+    cp      = 1;
+    wp      = 2;
+    txd[cp] = 1;
+    for (rp = 0; rp < n; rp++) {
+        if (raw[rp] == 0) {
+            cp      = wp++;
+            txd[cp] = 1;
+        } else {
+            txd[wp++] = raw[rp];
+            if (++txd[cp] == 0xFF) {
+                cp      = wp++;
+                txd[cp] = 1;
+            }
+        }
+    }
+    txd[wp++] = 0;
+    return wp;
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_bin_frame
+ * 
+ * Outline
+ *     Binary host protocol frame reception
+ *
+ * Argument
+ *     int  ch            SCI channel of the reply
+ *     unsigned char *buf COBS encoded frame (without 0x00 delimiters, decoded in place)
+ *     int  len           Frame bytes
+ *
+ * Description
+ *     Decodes the frame, checks the CRC32 (same polynomial as the UDS image check)
+ *     and sends the COBS encoded reply between 0x00 delimiters.
+ *     Frames with a COBS or CRC error are counted and discarded without a reply,
+ *     a reply that does not fit in the transmission buffer is counted and dropped.
+ *
+ * Return
+ *     None
+ *---------------------------------------------------------------------------------------*/
+void ecu_bin_frame(int ch, unsigned char *buf, int len)
+{
+    static unsigned char    rsp[ECU_BIN_MAX];
+    static unsigned char    txd[ECU_BIN_MAX + ECU_BIN_MAX / 254 + 4];
+    unsigned long           sum;
+    int                     i, n, rp, wp;
+
+    // COBS decoding (the output never overtakes the input) 
+    rp = 0;
+    wp = 0;
+    while (rp < len) {
+        n = (int)buf[rp++];
+        if (n == 0 || rp + n - 1 > len) {
+            ecu_bin.ERR++;
+            return;
+        }
+        for (i = 1; i < n; i++) {
+            buf[wp++] = buf[rp++];
+        }
+        if (n < 0xFF && rp < len) {
+            buf[wp++] = 0;
+        }
+    }
+    // CRC check 
+    if (wp < 6) {
+        ecu_bin.ERR++;
+        return;
+    }
+    wp  -= 4;
+    sum = uds_crc32(0xFFFFFFFFul, buf, wp) ^ 0xFFFFFFFFul;
+    if (sum != (((unsigned long)buf[wp] << 24) | ((unsigned long)buf[wp + 1] << 16) |
+                ((unsigned long)buf[wp + 2] << 8) | (unsigned long)buf[wp + 3])) {
+        ecu_bin.ERR++;
+        return;
+    }
+    ecu_bin.RXF++;
+    n = ecu_bin_command(buf, wp, rsp, ECU_BIN_MAX - 4);
+    if (n == 0) {
+        return;
+    }
+    wp = ecu_bin_encode(rsp, n, txd);
+    if (sci_putcheck(ch) <= wp) { // A partial frame is never sent 
+        ecu_bin.TXD++;
+        return;
+    }
+    sci_putb(ch, txd, wp);
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_stat_value
+ * 
+ * Outline
+ *     External I/O value notified to the LCD / simulator
+ *
+ * Argument
+ *     int  id            External I/O number
+ *
+ * Return
+ *     int  Notification value
+ *---------------------------------------------------------------------------------------*/
+int ecu_stat_value(int id)
+{
+    int k = exiosts.DATA[id].INTE;
+
+    if (SELECT_ECU_UNIT == ECU_UNIT_CHASSIS) {
+        if (ds_conect_active[0] >= ECU_OPMODE_5) { // Chassis only DS(VI) mode 
+            if (id == VI_POWERTRAIN_SPEED) { // copy speed value 
+                k = exiosts.DATA[VI_POWERTRAIN_RPM].INTE & 0xFFFF;
+            } else if (id == VI_POWERTRAIN_RPM) { // update request 
+                exio_chg[VI_POWERTRAIN_SPEED]++;
             }
+        }
+    }
+    return k;
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_stat_varint
+ * 
+ * Outline
+ *     Unsigned LEB128 encoding (7 bits per byte, low group first, bit7=continuation)
+ *
+ * Return
+ *     int  Next write position
+ *---------------------------------------------------------------------------------------*/
+int ecu_stat_varint(unsigned char *buf, int wp, unsigned long v)
+{
+    while (v >= 0x80) {
+        buf[wp++]   = (unsigned char)(v | 0x80);
+        v           >>= 7;
+    }
+    buf[wp++] = (unsigned char)v;
+    return wp;
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_stat_frame
+ * 
+ * Outline
+ *     Binary EXU status stream frame creation
+ *
+ * Argument
+ *     unsigned char *txd Output (stat_line)
+ *
+ * Description
+ *     Collects changed I/O from stat_update_id as [IO varint][value varint] records.
+ *     Delta frames carry zigzag(value - last sent value) and skip unchanged values,
+ *     keyframes carry the absolute value of every listed I/O.
+ *     SEQ counts every frame, so a receiver that sees a gap or a CRC error discards
+ *     its state until the next keyframe.
+ *
+ * Return
+ *     int  Output bytes (0:No changed value)
+ *---------------------------------------------------------------------------------------*/
+int ecu_stat_frame(unsigned char *txd)
+{
+    unsigned char   raw[STAT_BIN_MAX + 4];
+    unsigned long   v, d;
+    int             id, n;
+
+    raw[0]  = ECU_BIN_EXU | ECU_BIN_ACK;
+    raw[1]  = stat_seq;
+    raw[2]  = (stat_key != 0) ? ECU_BIN_EXU_KEY : ECU_BIN_EXU_DELTA;
+    n       = 3;
+    for (; n + 6 <= STAT_BIN_MAX && stat_update_id < EX_IO_MAX; stat_update_id++) {
+        id = stat_update_id;
+        if (exio_chg[id] == 0) {
+            continue;
+        }
+        exio_chg[id] = 0;
+        v = (unsigned long)ecu_stat_value(id) & 0xFFFFFFFFul;
+        d = (v - stat_sent[id]) & 0xFFFFFFFFul;
+        if (stat_key == 0) {
+            if (d == 0) {
+                continue; // Unchanged value 
+            }
+            d = ((d << 1) ^ ((d & 0x80000000ul) ? 0xFFFFFFFFul : 0)) & 0xFFFFFFFFul; // zigzag 
         } else {
-            break;
+            d = v;
         }
+        stat_sent[id]   = v;
+        n               = ecu_stat_varint(raw, n, (unsigned long)id);
+        n               = ecu_stat_varint(raw, n, d);
+    }
+    if (n == 3) {
+        return 0;
+    }
+    stat_seq++;
+    return ecu_bin_encode(raw, n, txd);
+}
+
+/* ---------------------------------------------------------------------------------------
+ * ecu_stat_mode
+ * 
+ * Outline
+ *     LCD / simulator notification format selection
+ *
+ * Argument
+ *     int  mode          0:EXU text  1:Binary delta stream  -1:Query only
+ *
+ * Description
+ *     Changing the format restarts with a full transmission (keyframe).
+ *
+ * Return
+ *     int  Current format
+ *---------------------------------------------------------------------------------------*/
+int ecu_stat_mode(int mode)
+{
+    if (mode >= 0 && (mode != 0) != (stat_bin != 0)) {
+        stat_bin        = (mode != 0) ? 1 : 0;
+        stat_update_id  = EX_IO_MAX;        // Abort the running sweep 
+        status_timer    = STAT_KEY_TIME;    // Full transmission at the next cycle 
     }
+    return stat_bin;
 }
@@ -327,6 +327,21 @@ extern EXTERNUL_IO  ext_list[ECU_EXT_MAX];
 extern int          ext_list_count; // Number of registered external I/O processes 
 extern short        ds_conect_active[2]; //	DS Connection flag
 
+/* External I/O update requests
+ * extern_io_update_ex processes only the checklist entries whose I/O number or CAN-ID
+ * is marked. Set EXIO_DIRTY / CANID_DIRTY after writing exiosts / can_buf, and
+ * EXT_RESCAN after changing ext_list (recompiled, all entries are processed once).*/
+extern unsigned long exio_dirty[(EX_IO_MAX + 31) / 32];       // Changed exiosts.DATA[] 
+extern unsigned long canid_dirty[CAN_ID_MAX / 32];            // Changed can_buf.ID[] 
+extern unsigned long canid_dirty_sum[(CAN_ID_MAX / 32 + 31) / 32]; // Non-zero canid_dirty words 
+extern int           ext_rescan;                              // Checklist changed 
+extern unsigned char ext_id_ofs[CAN_ID_MAX + 1];              // CAN-ID -> entries : ext_id_slot[ofs[id]..ofs[id+1]-1] 
+extern unsigned char ext_id_slot[ECU_EXT_MAX];                // Entry -> CAN-ID : ext_list[].SID 
+#define EXIO_DIRTY(n)   (exio_dirty[(n) >> 5] |= 1ul << ((n) & 31))
+#define CANID_DIRTY(id) (canid_dirty[(id) >> 5] |= 1ul << ((id) & 31), \
+                         canid_dirty_sum[(id) >> 10] |= 1ul << (((id) >> 5) & 31))
+#define EXT_RESCAN()    (ext_rescan |= 1)  // Recompile and process all entries 
+
 /* Variable on RAM
  * Time-up waiting buffer*/
 extern CYCLE_EVENTS wait_tup; // Cycle/event wait variable 
@@ -365,13 +380,198 @@ extern int              led_monit_time; // Average time
 extern int              led_monit_count; // Number of averaging 
 extern int              led_monit_sample; // Number of samples 
 
-// E2DATA flash definition 
+// E2DATA flash definition (slot 0 : BLOCK_DB0 to BLOCK_DB2) 
 #define ADDRESS_OF_ROOTMAP \
-    0x00100000 // Route map    2048byte   0x00100000 to 0x001007FF 
+    0x00100000 // Route map    2048byte   0x00100000 to 0x001007FF (BLOCK_DB0) 
 #define ADDRESS_OF_CYCEVE \
-    0x00100800 // Period/Event 2048byte   0x00100800 to 0x00100FFF 
+    0x00100800 // Period/Event 2048byte   0x00100800 to 0x00100FFF (BLOCK_DB1) 
 #define ADDRESS_OF_IOLIST \
-    0x00101000 // I/O check     272byte   0x00101000 to 0x001017FF 
+    0x00101000 // I/O check    2048byte   0x00101000 to 0x001017FF (BLOCK_DB2) 
+#define ADDRESS_OF_JOURNAL \
+    0x00103000 // Journal    2*2048byte   0x00103000 to 0x00103FFF (BLOCK_DB6 / BLOCK_DB7) 
+#define ADDRESS_OF_SLOT1 \
+    0x00104000 // Slot 1     3*2048byte   0x00104000 to 0x001057FF (BLOCK_DB8 to BLOCK_DB10) 
+#define ADDRESS_OF_SLOTHDR \
+    0x00105800 // Slot header 2*2048byte  0x00105800 to 0x001067FF (BLOCK_DB11 / BLOCK_DB12) 
+
+/* ---------------------------------------------------------------------------------------
+ * Configuration slots
+ *
+ *  The image is saved in one of two slots, slot 0 (BLOCK_DB0 to BLOCK_DB2) or slot 1
+ *  (BLOCK_DB8 to BLOCK_DB10). A full image is always written to the inactive slot,
+ *  followed by its header (generation counter and CRC32 of the image), so the active
+ *  slot stays intact until the new header is in place. ecu_config_load uses the valid
+ *  slot with the newest generation. Slot 0 without any header (saved by an older
+ *  firmware) is used as generation 0.
+ * --------------------------------------------------------------------------------------- */
+#define ECU_CFG_SLOTS       2
+#define ECU_CFG_BLOCK(s)    ((s) ? BLOCK_DB8 : BLOCK_DB0) // First image block of a slot 
+#define ECU_CFG_HDR_BLOCK   BLOCK_DB11  // Header blocks BLOCK_DB11 / BLOCK_DB12 
+#define ECU_CFG_MAGIC       0x43464731  // "CFG1" 
+#define ECU_CFG_UNIT        128         // Bytes per image write 
+
+typedef struct __ecu_cfg_hdr__ {
+    unsigned long   MAGIC;  // ECU_CFG_MAGIC 
+    unsigned long   GEN;    // Generation counter 
+    unsigned long   SUM;    // CRC32 of the image 
+    unsigned long   CHK;    // ~(MAGIC ^ GEN ^ SUM) 
+} ECU_CFG_HDR;
+
+typedef struct __ecu_cfg_str__ {
+    int             ACT;    // Active slot (-1=No saved image) 
+    unsigned long   GEN;    // Generation of the active slot 
+    unsigned long   SUM;    // CRC32 of the image being written 
+    ECU_CFG_HDR     HDR;    // Header write buffer 
+    unsigned char   BUF[ECU_CFG_UNIT]; // Image write buffer 
+} ECU_CFG_STR;
+
+extern ECU_CFG_STR  ecu_cfg;    // Configuration slots 
+
+/* ---------------------------------------------------------------------------------------
+ * Configuration journal
+ *
+ *  The saved image is the routing map, cycle/event list and I/O checklist blocks
+ *  of the active slot seen as one 6KB image of 8 byte chunks.
+ *  A save appends one record per changed chunk to the journal instead of erasing
+ *  and rewriting the blocks. A full journal block is compacted into the other
+ *  journal block (live chunks only, closed by a commit record); only when the
+ *  live chunks no longer fit is a new image written to the inactive slot.
+ *  Records carry the generation of their slot, so the journal of the previous
+ *  slot is ignored after a switch. ecu_config_load replays the journal over the image.
+ * --------------------------------------------------------------------------------------- */
+#define ECU_IMAGE_BLOCK     2048    // Bytes per image block 
+#define ECU_JNL_UNIT        8       // Bytes per chunk 
+#define ECU_JNL_CHUNKS      (3 * ECU_IMAGE_BLOCK / ECU_JNL_UNIT) // Chunks in the image 
+#define ECU_JNL_BLOCK       BLOCK_DB6   // Journal blocks BLOCK_DB6 / BLOCK_DB7 
+#define ECU_JNL_SLOTS       (2048 / sizeof(ECU_JNL_REC)) // Records per journal block 
+#define ECU_JNL_MARK        0xC0    // Chunk record 
+#define ECU_JNL_COMMIT      0xC1    // Compaction completed record 
+
+typedef struct __ecu_journal_rec__ {
+    unsigned char   FLAG;               // ECU_JNL_MARK / ECU_JNL_COMMIT (first, never 0xFF : blank check) 
+    unsigned char   GEN;                // Generation of the slot (lower 8 bits) 
+    unsigned short  CHUNK;              // Chunk number 
+    unsigned short  SEQ;                // Record sequence number 
+    unsigned char   DATA[ECU_JNL_UNIT]; // Chunk data 
+    unsigned short  SUM;                // Check sum (written last) 
+} ECU_JNL_REC;
+
+typedef struct __ecu_journal_str__ {
+    int             BLK;    // Write block (0/1) 
+    int             SLOT;   // Next free slot 
+    unsigned short  SEQ;    // Last sequence number 
+    unsigned short  IDX[ECU_JNL_CHUNKS]; // Latest record of each chunk (0=Image block / block*SLOTS+slot+1) 
+    ECU_JNL_REC     BUF;    // Write buffer 
+} ECU_JNL_STR;
+
+extern ECU_JNL_STR  ecu_jnl;    // Configuration journal 
+
+/* ---------------------------------------------------------------------------------------
+ * Data flash job queue (saves / erases processed from the main loop in BGO mode)
+ * --------------------------------------------------------------------------------------- */
+#define ECU_FJ_QUEUE        4       // Queue depth 
+#define ECU_FJ_SAVE         1       // Save ECU_DATA_xxx blocks 
+#define ECU_FJ_ERASE        2       // Erase configuration slots and journal 
+
+#define ECU_FS_IDLE         0       // No job running 
+#define ECU_FS_RUN          1       // Job running 
+#define ECU_FS_WAIT         2       // Waiting for the FCU ready interrupt 
+
+#define ECU_FJ_START        0       // Select the save method 
+#define ECU_FJ_APPEND       1       // Append changed chunks to the journal 
+#define ECU_FJ_CPT_ERASE    2       // Compaction : erase the other journal block 
+#define ECU_FJ_CPT_COPY     3       // Compaction : copy the live chunks 
+#define ECU_FJ_CPT_COMMIT   4       // Compaction : commit record 
+#define ECU_FJ_CPT_DROP     5       // Compaction : erase the old journal block 
+#define ECU_FJ_JNL_DROP     6       // Erase the journal of the previous slot 
+#define ECU_FJ_IMG_ERASE    7       // New slot : erase an image block 
+#define ECU_FJ_IMG_WRITE    8       // New slot : write the image 
+#define ECU_FJ_ALL_ERASE    9       // Erase configuration slots and journal 
+#define ECU_FJ_HDR_ERASE    10      // New slot : erase the header 
+#define ECU_FJ_HDR_WRITE    11      // New slot : write the header (switch) 
+#define ECU_FJ_JNL_ERASE    12      // First slot : erase the journal left by lost slots 
+
+typedef struct __ecu_flash_job__ {
+    int             CMD;    // ECU_FJ_SAVE / ECU_FJ_ERASE 
+    int             ARG;    // ECU_DATA_xxx 
+} ECU_FJOB;
+
+typedef struct __ecu_flash_job_str__ {
+    int             STAT;   // ECU_FS_xxx 
+    int             STEP;   // ECU_FJ_START.. 
+    int             CNT;    // Queued jobs 
+    int             RP;     // Queue read position 
+    int             WP;     // Queue write position 
+    ECU_FJOB        Q[ECU_FJ_QUEUE];
+    ECU_FJOB        CUR;    // Running job 
+    int             POS;    // Chunk / block / image offset 
+    int             NUM;    // Records copied by the compaction 
+    int             RES;    // Result bits of the running job 
+    volatile unsigned char BGO; // Operation result (FLASH_BUSY while running) 
+    ECU_FJOB        LAST;   // Last completed job 
+    int             LRES;   // Result bits of the last completed job 
+    unsigned short  SEQ;    // Completed job counter 
+} ECU_FJ_STR;
+
+extern ECU_FJ_STR   ecu_fjob;   // Data flash job queue 
+
+/* ---------------------------------------------------------------------------------------
+ * Console command argument (converted by command_job before the handler is called)
+ * --------------------------------------------------------------------------------------- */
+#define CMD_ARG_MAX         64      // Arguments per command 
+
+typedef struct __console_argument__ {
+    char *          STR;    // Token top (not 0 terminated) 
+    int             LEN;    // Token characters 
+    long            VAL;    // Converted value (x:Hexadecimal / d:Decimal format) 
+} CMD_ARG;
+
+extern int cmd_hex(const char *s, int n, unsigned long *val);
+extern int cmd_hex_bytes(const char *s, int n, unsigned char *d, int max);
+extern int cmd_dec(const char *s, int n, long *val);
+
+/* ---------------------------------------------------------------------------------------
+ * Binary host protocol (COBS framed between 0x00 delimiters, CRC32 checked)
+ *   Frame   : 0x00 COBS([CMD][SEQ][records...][CRC32 big-endian]) 0x00
+ *   Reply   : 0x00 COBS([CMD|0x80][SEQ][STATUS][records...][CRC32 big-endian]) 0x00
+ * --------------------------------------------------------------------------------------- */
+#define ECU_BIN_MAX         512     // Frame bytes (COBS encoded) 
+#define ECU_BIN_SET         0x01    // [ID-H][ID-L][DLC][DATA]...  Rewrite frame data (SET) 
+#define ECU_BIN_PUT         0x02    // [ID-H][ID-L][DLC][DATA]...  Direct transmission (PUT) 
+#define ECU_BIN_GET         0x03    // [ID-H][ID-L]...             Frame data acquisition (GET) 
+#define ECU_BIN_EXD         0x04    // [IO][D31..D0]...            External input update (EXD) 
+#define ECU_BIN_EXR         0x05    // [IO]...                     External I/O acquisition 
+#define ECU_BIN_STS         0x06    // None                        Protocol status 
+#define ECU_BIN_TRC         0x07    // None                        Event trace pull 
+#define ECU_BIN_EXU         0x08    // (ECU -> host only)          EXU binary status stream 
+#define ECU_BIN_ACK         0x80    // Reply command flag 
+
+#define ECU_BIN_OK          0x00    // Normal end 
+#define ECU_BIN_FMT         0x01    // Record length error (remaining records ignored) 
+#define ECU_BIN_CMD         0x02    // Unknown command 
+#define ECU_BIN_RNG         0x03    // ID out of range (record skipped) 
+#define ECU_BIN_OVF         0x04    // Reply buffer full (remaining records ignored) 
+
+/*
+ *   EXU stream : 0x00 COBS([0x88][SEQ][TYPE]([IO varint][VALUE varint])...[CRC32]) 0x00
+ *                TYPE 0:delta VALUE=zigzag(value - last sent value)  1:keyframe VALUE=value
+ *                SEQ counts every frame, a gap means the deltas are lost until the next keyframe
+ */
+#define ECU_BIN_EXU_DELTA   0x00    // Changed values only 
+#define ECU_BIN_EXU_KEY     0x01    // Absolute values of all listed I/O 
+#define STAT_BIN_MAX        96      // EXU stream frame bytes before COBS (fits stat_line) 
+#define STAT_KEY_TIME       2000    // EXU stream keyframe cycle (ms) 
+#define ECU_DUMP_LINE       128     // Parameter dump line (EL / ES / EW) 
+
+typedef struct __ecu_binary_protocol_str__ {
+    unsigned long   RXF;    // Frames received 
+    unsigned long   REC;    // Records processed 
+    unsigned long   ERR;    // COBS / CRC / length errors 
+    unsigned long   OVF;    // Receive buffer overflows 
+    unsigned long   TXD;    // Replies dropped (transmission buffer full) 
+} ECU_BIN_STR;
+
+extern ECU_BIN_STR  ecu_bin;    // Binary host protocol counters 
 
 /* ---------------------------------------------------------------------------------------
  * CARLA mode selection setting 2021/02/22
@@ -383,6 +583,7 @@ extern int              led_monit_sample; // Number of samples
 #define		ECU_OPMODE_4		4		/*	CARLA.C -> RS232C -> ECU.C -> CAN.BUS -> ECU.P.B -> RS232C -> CARLA.P.B	*/
 #define		ECU_OPMODE_5		5		/*	Vi Mode Phase1 DS mode	*/
 #define		ECU_OPMODE_6		6		/*	Vi Mode Phase1 DS mode	*/
+#define		ECU_OPMODE_MAX		7
 
 typedef	struct	__ecu_opemode_str__
 {
@@ -478,6 +679,21 @@ extern int can_id_event(int id, int tp);
  *     Delete data waiting for periodic event time-up
  * --------------------------------------------------------------------------------------- */
 extern void delete_waiting_list(int id);
+/* ---------------------------------------------------------------------------------------
+ * Outline
+ *     Rebuilding of configuration derived information (chain, conversion table, mask)
+ * --------------------------------------------------------------------------------------- */
+extern void ecu_config_index(void);
+/* ---------------------------------------------------------------------------------------
+ * Outline
+ *     Loading of configuration from data flash (or initial value)
+ * --------------------------------------------------------------------------------------- */
+extern int ecu_config_load(void);
+/* ---------------------------------------------------------------------------------------
+ * Outline
+ *     Start of periodic / event transmission
+ * --------------------------------------------------------------------------------------- */
+extern void ecu_event_start(void);
 /* ----------------------------------------------------------------------------------------
  * BootCopy processing
  * ---------------------------------------------------------------------------------------- */
@@ -487,6 +703,32 @@ extern int  bootclear(void);
  * Batch storage of ECU operation data
  * ---------------------------------------------------------------------------------------- */
 extern int ecu_data_write(void);
+/* ----------------------------------------------------------------------------------------
+ * Selective storage of ECU operation data
+ * ---------------------------------------------------------------------------------------- */
+#define ECU_DATA_MAP  0x01 // Routing map 
+#define ECU_DATA_CONF 0x02 // Cycle / event list 
+#define ECU_DATA_IO   0x04 // I/O checklist 
+#define ECU_DATA_ALL  (ECU_DATA_MAP | ECU_DATA_CONF | ECU_DATA_IO)
+extern int ecu_data_save(int msk);
+/* ----------------------------------------------------------------------------------------
+ * Configuration journal replay (call after reading the image blocks)
+ * ---------------------------------------------------------------------------------------- */
+extern void ecu_jnl_load(void);
+/* ----------------------------------------------------------------------------------------
+ * Configuration journal variable initialization
+ * ---------------------------------------------------------------------------------------- */
+extern void ecu_jnl_init(void);
+/* ----------------------------------------------------------------------------------------
+ * Configuration slot selection (newest valid slot, -1=No saved image)
+ * ---------------------------------------------------------------------------------------- */
+extern unsigned long ecu_cfg_addr(int slot);
+extern int  ecu_cfg_select(void);
+/* ----------------------------------------------------------------------------------------
+ * Data flash job request / processing (call ecu_flash_job from main loop)
+ * ---------------------------------------------------------------------------------------- */
+extern int  ecu_flash_request(int cmd, int arg);
+extern void ecu_flash_job(void);
 /* ----------------------------------------------------------------------------------------
  * Batch deletion of ECU operation data
  * ---------------------------------------------------------------------------------------- */
@@ -495,6 +737,19 @@ extern int ecu_data_erase(void);
  * Check the writing status of ECU operation data
  * ---------------------------------------------------------------------------------------- */
 extern int ecu_data_check(void);
+/* ----------------------------------------------------------------------------------------
+ * Binary host protocol frame processing (COBS encoded frame without delimiters)
+ * ---------------------------------------------------------------------------------------- */
+extern int  ecu_bin_command(unsigned char *msg, int len, unsigned char *rsp, int max);
+extern void ecu_bin_frame(int ch, unsigned char *buf, int len);
+extern int  ecu_bin_encode(unsigned char *raw, int n, unsigned char *txd);
+/* ----------------------------------------------------------------------------------------
+ * LCD / simulator status notification (EXU text or binary delta stream)
+ * ---------------------------------------------------------------------------------------- */
+extern int  ecu_stat_value(int id);
+extern int  ecu_stat_varint(unsigned char *buf, int wp, unsigned long v);
+extern int  ecu_stat_frame(unsigned char *txd);
+extern int  ecu_stat_mode(int mode);
 
 /* ----------------------------------------------------------------------------------------
  * Time difference measurement function between sending and receiving
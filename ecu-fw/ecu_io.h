@@ -862,6 +862,28 @@ typedef union __ext_io_status__ {
 // External I/O device status 
 extern EXT_IO_STATUS exiosts;
 
+// External I/O checklist operation (compiled from ext_list by extern_io_compile) 
+#define EXT_OP_IN_BIT       0   // Mode 0 : I/O B0 -> frame bit 
+#define EXT_OP_IN_BYTE      1   // Mode 1 : I/O BYTE[0] -> frame byte 
+#define EXT_OP_IN_WORD      2   // Mode 2 : I/O WORD[0] -> frame 2byte (big endian) 
+#define EXT_OP_IN_LONG      3   // Mode 3 : I/O LONG -> frame 4byte (big endian) 
+#define EXT_OP_OUT_BIT      4   // Mode 4 : frame bit -> I/O B0 
+#define EXT_OP_OUT_BYTE     5   // Mode 5 : frame byte -> I/O BYTE[0] 
+#define EXT_OP_OUT_WORD     6   // Mode 6 : frame 2byte -> I/O WORD[0] 
+#define EXT_OP_OUT_LONG     7   // Mode 7 : frame 4byte -> I/O LONG 
+#define EXT_OP_NONE         8   // Disable / out of range 
+
+typedef struct __ext_io_operation__ {
+    unsigned char   *FRM;       // Frame data (&can_buf.ID[SID].BYTE[BPOS]) 
+    EX_IO_MEM       *IO;        // I/O status (&exiosts.DATA[NOM]) 
+    short           SID;        // CAN-ID 
+    unsigned char   OP;         // EXT_OP_xxx 
+    unsigned char   MSK;        // Bit mask 
+    unsigned char   NOM;        // I/O number 
+} EXT_IO_OP;
+
+extern EXT_IO_OP ext_op[];
+
 // Digital bit input 
 #define X_DB_0 PORTC.PIDR.BIT.B0  // CN6-19(IRQ14)  PC0 
 #define X_DB_1 PORTC.PIDR.BIT.B1  // CN6-20(IRQ12)  PC1 
@@ -53,6 +53,11 @@ uint16_t gNumFlashBlocks = sizeof(g_flash_BlockAddresses)/4u;
 // Switch callback function prototype delcaration
 void CB_Switch(void);
 
+// Result of the last background (FRDYI) operation 0=Success / Other=Failure 
+volatile uint8_t gFlashBgoResult = FLASH_SUCCESS;
+// Result of the last background blank check (FLASH_BLANK / FLASH_NOT_BLANK) 
+volatile uint8_t gFlashBgoBlank = FLASH_BLANK;
+
 void Exit_FlashData(void)
 {
     // Enable MCU access to the flash data area 
@@ -119,10 +124,7 @@ void Erase_FlashData(void)
         }
 
         // Check Blank Checking 
-        ret |=  R_FlashDataAreaBlankCheck(
-                    address,
-                    BLANK_CHECK_ENTIRE_BLOCK
-        );
+        ret |=  BlankCheck_FlashData(address);
 
         // Halt here if check was unsuccessful 
         while (R_FlashGetStatus() != FLASH_SUCCESS) {
@@ -177,8 +179,220 @@ int Write_FlashData(void)
                 (uint16_t)num_bytes
     );
 
+    // Wait for the end of writing (BGO) 
+    ret |= Wait_FlashData();
+
     // Compare memory locations to verify written data 
     ret |= memcmp(gFlashWriteBuffer, flash_ptr, (size_t)num_bytes);
 
     return ret;
 }
+
+/* ---------------------------------------------------------------------------------------
+* Wait_FlashData
+*
+* Description
+*     This function waits until the flash API is idle. When DATA_FLASH_BGO
+*     is enabled the data flash operations only start in the API call and
+*     finish in the flash ready interrupt, so the result is taken from the
+*     callback functions below.
+*
+* Argument
+*     None
+*
+* Return
+*     uint8_t   FLASH_SUCCESS / FLASH_FAILURE
+* ---------------------------------------------------------------------------------------*/
+uint8_t Wait_FlashData(void)
+{
+    // Halt here until the running operation is finished 
+    while (R_FlashGetStatus() != FLASH_SUCCESS) {
+        ;
+    }
+#ifdef DATA_FLASH_BGO
+    return gFlashBgoResult;
+#else
+    return FLASH_SUCCESS;
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------
+* BlankCheck_FlashData
+*
+* Description
+*     This function performs a blank check of an entire data flash block
+*     and waits for the result regardless of the BGO setting.
+*
+* Argument
+*     address   Any address in the data flash block (or block number)
+*
+* Return
+*     uint8_t   FLASH_BLANK / FLASH_NOT_BLANK / FLASH_FAILURE
+* ---------------------------------------------------------------------------------------*/
+uint8_t BlankCheck_FlashData(uint32_t address)
+{
+    // Declare flash API result variable 
+    uint8_t ret;
+
+    // Wait for the previous operation 
+    Wait_FlashData();
+
+    // Start blank check 
+    ret = R_FlashDataAreaBlankCheck(address, BLANK_CHECK_ENTIRE_BLOCK);
+#ifdef DATA_FLASH_BGO
+    if (ret != FLASH_BLANK) { // Not started 
+        return FLASH_FAILURE;
+    }
+    // Result is notified by FlashBlankCheckDone() 
+    if (Wait_FlashData() != FLASH_SUCCESS) {
+        return FLASH_FAILURE;
+    }
+    ret = gFlashBgoBlank;
+#endif
+    return ret;
+}
+
+/* ---------------------------------------------------------------------------------------
+* BlankCheckWord_FlashData
+*
+* Description
+*     This function performs a 2 byte blank check (one record head of a
+*     data flash log) and waits for the result regardless of the BGO setting.
+*
+* Argument
+*     address   Data flash address (2 byte aligned)
+*
+* Return
+*     uint8_t   FLASH_BLANK / FLASH_NOT_BLANK / FLASH_FAILURE
+* ---------------------------------------------------------------------------------------*/
+uint8_t BlankCheckWord_FlashData(uint32_t address)
+{
+    // Declare flash API result variable 
+    uint8_t ret;
+
+    // Wait for the previous operation 
+    Wait_FlashData();
+
+    // Start blank check 
+    ret = R_FlashDataAreaBlankCheck(address, BLANK_CHECK_2_BYTE);
+#ifdef DATA_FLASH_BGO
+    if (ret != FLASH_BLANK) { // Not started 
+        return FLASH_FAILURE;
+    }
+    // Result is notified by FlashBlankCheckDone() 
+    if (Wait_FlashData() != FLASH_SUCCESS) {
+        return FLASH_FAILURE;
+    }
+    ret = gFlashBgoBlank;
+#endif
+    return ret;
+}
+
+// Result slot of the running EraseBgo / WriteBgo operation 
+volatile uint8_t * volatile gFlashBgoSlot = 0;
+
+/* ---------------------------------------------------------------------------------------
+* EraseBgo_FlashData / WriteBgo_FlashData
+*
+* Description
+*     These functions start one erase / write for a main loop job. The
+*     result is stored in the job's own slot (FLASH_BUSY until the FCU ready
+*     interrupt), so jobs sharing the FCU never read each other's result.
+*
+* Argument
+*     block / address, data, size   Same as R_FlashErase / R_FlashWrite
+*     slot                          Result slot of the calling job
+*
+* Return
+*     uint8_t   FLASH_SUCCESS = Started (completed without BGO) / Other = Not started
+* ---------------------------------------------------------------------------------------*/
+uint8_t EraseBgo_FlashData(uint8_t block, volatile uint8_t *slot)
+{
+    // Declare flash API result variable 
+    uint8_t ret;
+
+    // Another operation is running 
+    if (gFlashBgoSlot != 0 || R_FlashGetStatus() != FLASH_SUCCESS) {
+        return FLASH_BUSY;
+    }
+    *slot = FLASH_BUSY;
+#ifdef DATA_FLASH_BGO
+    gFlashBgoSlot = slot;
+#endif
+    ret = R_FlashErase(block);
+#ifdef DATA_FLASH_BGO
+    if (ret != FLASH_SUCCESS) { // Not started 
+        gFlashBgoSlot = 0;
+        *slot = ret;
+    }
+#else
+    *slot = ret;
+#endif
+    return ret;
+}
+
+uint8_t WriteBgo_FlashData(uint32_t address, uint32_t data, uint16_t size, volatile uint8_t *slot)
+{
+    // Declare flash API result variable 
+    uint8_t ret;
+
+    // Another operation is running 
+    if (gFlashBgoSlot != 0 || R_FlashGetStatus() != FLASH_SUCCESS) {
+        return FLASH_BUSY;
+    }
+    *slot = FLASH_BUSY;
+#ifdef DATA_FLASH_BGO
+    gFlashBgoSlot = slot;
+#endif
+    ret = R_FlashWrite(address, data, size);
+#ifdef DATA_FLASH_BGO
+    if (ret != FLASH_SUCCESS) { // Not started 
+        gFlashBgoSlot = 0;
+        *slot = ret;
+    }
+#else
+    *slot = ret;
+#endif
+    return ret;
+}
+
+#if defined(DATA_FLASH_BGO) || defined(ROM_BGO)
+/* ---------------------------------------------------------------------------------------
+* Flash API BGO callback functions (called from flash_ready_isr)
+* ---------------------------------------------------------------------------------------*/
+static void FlashBgoNotify(uint8_t result)
+{
+    volatile uint8_t *slot = gFlashBgoSlot;
+
+    gFlashBgoResult = result;
+    if (slot != 0) { // Owner of the operation 
+        gFlashBgoSlot = 0;
+        *slot = result;
+    }
+}
+
+// Erase finished 
+void FlashEraseDone(void)
+{
+    FlashBgoNotify(FLASH_SUCCESS);
+}
+
+// Write finished 
+void FlashWriteDone(void)
+{
+    FlashBgoNotify(FLASH_SUCCESS);
+}
+
+// Operation failed 
+void FlashError(void)
+{
+    FlashBgoNotify(FLASH_FAILURE);
+}
+
+// Blank check finished 'result' is FLASH_BLANK or FLASH_NOT_BLANK 
+void FlashBlankCheckDone(uint8_t result)
+{
+    gFlashBgoBlank  = result;
+    gFlashBgoResult = FLASH_SUCCESS;
+}
+#endif // if defined(DATA_FLASH_BGO) || defined(ROM_BGO)
@@ -46,6 +46,23 @@ void Init_FlashData(void);
 int Write_FlashData(void);
 // Flash erase function prototype declaration 
 void Erase_FlashData(void);
+// Flash idle wait function prototype declaration 
+uint8_t Wait_FlashData(void);
+// Flash block blank check function prototype declaration 
+uint8_t BlankCheck_FlashData(uint32_t address);
+// Flash 2 byte blank check function prototype declaration 
+uint8_t BlankCheckWord_FlashData(uint32_t address);
+// Flash block erase with a result slot function prototype declaration 
+uint8_t EraseBgo_FlashData(uint8_t block, volatile uint8_t *slot);
+// Flash write with a result slot function prototype declaration 
+uint8_t WriteBgo_FlashData(uint32_t address, uint32_t data, uint16_t size, volatile uint8_t *slot);
+
+// Result of the last background (FRDYI) operation 
+extern volatile uint8_t gFlashBgoResult;
+// Result of the last background blank check (FLASH_BLANK / FLASH_NOT_BLANK) 
+extern volatile uint8_t gFlashBgoBlank;
+// Result slot of the running EraseBgo / WriteBgo operation (BGO mode, cleared by flash_ready_isr) 
+extern volatile uint8_t * volatile gFlashBgoSlot;
 
 
 // End of multiple inclusion prevention macro 
@@ -55,6 +55,8 @@
 #include "uSD_rspi1.h"
 #include "cantp.h" // CAN-TP definition 
 #include "uds.h"   // CAN-UDS definition 
+#include "obd2.h"  // CAN-OBDII definition 
+#include "trace.h" // Event trace 
 
 /* ----------------------------------------------------------------------------------------
  *  CAN2ECU Main Variable definition
@@ -62,9 +64,17 @@
 #define COMMAND_BUF_MAX 512
 typedef struct __console_command_buffer__ {
     int     WP;
+    int     BIN;    // Binary frame reception 0:ASCII / 1:Frame / -1:Discard until 0x00 
     char    BUF[COMMAND_BUF_MAX];
 } CONSOLE_CTRL;
 
+typedef struct __console_command_table__ {
+    const char *    NAME;   // Keyword 
+    const char *    ARGS;   // Argument format 
+    int             MIN;    // Minimum number of arguments 
+    void            (*FUNC)(int argc, CMD_ARG *argv);
+} CONSOLE_CMD;
+
 CONSOLE_CTRL sci_console;
 #ifdef SCI2_ACTIVATE
 CONSOLE_CTRL sci2_console;
@@ -73,6 +83,7 @@ CONSOLE_CTRL sci2_console;
 CONSOLE_CTRL usb_console;
 #endif
 int retport = 0;
+int cmd_reply = 0;  // SendPC call counter (pipelined reply check) 
 #ifdef __LFY_RX63N__
 int console_port = 1;
 #else
@@ -96,11 +107,12 @@ interrupt void Dummy_Interrupt(void)
 // ECU processing 
 void    ecu_job(void);               // ECU operation 
 void    ecu_status(char *cmd);       // Parameter status check 
-void    ecu_get_command(char *cmd);  // Frame data acquisition 
-void    ecu_set_command(char *cmd);  // Rewrite frame data 
-void    ecu_put_command(char *cmd);  // Direct frame transmission 
+void    ecu_status_job(void);        // Parameter status dump continuation 
+void    ecu_get_command(int argc, CMD_ARG *argv);  // Frame data acquisition 
+void    ecu_set_command(int argc, CMD_ARG *argv);  // Rewrite frame data 
+void    ecu_put_command(int argc, CMD_ARG *argv);  // Direct frame transmission 
 void    ecu_put_message(int id, int size, unsigned char *buf);
-void    ecu_input_update(char *cmd); // Update I/O information via communication 
+void    ecu_input_update(int argc, CMD_ARG *argv); // Update I/O information via communication 
 
 /* ----------------------------------------------------------------------------------------
  * iwdt_refresh Refresh watchdog
@@ -190,6 +202,108 @@ int hex_to_byte(char *p, unsigned char *d)
     return i;
 }
 
+/* ----------------------------------------------------------------------------------------
+ * cmd_hex
+ * 
+ *  Argument
+ *      *s   HEX string
+ *      n    Maximum characters
+ *      *val Conversion value storage destination
+ * 
+ *  Return
+ *      int  Number of converted characters (stops at the first non HEX character)
+ * ----------------------------------------------------------------------------------------*/
+const signed char cmd_hex_code[256] = { // HEX character -> 0..15 (-1:Not HEX) 
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1, // '0'-'9' 
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 'A'-'F' 
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, // 'a'-'f' 
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+int cmd_hex(const char *s, int n, unsigned long *val)
+{
+    int             i;
+    unsigned long   v = 0;
+    int             c;
+
+    for (i = 0; i < n; i++) {
+        c = cmd_hex_code[(unsigned char)s[i]];
+        if (c < 0) {
+            break;
+        }
+        v = (v << 4) | (unsigned long)c;
+    }
+    *val = v;
+    return i;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * cmd_hex_bytes
+ * 
+ *  Argument
+ *      *s   HEX string (2 characters per byte)
+ *      n    Characters
+ *      *d   Byte string storage destination
+ *      max  Maximum bytes
+ * 
+ *  Return
+ *      int  Number of conversion bytes (stops at the first non HEX character)
+ * ----------------------------------------------------------------------------------------*/
+int cmd_hex_bytes(const char *s, int n, unsigned char *d, int max)
+{
+    int i, h, l;
+
+    for (i = 0; i < max && n >= 2; i++, n -= 2) {
+        h = cmd_hex_code[(unsigned char)*s++];
+        l = cmd_hex_code[(unsigned char)*s++];
+        if ((h | l) < 0) {
+            break;
+        }
+        d[i] = (unsigned char)((h << 4) | l);
+    }
+    return i;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * cmd_dec
+ * 
+ *  Argument
+ *      *s   Decimal string (optional sign)
+ *      n    Maximum characters
+ *      *val Conversion value storage destination
+ * 
+ *  Return
+ *      int  Number of converted characters (stops at the first non decimal character)
+ * ----------------------------------------------------------------------------------------*/
+int cmd_dec(const char *s, int n, long *val)
+{
+    int     i = 0;
+    int     neg = 0;
+    long    v = 0;
+
+    if (n > 0 && (s[0] == '-' || s[0] == '+')) {
+        neg = (s[0] == '-');
+        i++;
+    }
+    for (; i < n && s[i] >= '0' && s[i] <= '9'; i++) {
+        v = v * 10 + (s[i] - '0');
+    }
+    *val = neg ? -v : v;
+    return i;
+}
+
 /* ----------------------------------------------------------------------------------------
  * byte_to_ulong
  * 
@@ -247,6 +361,7 @@ void send_var(int ch)
  * ----------------------------------------------------------------------------------------*/
 void SendPC(char *msg)
 {
+    cmd_reply++;
     switch (retport) {
     case 0: //  COM0 
 #ifdef SCI0_ACTIVATE
@@ -351,29 +466,30 @@ void PortInit(void)
  *      RTS Command processing
  * 
  *  Argument
- *      char *cmd Command string
+ *      char *cmd Date and time string (not 0 terminated)
+ *      int  len  Characters
  *  
  *  Return
  *      None
  * ----------------------------------------------------------------------------------------*/
-void rtc_command_job(char *cmd)
+void rtc_command_job(char *cmd, int len)
 {
     int         year, mon, day, hour, min, sec;
     time_bcd_t  tm;
     /* ---------------------------------------------------
      *  Command analysis
      * --------------------------------------------------- */
-    if (strlen(cmd) == 0) { // RTC data read 
+    if (len == 0) { // RTC data read 
         rtc_time_read(&tm);
         logging(
                     "RTC=%04X/%02X/%02X %02X:%02X:%02X\r", (int)tm.year, (int)tm.month,
                     (int)tm.day, (int)tm.hour, (int)tm.minute, (int)tm.second
         );
-    } else if (strlen(cmd) >= 17) { // RTC data set 
-        if (strlen(cmd) == 17) {
+    } else if (len >= 17) { // RTC data set 
+        if (len == 17) {
             if (
                 6 != sscanf(
-                            &cmd[3], "%02X/%02X/%02X %02X:%02X:%02X", &year, &mon,
+                            cmd, "%02X/%02X/%02X %02X:%02X:%02X", &year, &mon,
                             &day, &hour, &min, &sec
                 )
             ) {
@@ -382,7 +498,7 @@ void rtc_command_job(char *cmd)
         } else {
             if (
                 6 != sscanf(
-                            &cmd[3], "%04X/%02X/%02X %02X:%02X:%02X", &year, &mon,
+                            cmd, "%04X/%02X/%02X %02X:%02X:%02X", &year, &mon,
                             &day, &hour, &min, &sec
                 )
             ) {
@@ -405,312 +521,476 @@ void rtc_command_job(char *cmd)
 }
 
 /* ----------------------------------------------------------------------------------------
- * command_job 
+ * Console command handlers
+ *  
+ *  Argument
+ *      argc    Number of arguments
+ *      *argv   Arguments converted by the CONSOLE_CMD format of the command
+ *  
+ *  Return
+ *      None
+ * ----------------------------------------------------------------------------------------*/
+void cmd_unit(int argc, CMD_ARG *argv)
+{   // [?] Device code 
+    switch (SELECT_ECU_UNIT) {
+    case ECU_UNIT_POWERTRAIN:
+        logging("ECUPT\r");
+        break;
+    case ECU_UNIT_CHASSIS:
+        logging("ECUIP\r");
+        break;
+    case ECU_UNIT_BODY:
+        logging("ECUBD\r");
+        break;
+    case ECU_UNIT_CGW:
+        logging("ECUGW\r");
+        break;
+    default:
+        logging("ECUX%d\r", (int)(SELECT_ECU_UNIT));
+        break;
+    }
+}
+
+void cmd_bootclear(int argc, CMD_ARG *argv)
+{   // [BOOTCLEAR] Clear ROM storage area 
+    if (bootclear() == 1) { // Success 
+        logging("BootClear OK\r");
+    } else { // Failure 
+        logging("BootClear NG\r");
+    }
+}
+
+void cmd_bootcopy(int argc, CMD_ARG *argv)
+{   // [BOOTCOPY] Copy the running program to ROM 
+    if (bootcopy() == 1) { // Success 
+        logging("BootCopy OK\r");
+    } else { // Failure 
+        logging("BootCopy NG\r");
+    }
+}
+
+void cmd_ca(int argc, CMD_ARG *argv)
+{   // [CA id rtr dlc enb rep time cnt] Add ID to list 
+    int id, dt;
+
+    id = (int)argv[0].VAL;
+    if (id >= 0 && id < CAN_ID_MAX) {
+        dt = add_cyceve_list(
+                    (int)argv[1].VAL, id, (int)argv[2].VAL, (int)argv[3].VAL,
+                    (int)argv[4].VAL, (int)argv[5].VAL, (int)argv[6].VAL
+        );
+        can_id_event(dt, 0); // Event registration 
+        logging("CA %03X OK\r", id);
+    }
+}
+
+void cmd_ccall(int argc, CMD_ARG *argv)
+{   // [CCALL] Delete all lists 
+    memset(&wait_tup, 0, sizeof(wait_tup)); // Period / event wait initialization 
+    wait_tup.TOP = -1;
+    memset(&conf_ecu, 0, sizeof(conf_ecu)); /* Initialization of cycle /
+                                             * event / remote management
+                                             * definition*/
+    conf_ecu.TOP = -1;
+    logging("CCALL OK\r");
+}
+
+void cmd_cr(int argc, CMD_ARG *argv)
+{   // [CR id] Delete ID from list 
+    int id = (int)argv[0].VAL;
+
+    if (id >= 0 && id < CAN_ID_MAX) {
+        delete_cyceve_list(id);  // Delete managed ID 
+        delete_waiting_list(id); // Delete time waiting ID 
+        logging("CR %03X OK\r", id);
+    }
+}
+
+void cmd_el(int argc, CMD_ARG *argv)
+{   // [EL] conf_ecu variable display 
+    ecu_status("L");
+}
+
+void cmd_es(int argc, CMD_ARG *argv)
+{   // [ES] send_msg variable display 
+    ecu_status("S");
+}
+
+void cmd_ew(int argc, CMD_ARG *argv)
+{   // [EW] wait_tup variable display 
+    ecu_status("W");
+}
+
+void cmd_exb(int argc, CMD_ARG *argv)
+{   // [EXB [0/1]] Status notification format 0:EXU text 1:Binary delta stream 
+    logging("EXB %d\r", ecu_stat_mode((argc >= 1) ? (int)argv[0].VAL : -1));
+}
+
+void cmd_map(int argc, CMD_ARG *argv)
+{   // [MAP id map] Routing map setting 
+    int id = (int)argv[0].VAL;
+
+    if (id >= 0 && id < CAN_ID_MAX) {
+        rout_map.ID[id].BYTE = (unsigned char)argv[1].VAL;
+    }
+}
+
+void cmd_mod(int argc, CMD_ARG *argv)
+{   // [MOD mode [data]] CARLA mode notification 
+    unsigned char s[8];
+
+    switch (argv[0].VAL) {
+    case 0:
+    case 1:
+        logging("MOD%d\r", (int)argv[0].VAL);
+        ds_conect_active[1] = (int)argv[0].VAL;
+        ds_conect_active[0] = (~(int)argv[0].VAL) & 1;
+        memset(s, 0xff, sizeof(s));
+        s[0] = (argc >= 2) ? (unsigned char)argv[1].VAL : 0x00;
+        s[1] = ~s[0];
+        s[2] = (unsigned char)argv[0].VAL;
+        ecu_put_message(0x7D0, 8, s);  //  CAN
+        break;
+    }
+}
+
+void cmd_mon(int argc, CMD_ARG *argv)
+{   /* [MON id ch [sample]] Obtains the time difference between the reception of
+     * the specified ID and the completion of transmission */
+    cmt1_stop();
+    led_monit_id        = (int)argv[0].VAL;   // Test ID 
+    led_monit_ch        = (int)argv[1].VAL;   // Test channel 
+    led_monit_first     = 0x7FFFFFFF;         // Shortest time 
+    led_monit_slow      = 0;                  // Longest time 
+    led_monit_time      = 0;                  // Average time 
+    led_monit_count     = 0;                  // Averaging time 
+    led_monit_sample    = (argc >= 3) ? (int)argv[2].VAL : 50;
+}
+
+void cmd_rbu(int argc, CMD_ARG *argv)
+{   // [RBU pointer length data..] RAM stack command, up to 32 bytes at one time 
+    int i, ptr, len;
+
+    ptr = (int)argv[0].VAL;
+    len = (int)argv[1].VAL;
+    if (ptr < 0 || ptr >= RAM_BUFFER_MAX) {
+        logging("RBU Over 1\r");
+        return;
+    }
+    if ((ptr + len) >= RAM_BUFFER_MAX) {
+        logging("RBU Over 2\r");
+        return;
+    }
+    if ((argc - 2) < len) { // Insufficient data count 
+        logging("RBU Lost %d\r", argc);
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        comm_ram_buffer[ptr + i] = (unsigned char)argv[2 + i].VAL;
+    }
+}
+
+void cmd_reboot(int argc, CMD_ARG *argv)
+{   // [REBOOT] Restart by soft reset 
+    logging("ReBoot OK\r");
+    wdt_init();
+}
+
+void cmd_rtc(int argc, CMD_ARG *argv)
+{   // [RTC [date time]] Real-time clock operation 
+    if (argc == 0) {
+        rtc_command_job("", 0);
+    } else {
+        rtc_command_job(argv[0].STR, argv[0].LEN);
+    }
+}
+
+void cmd_rwl(int argc, CMD_ARG *argv)
+{   // [RWL address length] ROM write command 
+    _di();
+    if (
+        R_FlashWrite(
+                    (unsigned long)argv[0].VAL, (unsigned long)&comm_ram_buffer,
+                    (unsigned short)argv[1].VAL
+        ) != FLASH_SUCCESS
+    ) { // Write failed 
+        _ei();
+        logging("RWL Error\r");
+        return;
+    }
+    _ei();
+    logging("RWL Success %X\r", (int)argv[0].VAL);
+}
+
+void cmd_sci(int argc, CMD_ARG *argv)
+{   // [SCI [ch]] Transmit bytes dropped by a full buffer 
+    int ch = (argc >= 1) ? (int)argv[0].VAL : console_port;
+
+    logging("SCI%d DROP=%d\r", ch, sci_txdrop(ch));
+}
+
+void cmd_trc(int argc, CMD_ARG *argv)
+{   // [TRC [ch]] Event trace text drain channel (-1:stop), status only without argument 
+    int ch;
+
+    if (argc >= 1) {
+        ch = (int)argv[0].VAL;
+        if (ch == 4 || ch > 6) { // USB or no SCI channel 
+            logging("TRC NG\r");
+            return;
+        }
+        trace.PORT = (ch < 0) ? -1 : ch;
+    }
+    logging("TRC PORT=%d CNT=%d LOST=%lu\r", trace.PORT, (int)(trace.WP - trace.RP), trace.LOST);
+}
+
+void cmd_ver(int argc, CMD_ARG *argv)
+{   // [VER] 
+    send_var(retport);
+}
+
+void cmd_wdf(int argc, CMD_ARG *argv)
+{   // [WDF] Save to data flash, result is printed when the data flash job completes 
+    if (ecu_data_write() == 0) { // Queue full 
+        logging("WDF NG BUSY\r");
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ *  Console command table (sorted by keyword for the binary search)
+ *
+ *  Argument format
+ *      x:Hexadecimal  d:Decimal  t:Token (converted by the handler)
+ *      r:Rest of the command  *:Repeat the previous format
+ * ----------------------------------------------------------------------------------------*/
+const CONSOLE_CMD cmd_table[] = {
+    // Keyword      Format      Min  Handler 
+    { "?",          "",         0,   cmd_unit },
+    { "BOOTCLEAR",  "",         0,   cmd_bootclear },
+    { "BOOTCOPY",   "",         0,   cmd_bootcopy },
+    { "CA",         "xdddddd",  7,   cmd_ca },
+    { "CCALL",      "",         0,   cmd_ccall },
+    { "CR",         "x",        1,   cmd_cr },
+    { "EL",         "",         0,   cmd_el },
+    { "ES",         "",         0,   cmd_es },
+    { "EW",         "",         0,   cmd_ew },
+    { "EXB",        "d",        0,   cmd_exb },
+    { "EXD",        "t*",       0,   ecu_input_update },
+    { "GET",        "t*",       0,   ecu_get_command },
+    { "MAP",        "xx",       2,   cmd_map },
+    { "MOD",        "dd",       1,   cmd_mod },
+    { "MON",        "xxd",      2,   cmd_mon },
+    { "PUT",        "t*",       0,   ecu_put_command },
+    { "RBU",        "ddx*",     2,   cmd_rbu },
+    { "REBOOT",     "",         0,   cmd_reboot },
+    { "RTC",        "r",        0,   cmd_rtc },
+    { "RWL",        "xd",       2,   cmd_rwl },
+    { "SCI",        "d",        0,   cmd_sci },
+    { "SET",        "t*",       0,   ecu_set_command },
+    { "TRC",        "d",        0,   cmd_trc },
+    { "VER",        "",         0,   cmd_ver },
+    { "WDF",        "",         0,   cmd_wdf },
+};
+#define CMD_TABLE_COUNT (sizeof(cmd_table) / sizeof(CONSOLE_CMD))
+
+CMD_ARG cmd_argv[CMD_ARG_MAX];  // Arguments of the running command 
+
+/* ----------------------------------------------------------------------------------------
+ * cmd_exec 
  *  
  *  Outline
- *      SCI/USB Command reception processing
+ *      Execute one command of the command line
  * 
  *  Argument
- *      None
+ *      *cmd  Command top (not 0 terminated)
+ *      len   Command characters
+ *      pipe  1:Command line with several commands
  *  
+ *  Description
+ *      Arguments beyond CMD_ARG_MAX are ignored.
+ *      In a pipelined line a command without its own reply answers "<keyword> OK"
+ *      so that the host receives at least one line per command.
+ * 
  *  Return
  *      None
- * ----------------------------------------------------------------------------------------
- */
-void command_job(char *cmd)
+ * ----------------------------------------------------------------------------------------*/
+void cmd_exec(char *cmd, int len, int pipe)
 {
-    int     id, dt;
-    int     db[8];
-    char *  p;
-    /* ---------------------------------------------------
-     *  Command analysis
-     * --------------------------------------------------- */
-    switch (*cmd++) {
-    case '?': // Device code 
-        switch (SELECT_ECU_UNIT) {
-        case ECU_UNIT_POWERTRAIN:
-            logging("ECUPT\r");
-            break;
-        case ECU_UNIT_CHASSIS:
-            logging("ECUIP\r");
-            break;
-        case ECU_UNIT_BODY:
-            logging("ECUBD\r");
-            break;
-        case ECU_UNIT_CGW:
-            logging("ECUGW\r");
-            break;
-        default:
-            logging("ECUX%d\r", (int)(SELECT_ECU_UNIT));
+    const CONSOLE_CMD * cp;
+    const char *        fp;
+    char *              end;
+    char *              p;
+    int                 lo, hi, mid, r;
+    int                 argc, n;
+    unsigned long       v;
+    char                f;
+
+    end = cmd + len;
+    while (cmd < end && *cmd == ' ') {
+        cmd++;
+    }
+    // Keyword 
+    p = cmd;
+    if (p < end && *p == '?') {
+        p++;
+    } else {
+        while (p < end && *p >= 'A' && *p <= 'Z') {
+            p++;
+        }
+    }
+    n   = (int)(p - cmd);
+    cp  = 0;
+    for (lo = 0, hi = CMD_TABLE_COUNT; n > 0 && lo < hi; ) {
+        mid = (lo + hi) / 2;
+        r   = strncmp(cmd_table[mid].NAME, cmd, n);
+        if (r == 0 && cmd_table[mid].NAME[n] != 0) {
+            r = 1; // Longer keyword 
+        }
+        if (r == 0) {
+            cp = &cmd_table[mid];
             break;
         }
-        break;
-    case 'B':                                  // ROM operation command 
-        if (strncmp(cmd, "OOTCOPY", 7) == 0) { // Copy the running program to ROM 
-            if (bootcopy() == 1) {             // Success 
-                logging("BootCopy OK\r");
-            } else { // Failure 
-                logging("BootCopy NG\r");
-            }
-        } else if (strncmp(cmd, "OOTCLEAR", 8) == 0) { // Clear ROM storage area 
-            if (bootclear() == 1) {                    // Success 
-                logging("BootClear OK\r");
-            } else { // Failure 
-                logging("BootClear NG\r");
-            }
+        if (r < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-        break;
-    case 'C': // Period / event list 
-        switch (*cmd++) {
-        case 'C': // Delete all lists 
-            if (cmd[0] == 'A' && cmd[1] == 'L' && cmd[2] == 'L') { // [CCALL]Command 
-                // Zero initialization 
-                memset(
-                            &wait_tup, 0,
-                            sizeof(wait_tup)
-                ); // Period / event wait initialization 
-                wait_tup.TOP = -1;
-                memset(&conf_ecu, 0, sizeof(conf_ecu)); /* Initialization of cycle /
-                                                         * event / remote management
-                                                         * definition*/
-                conf_ecu.TOP = -1;
-                logging("CCALL OK\r");
-            }
+    }
+    if (cp == 0) {
+        logging("Command Error !\r");
+        return;
+    }
+    // Arguments 
+    fp      = cp->ARGS;
+    f       = 0;
+    argc    = 0;
+    while (argc < CMD_ARG_MAX) {
+        while (p < end && *p == ' ') {
+            p++;
+        }
+        if (p >= end) {
             break;
-        case 'R': // Delete ID from list 
-            while (*cmd == ' ') {
-                cmd++;
-            }
-            if (sscanf(cmd, "%x", &id) == 1) { // Set value acquisition [CR id] 
-                if (id >= 0 && id < CAN_ID_MAX) {
-                    delete_cyceve_list(id);  // Delete managed ID 
-                    delete_waiting_list(id); // Delete time waiting ID 
-                    logging("CR %03X OK\r", id);
-                }
+        }
+        if (*fp != '*') { // '*' repeats the previous format 
+            f = *fp;
+            if (f != 0) {
+                fp++;
             }
-            break;
-        case 'A': // Add ID to list 
-            while (*cmd == ' ') {
-                cmd++;
+        }
+        if (f == 0) {
+            break; // Extra arguments 
+        }
+        cmd_argv[argc].STR = p;
+        if (f == 'r') {
+            while (end > p && end[-1] == ' ') {
+                end--;
             }
-            if (
-                sscanf(
-                            cmd, "%x %d %d %d %d %d %d", &id, &db[0], &db[1], &db[2],
-                            &db[3], &db[4], &db[5]
-                ) == 7
-            ) {      // Set value acquisition [CA id rtr dlc enb rep time cnt] 
-                if (id >= 0 && id < CAN_ID_MAX) {
-                    dt = add_cyceve_list(
-                                db[0], id, db[1], db[2], db[3], db[4],
-                                db[5]
-                    );
-                    can_id_event(dt, 0); // Event registration 
-                    logging("CA %03X OK\r", id);
-                }
+            p = end;
+        } else {
+            while (p < end && *p != ' ') {
+                p++;
             }
-            break;
         }
-        break;
-    case 'M':
-        if (cmd[0] == 'A') {     // MA? */
-            if (cmd[1] == 'P') { // MAP command 
-                cmd += 2;
-                while (*cmd == ' ') {
-                    cmd++;
-                }
-                if (sscanf(cmd, "%x %x", &id, &dt) == 2) { // Set value acquisition 
-                    if (id >= 0 && id < CAN_ID_MAX) {
-                        rout_map.ID[id].BYTE = (unsigned char)dt;
-                    }
-                }
-            }
-        } else if (cmd[0] == 'O') {
-        	if (cmd[1] == 'N') { /* MON command (obtains the time difference
-	             * between the reception of the specified ID and
-	             * the completion of transmission)*/
-	            cmd += 2;
-	            while (*cmd == ' ') {
-	                cmd++;
-	            }
-	            db[0] = sscanf(cmd, "%x %x %d", &id, &dt, &db[1]);
-	            if (db[0] >= 2) { // Set value acquisition 
-	                cmt1_stop();
-	                led_monit_id        = id;     // Test ID 
-	                led_monit_ch        = dt;     // Test channel 
-	                led_monit_first     = 0x7FFFFFFF; // Shortest time 
-	                led_monit_slow      = 0;      // Longest time 
-	                led_monit_time      = 0;      // Average time 
-	                led_monit_count     = 0;      // Averaging time 
-	                led_monit_sample    = (db[0] == 3) ? db[1] : 50;
-	            }
-	        } else if (cmd[1] == 'D') { /* MOD command */
-	            cmd += 2;
-	            while (*cmd == ' ') {
-	                cmd++;
-	            }
-	            dt = sscanf(cmd, "%d %d", &db[2], &db[0]);
-	            if (dt >= 1) { // Set value acquisition
-	            	switch(db[2]) {
-	            	case 0:
-	            	case 1:
-			            if(dt <= 1) db[0] = 0x00;
-		            	id = 0x7D0;
-		            	db[1] = ~db[0] & 0xFF;
-			           	logging("MOD%d\r", db[2]);
-			           	ds_conect_active[1] = db[2];
-			         	ds_conect_active[0] = (~db[2]) & 1;
-			         	{
-			         		unsigned char s[8];
-			         		memset(s, 0xff, sizeof(s));
-			         		s[0] = (unsigned char)db[0];
-			         		s[1] = (unsigned char)db[1];
-			         		s[2] = (unsigned char)db[2];
-			            	ecu_put_message(id, 8, s);	//	CAN
-			            }
-	            		break;
-	            	}
-	            }
-	        }
+        cmd_argv[argc].LEN = n = (int)(p - cmd_argv[argc].STR);
+        cmd_argv[argc].VAL = 0;
+        if (f == 'x') {
+            r                   = cmd_hex(cmd_argv[argc].STR, n, &v);
+            cmd_argv[argc].VAL  = (long)v;
+        } else if (f == 'd') {
+            r = cmd_dec(cmd_argv[argc].STR, n, &cmd_argv[argc].VAL);
+        } else {
+            r = n;
         }
-        break;
-    case 'E': // ECU command 
-        if (
-            cmd[0] == 'X' &&
-            cmd[1] == 'D'
-        ) { // EXD I/O input command via communication 
-            ecu_input_update(&cmd[2]);
-        } else { // Internal information return request 
-            ecu_status(cmd);
+        if (r != n) { // Conversion error 
+            logging("Command Error !\r");
+            return;
         }
-        break;
-    case 'G': // ECU specified ID frame acquisition command 
-        if (cmd[0] == 'E' && cmd[1] == 'T') {
-            ecu_get_command(&cmd[2]);
+        argc++;
+    }
+    if (argc < cp->MIN) {
+        logging("Command Error !\r");
+        return;
+    }
+    r = cmd_reply;
+    cp->FUNC(argc, cmd_argv);
+    if (pipe && r == cmd_reply) {
+        logging("%s OK\r", cp->NAME);
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * command_job 
+ *  
+ *  Outline
+ *      SCI/USB Command reception processing
+ * 
+ *  Argument
+ *      *cmd  Command line (several commands can be separated by ';')
+ *  
+ *  Return
+ *      None
+ * ----------------------------------------------------------------------------------------
+ */
+void command_job(char *cmd)
+{
+    char *  p;
+    int     pipe = 0;
+
+    do {
+        for (p = cmd; *p != 0 && *p != ';'; p++) {
+            ;
         }
-        break;
-    case 'S': // ECU specified ID frame setting command 
-        if (cmd[0] == 'E' && cmd[1] == 'T') {
-            ecu_set_command(&cmd[2]);
+        if (*p == ';') {
+            pipe = 1;
         }
-        break;
-    case 'P': // ECU specified ID frame transmission command 
-        if (cmd[0] == 'U' && cmd[1] == 'T') {
-            ecu_put_command(&cmd[2]);
+        cmd_exec(cmd, (int)(p - cmd), pipe);
+        cmd = (*p == ';') ? p + 1 : p;
+    } while (*cmd != 0);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * comm_bin_byte 
+ *  
+ *  Outline
+ *      Binary host protocol byte reception
+ * 
+ *  Argument
+ *      *con  Console buffer of the port
+ *      ch    SCI channel
+ *      c     Received byte
+ *  
+ *  Description
+ *      0x00 (never sent by the ASCII console) starts a COBS frame, the next 0x00 ends it
+ *      and the port returns to ASCII mode. "00 00" resynchronizes the host.
+ * 
+ *  Return
+ *      int   1:Byte of a binary frame / 0:ASCII character
+ * ----------------------------------------------------------------------------------------*/
+int comm_bin_byte(CONSOLE_CTRL *con, int ch, char c)
+{
+    if (con->BIN == 0) {
+        if (c != 0) {
+            return 0;
         }
-        break;
-    case 'R':                                // R 
-        if (strncmp(cmd, "EBOOT", 5) == 0) { // Restart by soft reset 
-            logging("ReBoot OK\r");
-            wdt_init();
-        } else if (
-            cmd[0] == 'T' &&
-            cmd[1] == 'C'
-        ) { // [RTC]Real-time clock operation command 
-            while (*cmd == ' ') {
-                cmd++;
-            }
-            rtc_command_job(cmd);
-        } else if (cmd[0] == 'B' && cmd[1] == 'U') { /* [RBU]RAM stack command RBU
-                                                      * pointer length data.. Up to 32
-                                                      * bytes at one time*/
-            while (*cmd == ' ') {
-                cmd++;
-            }
-            db[0]   = 0; // Argument counter 
-            db[1]   = 0; // Pointer 
-            db[2]   = 0; // Length 
-            while (*cmd != 0) {
-                p = cmd;
-                while (*cmd != ' ' && *cmd != 0) {
-                    cmd++;
-                }
-                switch (db[0]) {
-                case 0: // Pointer setting 
-                    if (sscanf(p, "%d", &db[1]) != 1) {
-                        logging("RBU Error 1\r");
-                        return;
-                    }
-                    if (db[1] < 0 || db[1] >= RAM_BUFFER_MAX) {
-                        logging("RBU Over 1\r");
-                        return;
-                    }
-                    break;
-                case 1: // Length setting 
-                    if (sscanf(p, "%d", &db[2]) != 1) {
-                        logging("RBU Error 2\r");
-                        return;
-                    }
-                    if ((db[1] + db[2]) >= RAM_BUFFER_MAX) {
-                        logging("RBU Over 2\r");
-                        return;
-                    }
-                    break;
-                default: // Write data 
-                    if (sscanf(p, "%x", &db[3]) != 1) {
-                        logging("RBU Error %d\r", db[0]);
-                        return;
-                    }
-                    if (
-                        (db[0] - 2 + db[1]) <
-                        RAM_BUFFER_MAX
-                    ) { // Within buffer range 
-                        comm_ram_buffer[(db[0] - 2 + db[1])] = (unsigned char)db[3];
-                    }
-                    break;
-                }
-                db[0]++;
-                if ((db[0] - 2) >= db[2] || (db[0] - 2 + db[1]) >= RAM_BUFFER_MAX) {
-                    break;
-                }
-            }
-            if ((db[0] - 2) < db[2]) { // Insufficient data count 
-                logging("RBU Lost %d\r", db[0]);
-                return;
-            }
-        } else if (
-            cmd[0] == 'W' &&
-            cmd[1] == 'L'
-        ) { // [RWL]ROM write command RWL address length 
-            while (*cmd == ' ') {
-                cmd++;
-            }
-            if (sscanf(cmd, "%x %d", &db[0], &db[1]) == 2) { // Parameter count match 
-                _di();
-                if (
-                    R_FlashWrite(
-                                (unsigned long) db[0], (unsigned long)&comm_ram_buffer,
-                                (unsigned short)db[1]
-                    ) != FLASH_SUCCESS
-                ) { // Write failed 
-                    _ei();
-                    logging("RWL Error\r");
-                    return;
-                }
-                _ei();
-                logging("RWL Success %X\r", db[0]);
-            }
+        con->BIN    = 1;
+        con->WP     = 0; // Discard the unterminated command line 
+        return 1;
+    }
+    if (c == 0) { // End of frame 
+        if (con->BIN > 0 && con->WP > 0) {
+            ecu_bin_frame(ch, (unsigned char *)con->BUF, con->WP);
         }
-        break;
-    case 'W':                                 // Save to data flash 
-        if (cmd[0] == 'D' && cmd[1] == 'F') { // [WDF]Command 
-            id = ecu_data_write();
-            if (id == 7) { // Save successful 
-                logging("WDF OK\r");
-            } else { // Save failed 
-                logging("WDF NG %d\r", id);
-            }
+        con->BIN    = 0;
+        con->WP     = 0;
+    } else if (con->BIN > 0) {
+        if (con->WP >= ECU_BIN_MAX || con->WP >= COMMAND_BUF_MAX) { // Frame too long 
+            con->BIN = -1;
+            ecu_bin.OVF++;
+        } else {
+            con->BUF[con->WP++] = c;
         }
-        break;
-	case 'V':
-		if(cmd[0] == 'E' && cmd[1] == 'R')
-		{	//	[VER]
-			send_var(retport);
-		}
-        break;
-    default:
-        logging("Command Error !\r");
-        break;
     }
+    return 1;
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -741,6 +1021,9 @@ void comm_job(void)
         for (i = 0; i < numBytes; i++) {
             c = sci_get_char(console_port);
             // sci_putc(console_port, c); //  Echo back 
+            if (comm_bin_byte(&sci_console, console_port, c)) { //  Binary frame 
+                continue;
+            }
             if (c == 0x0D) { //  [CR] 
                 sci_console.BUF[sci_console.WP] = 0;
                 sci_console.WP                  = 0;
@@ -770,6 +1053,9 @@ void comm_job(void)
         for (i = 0; i < numBytes; i++) {
             c = sci_get_char(2);
             // sci_putc(console_port, c); //  Echo back 
+            if (comm_bin_byte(&sci2_console, 2, c)) { //  Binary frame 
+                continue;
+            }
             if (c == 0x0D) { //  [CR] 
                 sci2_console.BUF[sci2_console.WP]   = 0;
                 sci2_console.WP                     = 0;
@@ -876,6 +1162,7 @@ int main(void)
     PortInit();  // I/O port initialization 
     cmt0_init(); // CMT0 module setting 
     cmt1_init(); // CMT1 module setting 
+    trace_init(); // Event trace ring clear 
 #ifdef __LFY_RX63N__
 
 #ifdef SCI1_ACTIVATE
@@ -948,6 +1235,7 @@ int main(void)
     flash_init();   // FCU initialize 
     can_tp_init();  // CAN-TP initialization 
     can_uds_init(); // CAN-UDS initialization 
+    obd2_init();    // CAN-OBD2 initialization 
 
     // Special processing at startup  * ROMization when firmware is started from YScope with both S1-7 and S8 ON 
     if (DPSW_ROM_BOOT == 0) { // REM-MON start-up 
@@ -974,6 +1262,14 @@ int main(void)
             tp_pack.TXIF = 0;  // Release request 
             can_tp_txendreq(); // CAN-TP transmission completion processing call 
         }
+        uds_pending_job();     // UDS flash programming / response pending processing 
+#ifdef OBD2_FF_SAVE
+        obd2_ff_job();         // OBD2 freeze frame save processing 
+#endif
+        dtc_job();             // DTC log save processing 
+        ecu_flash_job();       // Data flash save / erase job processing 
+        trace_job();           // Event trace text drain (idle console only) 
+        ecu_status_job();      // Parameter dump continuation (EL / ES / EW) 
         if (uds_reset_request != 0) { // ECU restart 
             switch (uds_reset_request) {
             case 1: // Hart reset 
@@ -981,6 +1277,7 @@ int main(void)
                 break;
             case 2: // Clear status 
                 memset(&can_buf, 0, sizeof(can_buf));
+                EXT_RESCAN();
                 break;
             case 3: // Soft reset 
                 SYSTEM.PRCR.WORD    = 0xA502;
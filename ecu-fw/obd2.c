@@ -45,7 +45,14 @@
 #include "ecu.h"       // ECU common definition 
 #include "can3_spi2.h" // CAN3 definition 
 #include "cantp.h"     // CAN-TP definition 
+#include "uds.h"       // CAN-UDS definition 
 #include "obd2.h"      // CAN-OBDII definition 
+#include "altypes.h"
+#include "r_flash_api_rx600_config.h"
+#include "mcu_info.h"
+#include "r_flash_API_RX600.h"
+#include "r_flash_api_rx600_private.h"
+#include "flash_data.h"
 
 /* ----------------------------------------------------------------------------------------
  * Variable definition
@@ -56,813 +63,751 @@ OBD2_QUERY_FRAME    obd2_ret; // Response data
 int obd2_ret_counter = 0;
 
 /* ----------------------------------------------------------------------------------------
- * MODE1 Processing  0x0C, 0x0D, 0x1C, 0x2F, 0x31, 0x49, 0x51
+ * MODE1 PID definition table
+ *
+ *  The supported PID bitmaps (PID 00/20/40...) are generated from this table.
+ *  Value = source * MUL / DIV, saturated to the data length, sent in big endian.
+ * ---------------------------------------------------------------------------------------- */
+const OBD2_PID_DESC obd2_pid_table[] = {
+    // PID  LEN  TYPE            ID     POS  MUL  DIV   Fixed value 
+    {  0x01, 4,  OBD2_SRC_CONST, 0x000, 0,   1,   1,    0x00000000 }, // Monitor status since DTCs cleared (MIL / DTC_CNT / tests) 
+    {  0x05, 1,  OBD2_SRC_BYTE,  0x183, 0,   1,   1,    0 },          // Engine coolant temperature  -40 to 215[° C] A-40 
+    {  0x0C, 2,  OBD2_SRC_WORD,  0x043, 0,   4,   1,    0 },          // Engine RPM  0 to 16383.75[rpm] (256A+B)/4 
+    {  0x0D, 1,  OBD2_SRC_SWORD, 0x043, 2,   1,   1,    0 },          // Vehicle speed  0 to 255[km/h] A 
+    {  0x11, 1,  OBD2_SRC_WORD,  0x02F, 0,   255, 1023, 0 },          // Throttle position  0 to 100[%] 100A/255 
+    {  0x1C, 1,  OBD2_SRC_CONST, 0x000, 0,   1,   1,    1 },          // OBD standards  1:OBD2 of CARB specification 
+    {  0x2F, 1,  OBD2_SRC_BYTE,  0x3D4, 0,   255, 40,   0 },          // Fuel Tank Level Input  0..40 liter -> 0 to 100[%] 100A/255 
+    {  0x31, 2,  OBD2_SRC_CONST, 0x000, 0,   1,   1,    0 },          // Distance traveled since codes cleared  0 to 65535[km] 256A+B 
+    {  0x49, 1,  OBD2_SRC_CONST, 0x000, 0,   1,   1,    0 },          // Accelerator pedal position D  0 to 100[%] 100A/255 
+    {  0x51, 1,  OBD2_SRC_CONST, 0x000, 0,   1,   1,    1 },          // Fuel Type  1:Gasoline 
+};
+#define OBD2_PID_COUNT  (sizeof(obd2_pid_table) / sizeof(OBD2_PID_DESC))
+
+unsigned char   obd2_pid_index[256];      // PID -> table index (0xFF=Unsupported) 
+unsigned char   obd2_pid_support[8][4];   // Supported PID bitmap [01-20]...[E1-FF] 
+unsigned char   obd2_ff_ofs[OBD2_PID_COUNT]; // Source position in the freeze frame 
+
+OBD2_FREEZE_FRAME   obd2_ff[OBD2_FF_MAX];   // Freeze frame ring 
+int                 obd2_ff_wp  = 0;        // Ring write position 
+int                 obd2_ff_num = 0;        // Number of stored frames 
+unsigned short      obd2_ff_seq = 0;        // Capture sequence number 
+OBD2_FF_SAVE_STR    obd2_ffs;               // Data flash save control 
+OBD2_PREP_STR       obd2_mode9_prep[OBD2_MODE9_PIDS]; // Prepared MODE9 responses 
+
+/* ----------------------------------------------------------------------------------------
+ * OBD2 initialization (PID index / supported PID bitmap generation)
  * ---------------------------------------------------------------------------------------- */
-int obd2_mode1(int len)
+void obd2_init(void)
 {
-    int d;
-    // Standard requirements 
-    if (len >= 2) {
-        len = 2;                            // Default 2 bytes 
-        obd2_ret.SAE_ECU.MODE   = obd2_req.SAE_OBD.MODE + 0x40; // Response flag 
-        obd2_ret.SAE_ECU.PID    = obd2_req.SAE_OBD.PID;         // Parameter ID copy 
-        // Processing for each PID 
-        switch (obd2_req.SAE_OBD.PID) {
-                   //------------------------------------------------------ 
-        case 0x00: // Support PID information [01 - 20]
-                   // ------------------------------------------------------
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x18;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x11; // 0x0C,0x0D,0x1C,(0x20) 
-            break;
-        case 0x01: /* Monitor status since DTCs cleared. (Includes malfunction
-                    * indicator lamp (MIL) status and number of DTCs.)*/
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] =
-                0x00; // (A) bit7:MIL emission check / bit6 to 0:DTC_CNT 
-            obd2_ret.SAE_ECU.VAL[1] =
-                0x00; /* (B) bit7:[0] / bit3: 0 = spark plug type, 1 = diesel /
-                       * bit2: configuration test, bit6: incomplete / bit1: fuel gauge
-                       * test, bit5: incomplete / bit0: misfire test, bit4: incomplete*/
-            obd2_ret.SAE_ECU.VAL[2] =
-                0x00; /* (C) bit7: EGR system test / bit6: Oxygen sensor heater
-                       * test / bit5: Oxygen sensor test / bit4: AC refrigerant test /
-                       * bit3: 2nd air system test / bit2: Evaporation system test /
-                       * bit1: Heating accelerator test / bit0: Acceleration Agent
-                       * test*/
-            obd2_ret.SAE_ECU.VAL[3] =
-                0x00; /* (D) bit7: Incomplete EGR system / bit6: Incomplete oxygen
-                       * sensor heater / bit5: Incomplete oxygen sensor / bit4:
-                       * Incomplete AC refrigerant / bit3: Incomplete 2nd air system /
-                       * bit2: Incomplete evaporation system / bit1: Heating promotion
-                       * Incomplete agent / bit0: Incomplete accelerator*/
-            break;
-        case 0x02: // Freeze DTC (Stop saving DTC) 
-            break;
-        case 0x03: // Fuel system status 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 2; /* 1: Engine low temperature open loop / 2:
-                                          * Mix ratio feedback closed loop / 4:
-                                          * Deceleration closed loop / 8: Fault open
-                                          * loop / 16: Closed loop defect*/
-            break;
-        case 0x04: // Calculated engine load 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 100[%]Engine torque value  100/255*A 
-            break;
-        case 0x05: // Engine coolant temperature 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] =
-                can_buf.ID[0x183]
-                .BYTE[0];     // -40 to 215[° C]Engine coolant temperature A-40 
-            break;
-        case 0x06: // Short term fuel trim-Bank 1 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -100 to 99.2[%] Short-term fuel bank 1 100/128*A-100 
-            break;
-        case 0x07: // Long term fuel trim-Bank 1 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -100 to 99.2[%] Long-term fuel bank 1 100/128*A-100 
-            break;
-        case 0x08: // Short term fuel trim-Bank 2 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -100 to 99.2[%] Short-term fuel bank 2 100/128*A-100 
-            break;
-        case 0x09: // Long term fuel trim-Bank 2 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -100 to 99.2[%] Long-term fuel bank 2 100/128*A-100 
-            break;
-        case 0x0A: // Fuel pressure (gauge pressure) 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 765[kPa](/3) Fuel pressure 3*A 
-            break;
-        case 0x0B: // Intake manifold absolute pressure 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 255[kPa] Exhaust tube absolute pressure  A 
-            break;
-        case 0x0C: // Engine RPM 
-            len += 2;
-            d   = ((((int)can_buf.ID[0x043].BYTE[0]) << 8) |
-                   (((int)can_buf.ID[0x043].BYTE[1]) & 0xFF)) *
-                  4;
-            obd2_ret.SAE_ECU.VAL[0] = (unsigned char)(d >> 8);   /* 0 to
-                                                                  * 16383.75[rpm] Engine
-                                                                  * RPM (256A+B)/4*/
-            obd2_ret.SAE_ECU.VAL[1] = (unsigned char)(d & 0xFF); // ↑ Lower 8bit 
-            break;
-        case 0x0D: // Vehicle speed 
-            len += 1;
-            d   = ((((int)can_buf.ID[0x043].BYTE[2]) << 8) |
-                   (((int)can_buf.ID[0x043].BYTE[3]) & 0xFF));
-            if (d & 0x8000) {
-                d = 0x10000 - d;
-            }
-            obd2_ret.SAE_ECU.VAL[0] =
-                d; // 0 to 255[km/h] Vehicle speed    A 
-            break;
-        case 0x0E: // Timing advance 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -64 to 63.5[°] Forward timing A/2-64 
-            break;
-        case 0x0F: // Intake air temperature 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -40 to 215[° C] Intake air temperature   A-40 
-            break;
-        case 0x10: //  MAF air flow rate 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 655.35[g/s] Mixture rate  (256A+B)/100 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // ↑ Lower 8bit 
-            break;
-        case 0x11: // Throttle position 
-            len += 1;
-            d   = ((((int)can_buf.ID[0x02F].BYTE[0]) << 8) |
-                   (((int)can_buf.ID[0x02F].BYTE[1]) & 0xFF)) *
-                  255 / 1023;
-            obd2_ret.SAE_ECU.VAL[0] = (unsigned char)(d & 0xFF); /* 0 to 100[%]
-                                                                  * Throttle position
-                                                                  * 100A/255*/
-            break;
-        case 0x12: // Commanded secondary air status 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 1; /* 1: Upstream / 2: Under catalyst / 4:
-                                          * Outside air / 8: At diagnosis*/
-            break;
-        case 0x13: // Oxygen sensors present (in 2 banks) 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 1; /* bit0-3: Bank1, sensor 1-4 / bit4-7:
-                                          * Bank2, sensor 1-4 Oxygen sensor presence
-                                          * flag*/
-            break;
-        case 0x14: // Oxygen Sensor 1  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 1 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x15: // Oxygen Sensor 2  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 2 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x16: // Oxygen Sensor 3  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 3 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x17: // Oxygen Sensor 4  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 4 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x18: // Oxygen Sensor 5  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 5 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x19: // Oxygen Sensor 6  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 6 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x1A: // Oxygen Sensor 7  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 7 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x1B: // Oxygen Sensor 8  A: Voltage  B: Short term fuel trim 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // 0 to 1.275[V] Oxygen sensor 8 voltage A/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // -100 to 99.2[%] Short-term fuel adjustment  100/128B-100 
-            break;
-        case 0x1C: // OBD standards this vehicle conforms to 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 1; /* 1:OBD2 of CARB specification /
-                                          *11:JOBD,JOBD2 / 13:JOBD,EOBD,OBD2 etc.*/
-            break;
-        case 0x1D: // Oxygen sensors present (in 4 banks) 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] =
-                1; /* bit0 to 1:Bank1,Sensor 1 to 2 / bit2 to 3:Bank2,Sensor 1 to 2
-                    * / bit4 to 5:Bank3,Sensor 1 to 2 / bit6 to 7:Bank4,Sensor 1 to 2
-                    * Oxygen sensor presence flag*/
-            break;
-        case 0x1E: // Auxiliary input status 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 1; /* bit0:PTO(Power take Off)
-                                          * 1=Enable,0=Disable / bit7 to 1:[0]
-                                          * Auxiliary input status*/
-            break;
-        case 0x1F: // Run time since engine start 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65535[sec.] Elapsed time since engine start 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-                   //------------------------------------------------------ 
-        case 0x20: /* PIDs supported [21 - 40]
-                    * ------------------------------------------------------ */
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x02;
-            obd2_ret.SAE_ECU.VAL[2] = 0x80;
-            obd2_ret.SAE_ECU.VAL[3] = 0x01; // 0x2F,0x31,(0x40) 
-            break;
-        case 0x21: // Distance traveled with malfunction indicator lamp (MIL) on 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65535[km] Mileage after MIL warning 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x22: // Fuel Rail Pressure (relative to manifold vacuum) 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 5177.265[kPa] Fuel rail pressure 0.079*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x23
-            : // Fuel Rail Gauge Pressure (diesel, or gasoline direct injection) 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 655350[kPa] Fuel rail gauge pressure 10*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x24:    // Oxygen Sensor 1  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 1 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x25:    // Oxygen Sensor 2  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 2 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x26:    // Oxygen Sensor 3  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 3 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x27:    // Oxygen Sensor 4  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 4 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x28:    // Oxygen Sensor 5  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 5 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x29:    // Oxygen Sensor 6  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 6 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x2A:    // Oxygen Sensor 7  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 7 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x2B:    // Oxygen Sensor 8  AB: Fuel-Air Equivalence Ratio CD: Voltage 
-            len                    += 2; // Oxygen sensor 8 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) 0 to 8[V] Sensor voltage 8/65536*(256*C+D) 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x2C: // Commanded EGR 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] EGR instruction  100/255*A 
-            break;
-        case 0x2D: // EGR Error 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -100 to 99.2[%] EGR error 100/128*A-100 
+    int i, p, r, k;
+
+    memset(obd2_pid_index, 0xFF, sizeof(obd2_pid_index));
+    memset(obd2_pid_support, 0, sizeof(obd2_pid_support));
+    for (i = 0, k = 0; i < OBD2_PID_COUNT; i++) {
+        p = obd2_pid_table[i].PID;
+        obd2_ff_ofs[i] = (unsigned char)k; // Freeze frame layout 
+        k += obd2_src_size(obd2_pid_table[i].TYPE);
+        if ((p & 0x1F) == 0) { // Supported PID request is generated 
+            continue;
+        }
+        obd2_pid_index[p] = (unsigned char)i;
+        obd2_pid_support[(p - 1) >> 5][((p - 1) >> 3) & 3] |= (0x80 >> ((p - 1) & 7));
+        for (r = 0; r < ((p - 1) >> 5); r++) { // Next range exists 
+            obd2_pid_support[r][3] |= 0x01;
+        }
+    }
+    obd2_mode9_prepare();
+    // Restore the saved DTCs / freeze frames before any report 
+#ifdef OBD2_FF_SAVE
+    obd2_ff_load();
+    obd2_ffs.STEP = OBD2_FFS_IDLE;
+#endif
+    dtc_load();
+    dtc_log.STEP = DTC_LS_IDLE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * PID source data size (bytes copied from can_buf)
+ * ---------------------------------------------------------------------------------------- */
+int obd2_src_size(int type)
+{
+    switch (type) {
+    case OBD2_SRC_BYTE:
+        return 1;
+    case OBD2_SRC_WORD:
+    case OBD2_SRC_SWORD:
+        return 2;
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * PID value generation from source data
+ * ---------------------------------------------------------------------------------------- */
+int obd2_pid_value(const OBD2_PID_DESC *pd, unsigned char *sp, unsigned char *dp)
+{
+    int             i;
+    unsigned long   d, mx;
+
+    switch (pd->TYPE) {
+    default:
+    case OBD2_SRC_CONST: // Fixed value 
+        d = pd->VAL;
+        break;
+    case OBD2_SRC_BYTE:  // Unsigned byte 
+        d = (unsigned long)sp[0];
+        break;
+    case OBD2_SRC_WORD:  // Unsigned word 
+        d = ((unsigned long)sp[0] << 8) | ((unsigned long)sp[1]);
+        break;
+    case OBD2_SRC_SWORD: // Signed word (absolute value) 
+        d = ((unsigned long)sp[0] << 8) | ((unsigned long)sp[1]);
+        if (d & 0x8000) {
+            d = 0x10000 - d;
+        }
+        break;
+    }
+    if (pd->TYPE != OBD2_SRC_CONST) { // Scaling and saturation 
+        d  = d * pd->MUL / pd->DIV;
+        mx = (pd->LEN >= 4) ? 0xFFFFFFFF : ((1UL << (pd->LEN * 8)) - 1);
+        if (d > mx) {
+            d = mx;
+        }
+    }
+    for (i = pd->LEN - 1; i >= 0; i--) { // Big endian 
+        dp[i] = (unsigned char)(d & 0xFF);
+        d   >>= 8;
+    }
+    return pd->LEN;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Supported PID bitmap response (PID 00/20/40...)
+ * ---------------------------------------------------------------------------------------- */
+int obd2_pid_support_get(int pid, unsigned char *dp)
+{
+    if (pid > 0 && (obd2_pid_support[(pid >> 5) - 1][3] & 0x01) == 0) { // Range not supported 
+        return 0;
+    }
+    memcpy(dp, obd2_pid_support[pid >> 5], 4);
+    return 4;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * MODE1 single PID value generation
+ * ---------------------------------------------------------------------------------------- */
+int obd2_mode1_pid(int pid, unsigned char *dp)
+{
+    const OBD2_PID_DESC *   pd;
+
+    if ((pid & 0x1F) == 0) { // PIDs supported [pid+1 - pid+20] 
+        return obd2_pid_support_get(pid, dp);
+    }
+    if (obd2_pid_index[pid] == 0xFF) { // Unsupported 
+        return 0;
+    }
+    pd = &obd2_pid_table[obd2_pid_index[pid]];
+    return obd2_pid_value(pd, &can_buf.ID[pd->ID].BYTE[pd->POS], dp);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame capture (call when a DTC is set)
+ *
+ *  Only the can_buf source bytes of the MODE1 PIDs are copied (scaling is applied
+ *  when MODE2 is requested), so the cost is one small copy per PID.
+ * ---------------------------------------------------------------------------------------- */
+void obd2_ff_capture(unsigned short dtc)
+{
+    int                     i;
+    const OBD2_PID_DESC *   pd;
+    OBD2_FREEZE_FRAME *     ff = &obd2_ff[obd2_ff_wp];
+
+    ff->CODE    = dtc;
+    ff->SEQ     = ++obd2_ff_seq;
+    for (i = 0, pd = obd2_pid_table; i < OBD2_PID_COUNT; i++, pd++) {
+        memcpy(&ff->DATA[obd2_ff_ofs[i]], &can_buf.ID[pd->ID].BYTE[pd->POS], obd2_src_size(pd->TYPE));
+    }
+    obd2_ff_wp = (obd2_ff_wp + 1) % OBD2_FF_MAX;
+    if (obd2_ff_num < OBD2_FF_MAX) {
+        obd2_ff_num++;
+    }
+#ifdef OBD2_FF_SAVE
+    if (obd2_ffs.CNT < OBD2_FF_MAX) { // Save request 
+        obd2_ffs.CNT++;
+    } else { // Oldest unsaved frame was overwritten 
+        obd2_ffs.RP = (obd2_ffs.RP + 1) % OBD2_FF_MAX;
+    }
+#endif
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame reference (0=Latest, NULL=None)
+ * ---------------------------------------------------------------------------------------- */
+OBD2_FREEZE_FRAME * obd2_ff_get(int frame)
+{
+    if (frame < 0 || frame >= obd2_ff_num) {
+        return 0;
+    }
+    return &obd2_ff[(obd2_ff_wp + OBD2_FF_MAX - 1 - frame) % OBD2_FF_MAX];
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame clear (MODE4)
+ * ---------------------------------------------------------------------------------------- */
+void obd2_ff_clear(void)
+{
+    memset(obd2_ff, 0, sizeof(obd2_ff));
+    obd2_ff_wp  = 0;
+    obd2_ff_num = 0;
+#ifdef OBD2_FF_SAVE
+    obd2_ffs.RP  = 0;
+    obd2_ffs.CNT = 0;
+    obd2_ffs.CLR = 1; // Erase the saved frames 
+#endif
+}
+
+#ifdef OBD2_FF_SAVE
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame restore from data flash
+ * ---------------------------------------------------------------------------------------- */
+void obd2_ff_load(void)
+{
+    int i;
+
+    Init_FlashData(); // Data flash read enable 
+    for (i = 0; i < OBD2_FF_SLOTS; i++) {
+        if (BlankCheckWord_FlashData(OBD2_FF_ADDR + i * sizeof(OBD2_FREEZE_FRAME)) == FLASH_BLANK) { // Unused slot 
             break;
-        case 0x2E: // Commanded evaporative purge 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Vaporization order 100/255*A 
+        }
+        memcpy(&obd2_ff[obd2_ff_wp], (void *)(OBD2_FF_ADDR + i * sizeof(OBD2_FREEZE_FRAME)), sizeof(OBD2_FREEZE_FRAME));
+        obd2_ff_seq = obd2_ff[obd2_ff_wp].SEQ;
+        obd2_ff_wp  = (obd2_ff_wp + 1) % OBD2_FF_MAX;
+        if (obd2_ff_num < OBD2_FF_MAX) {
+            obd2_ff_num++;
+        }
+    }
+    obd2_ffs.SLOT = i;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame data flash save processing (call from main loop)
+ *
+ *  Frames are appended to one data flash block with BGO. When the block is full it is
+ *  erased and the whole RAM ring is written again, so the latest frames always survive.
+ * ---------------------------------------------------------------------------------------- */
+void obd2_ff_job(void)
+{
+    if (obd2_ffs.RES == FLASH_BUSY || R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy 
+        return;
+    }
+    switch (obd2_ffs.STEP) {
+    case OBD2_FFS_ERASE: // Erase completed 
+        obd2_ffs.STEP = OBD2_FFS_IDLE;
+        if (obd2_ffs.RES != FLASH_SUCCESS) { // Erase failed (save stop) 
+            obd2_ffs.ERR++;
+            obd2_ffs.CNT = 0;
+            return;
+        }
+        obd2_ffs.SLOT = 0;
+        obd2_ffs.CNT  = obd2_ff_num; // Write back the whole ring 
+        obd2_ffs.RP   = (obd2_ff_wp + OBD2_FF_MAX - obd2_ff_num) % OBD2_FF_MAX;
+        return;
+    case OBD2_FFS_WRITE: // Write completed 
+        obd2_ffs.STEP = OBD2_FFS_IDLE;
+        if (obd2_ffs.RES != FLASH_SUCCESS) {
+            obd2_ffs.ERR++;
+        }
+        obd2_ffs.SLOT++;
+        if (obd2_ffs.CNT > 0) {
+            obd2_ffs.CNT--;
+            obd2_ffs.RP = (obd2_ffs.RP + 1) % OBD2_FF_MAX;
+        }
+        return;
+    }
+    if (obd2_ffs.CLR == 0 && obd2_ffs.CNT == 0) { // No request 
+        return;
+    }
+    if (uds_prog_busy() || uds_load.MODE != UDS_TD_NONE) { // UDS is using the flash 
+        return;
+    }
+    if (obd2_ffs.CLR != 0 || obd2_ffs.SLOT >= OBD2_FF_SLOTS) { // Clear or block full 
+        obd2_ffs.CLR = 0;
+        if (EraseBgo_FlashData(OBD2_FF_BLOCK, &obd2_ffs.RES) == FLASH_SUCCESS) {
+            obd2_ffs.STEP = OBD2_FFS_ERASE;
+        } else {
+            obd2_ffs.ERR++;
+            obd2_ffs.CNT = 0;
+        }
+        return;
+    }
+    memcpy(&obd2_ffs.BUF, &obd2_ff[obd2_ffs.RP], sizeof(OBD2_FREEZE_FRAME)); // Stable copy during BGO 
+    if (WriteBgo_FlashData(OBD2_FF_ADDR + obd2_ffs.SLOT * sizeof(OBD2_FREEZE_FRAME), (uint32_t)&obd2_ffs.BUF, sizeof(OBD2_FREEZE_FRAME), &obd2_ffs.RES) == FLASH_SUCCESS) {
+        obd2_ffs.STEP = OBD2_FFS_WRITE;
+    } else {
+        obd2_ffs.ERR++;
+        obd2_ffs.CNT = 0;
+    }
+}
+#endif // OBD2_FF_SAVE
+
+/* ----------------------------------------------------------------------------------------
+ * DTC manager
+ *
+ *  RAM table  : dtc_tbl[DTC_MAX] with a hash index (dtc_index) for O(1) lookup by code
+ *  Log        : 8 byte records appended to BLOCK_DB4 / BLOCK_DB5 (not used by ecu_data_write)
+ *               A DTC change costs one small program operation (BGO, dtc_job) and no erase.
+ *               When a block reaches its reserve area all live DTCs are written again into
+ *               the reserve, then the other block is erased and becomes the write block,
+ *               so the log is always complete even if the power fails during the erase.
+ *  Start-up   : The older block and then the newer block are replayed to rebuild the table.
+ * ---------------------------------------------------------------------------------------- */
+DTC_ENTRY       dtc_tbl[DTC_MAX];       // DTC table 
+unsigned char   dtc_index[DTC_HASH];    // Code -> table number + 1 (0=Empty) 
+DTC_LOG_STR     dtc_log = { DTC_LS_LOAD, 0, 0, -1 }; // Log control (restored by obd2_init) 
+
+/* ----------------------------------------------------------------------------------------
+ * DTC hash
+ * ---------------------------------------------------------------------------------------- */
+int dtc_hash(unsigned long code)
+{
+    return (int)((code ^ (code >> 7) ^ (code >> 15)) & (DTC_HASH - 1));
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC index rebuild
+ * ---------------------------------------------------------------------------------------- */
+void dtc_reindex(void)
+{
+    int i, h;
+
+    memset(dtc_index, 0, sizeof(dtc_index));
+    for (i = 0; i < DTC_MAX; i++) {
+        if (dtc_tbl[i].CODE == 0) {
+            continue;
+        }
+        for (h = dtc_hash(dtc_tbl[i].CODE); dtc_index[h] != 0; h = (h + 1) & (DTC_HASH - 1)) {
+            ;
+        }
+        dtc_index[h] = (unsigned char)(i + 1);
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC lookup (add=1 : Register when not found) 
+ * ---------------------------------------------------------------------------------------- */
+DTC_ENTRY * dtc_entry(unsigned long code, int add)
+{
+    int         i, h;
+    DTC_ENTRY * e;
+
+    for (h = dtc_hash(code); dtc_index[h] != 0; h = (h + 1) & (DTC_HASH - 1)) {
+        e = &dtc_tbl[dtc_index[h] - 1];
+        if (e->CODE == code) {
+            return e;
+        }
+    }
+    if (add == 0) {
+        return 0;
+    }
+    for (i = 0; i < DTC_MAX; i++) { // Free entry (unused or cleared and logged) 
+        e = &dtc_tbl[i];
+        if (e->CODE == 0 || (e->STAT == 0 && e->OCC == 0 && e->PERM == 0 && e->DIRTY == 0)) {
             break;
-        case 0x2F: // Fuel Tank Level Input 
-            len += 1;
-            d   = ((int)can_buf.ID[0x3D4].BYTE[0]) * 255 / 40; // 0..40 liter 
-            if (d > 255) {
-                d = 255;
+        }
+    }
+    if (i >= DTC_MAX) { // Table full 
+        dtc_log.LOST++;
+        return 0;
+    }
+    memset(e, 0, sizeof(DTC_ENTRY));
+    e->CODE = code;
+    e->STAT = DTC_ST_TNCSLC | DTC_ST_TNCTOC;
+    dtc_reindex();
+    return e;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC test result report (failed=1 : Fault detected / 0 : Test passed)
+ * ---------------------------------------------------------------------------------------- */
+void dtc_report(unsigned long code, int failed)
+{
+    DTC_ENTRY *     e;
+    unsigned char   st, pm;
+
+    e = dtc_entry(code, failed);
+    if (e == 0) { // Passed and never failed 
+        return;
+    }
+    st = e->STAT & ~(DTC_ST_TNCSLC | DTC_ST_TNCTOC);
+    if (failed) {
+        if ((e->STAT & DTC_ST_TF) == 0 && e->OCC < 255) { // New occurrence 
+            e->OCC++;
+        }
+        if ((e->STAT & DTC_ST_CDTC) == 0) { // First confirmation : freeze frame 
+            obd2_ff_capture((unsigned short)(code >> 8));
+        }
+        st |= DTC_ST_TF | DTC_ST_TFTOC | DTC_ST_PDTC | DTC_ST_CDTC | DTC_ST_TFSLC;
+        pm  = 1;
+    } else {
+        st &= ~DTC_ST_TF;
+        pm  = 0; // Permanent DTC is erased when the test passes 
+    }
+    if (st != e->STAT || pm != e->PERM) { // Any logged byte changed 
+        e->STAT  = st;
+        e->PERM  = pm;
+        e->DIRTY = 1;
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC table clear (Permanent DTCs remain)
+ * ---------------------------------------------------------------------------------------- */
+void dtc_clear_table(void)
+{
+    int         i;
+    DTC_ENTRY * e;
+
+    for (i = 0; i < DTC_MAX; i++) {
+        e = &dtc_tbl[i];
+        if (e->PERM != 0) {
+            e->STAT = DTC_ST_TNCSLC | DTC_ST_TNCTOC;
+            e->OCC  = 0;
+        } else {
+            memset(e, 0, sizeof(DTC_ENTRY));
+        }
+        e->DIRTY = 0;
+    }
+    dtc_reindex();
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC clear (0x14 / MODE4, DTC_GROUP_ALL=All DTCs) Return 0=OK / -1=Not found
+ * ---------------------------------------------------------------------------------------- */
+int dtc_clear(unsigned long code)
+{
+    DTC_ENTRY * e;
+
+    if (code == DTC_GROUP_ALL) { // All : one clear record 
+        dtc_clear_table();
+        obd2_ff_clear();
+        dtc_log.CLR = 1;
+        return 0;
+    }
+    e = dtc_entry(code, 0);
+    if (e == 0) {
+        return -1;
+    }
+    e->STAT  = (e->PERM) ? (DTC_ST_TNCSLC | DTC_ST_TNCTOC) : 0;
+    e->OCC   = 0;
+    e->DIRTY = 1;
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC log record address
+ * ---------------------------------------------------------------------------------------- */
+unsigned long dtc_log_addr(int blk, int slot)
+{
+    return DTC_LOG_ADDR + (unsigned long)blk * 2048 + (unsigned long)slot * sizeof(DTC_LOG_REC);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC log record replay
+ * ---------------------------------------------------------------------------------------- */
+void dtc_replay(DTC_LOG_REC *rp)
+{
+    unsigned long   code;
+    DTC_ENTRY *     e;
+
+    if ((rp->FLAG & 0xF0) != DTC_REC_MARK) { // Broken record 
+        return;
+    }
+    code = ((unsigned long)rp->CODE[0] << 16) | ((unsigned long)rp->CODE[1] << 8) | (unsigned long)rp->CODE[2];
+    if (code == DTC_GROUP_ALL) { // Clear record 
+        dtc_clear_table();
+        return;
+    }
+    e = dtc_entry(code, 1);
+    if (e != 0) {
+        e->STAT = rp->STAT;
+        e->OCC  = rp->OCC;
+        e->PERM = rp->FLAG & 0x01;
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC log restore (first blank slot is found by binary search, records are appended)
+ * ---------------------------------------------------------------------------------------- */
+void dtc_load(void)
+{
+    int             b, lo, hi, mid, nw, i;
+    int             cnt[2];
+    unsigned short  seq[2];
+    DTC_LOG_REC *   rp;
+
+    Init_FlashData(); // Data flash read enable 
+    memset(dtc_tbl, 0, sizeof(dtc_tbl));
+    memset(dtc_index, 0, sizeof(dtc_index));
+    for (b = 0; b < 2; b++) {
+        for (lo = 0, hi = DTC_LOG_SLOTS; lo < hi; ) {
+            mid = (lo + hi) / 2;
+            if (BlankCheckWord_FlashData(dtc_log_addr(b, mid)) == FLASH_BLANK) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
             }
-            obd2_ret.SAE_ECU.VAL[0] =
-                (unsigned char)d; // (A) 0 to 100[%] Fuel remaining  100/255*A 
-            break;
-        case 0x30: // Warm-ups since codes cleared 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 255[count] Warm-up count A 
-            break;
-        case 0x31: // Distance traveled since codes cleared 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65535[km] Preset odometer 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x32: // Evap. System Vapor Pressure 
-            len                    += 2;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -8192 to 8191.75[Pa] System vapor pressure (256*A+B)/4 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x33: // Absolute Barometric Pressure 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 255[kPa] Absolute pressure A 
-            break;
-        case 0x34:    // Oxygen Sensor 1  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 1 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x35:    // Oxygen Sensor 2  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 2 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x36:    // Oxygen Sensor 3  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 3 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x37:    // Oxygen Sensor 4  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 4 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x38:    // Oxygen Sensor 5  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 5 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x39:    // Oxygen Sensor 6  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 6 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x3A:    // Oxygen Sensor 7  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 7 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x3B:    // Oxygen Sensor 8  AB: Fuel-Air Equivalence Ratio CD: Current 
-            len                    += 4; // Oxygen sensor 8 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -128 to 128[mA] Sensor current (256*C+D)/256-128 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) ↑ Lower 8bit 
-            break;
-        case 0x3C:    // Catalyst Temperature: Bank 1, Sensor 1 
-            len                    += 2; // Accelerator temperature bank 1 sensor 1 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -40 to 6513.5[° C] Temperature (256*A+B)/10-40 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x3D:    // Catalyst Temperature: Bank 2, Sensor 1 
-            len                    += 2; // Accelerator temperature bank 2 sensor 1 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -40 to 6513.5[° C] Temperature (256*A+B)/10-40 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x3E:    // Catalyst Temperature: Bank 1, Sensor 2 
-            len                    += 2; // Accelerator temperature bank 1 sensor 2 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -40 to 6513.5[° C] Temperature (256*A+B)/10-40 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x3F:    // Catalyst Temperature: Bank 2, Sensor 2 
-            len                    += 2; // Accelerator temperature bank 2 sensor 2 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -40 to 6513.5[° C] Temperature (256*A+B)/10-40 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-                   //------------------------------------------------------ 
-        case 0x40: // PIDs supported [41 - 60]
-                   // ------------------------------------------------------
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x80;
-            obd2_ret.SAE_ECU.VAL[2] = 0x80;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00; // 0x49,0x51 
-            break;
-        case 0x41: // Monitor status this drive cycle 
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00; // (A) [0] 
-            obd2_ret.SAE_ECU.VAL[1] =
-                0x00; /* (B) bit7:[0] / bit3: 0 = spark plug type, 1 = diesel /
-                       * bit2: configuration test, bit6: incomplete / bit1: fuel gauge
-                       * test, bit5: incomplete / bit0: misfire test, bit4: incomplete*/
-            obd2_ret.SAE_ECU.VAL[2] =
-                0x00; /* (C) bit7: EGR system test / bit6: Oxygen sensor heater
-                       * test / bit5: Oxygen sensor test / bit4: AC refrigerant test /
-                       * bit3: 2nd air system test / bit2: Evaporation system test /
-                       * bit1: Heating accelerator test / bit0: Acceleration Agent
-                       * test*/
-            obd2_ret.SAE_ECU.VAL[3] =
-                0x00; /* (D) bit7: Incomplete EGR system / bit6: Incomplete oxygen
-                       * sensor heater / bit5: Incomplete oxygen sensor / bit4:
-                       * Incomplete AC refrigerant / bit3: Incomplete 2nd air system /
-                       * bit2: Incomplete evaporation system / bit1: Heating promotion
-                       * Incomplete agent / bit0: Incomplete accelerator*/
-            break;
-        case 0x42:    // Control module voltage 
-            len                    += 2; // Control module voltage 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65.535[V] Voltage (256*A+B)/1000 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x43:    // Absolute load value 
-            len                    += 2; // Absolute load value 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 25700[%] Amount of work 100/255*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x44:    // Fuel-Air commanded equivalence ratio 
-            len                    += 2; // Fuel-Air commanded equivalence ratio 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 2[ratio] Fuel mixture ratio 2/65536*(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x45: // Relative throttle position 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Throttle relative position 100/255*A 
-            break;
-        case 0x46: // Ambient air temperature 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -40 to 215[° C] Ambient temperature A-40 
-            break;
-        case 0x47: // Absolute throttle position B 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Throttle absolute position B 100/255*A 
-            break;
-        case 0x48: // Absolute throttle position C 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Throttle absolute position C 100/255*A 
-            break;
-        case 0x49: // Accelerator pedal position D 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Accelerator position D 100/255*A 
-            break;
-        case 0x4A: // Accelerator pedal position E 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Accelerator position E 100/255*A 
-            break;
-        case 0x4B: // Accelerator pedal position F 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Accelerator position F 100/255*A 
-            break;
-        case 0x4C: // Commanded throttle actuator 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Throttle start command 100/255*A 
-            break;
-        case 0x4D:    // Time run with MIL on 
-            len                    += 2; // Elapsed MIL firing time 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65535[min.] Elapsed time 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x4E:    // Time since trouble codes cleared 
-            len                    += 2; // Time since trouble codes cleared 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 65535[min.] Elapsed time 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x4F: /* Maximum value for Fuel-Air equivalence ratio, oxygen sensor
-                    * voltage, oxygen sensor current, and intake manifold absolute
-                    * pressure. */
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00; // (A) 0 to 255[ratio] Mixture ratio  A 
-            obd2_ret.SAE_ECU.VAL[1] = 0x00; // (B) 0 to 255[V]     Oxygen sensor voltage B 
-            obd2_ret.SAE_ECU.VAL[2] = 0x00; // (C) 0 to 255[mA]    Oxygen sensor current C 
-            obd2_ret.SAE_ECU.VAL[3] = 0x00; // (D) 0 to 2550[kPa]  Intake pressure  D*10 
-            break;
-        case 0x50: // Maximum value for air flow rate from mass air flow sensor 
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] =
-                0x00; // (A) 0 to 2550[g/s] Maximum air flow  A*10 
-            obd2_ret.SAE_ECU.VAL[1] = 0x00; // (B) Spare 
-            obd2_ret.SAE_ECU.VAL[2] = 0x00; // (C) Spare 
-            obd2_ret.SAE_ECU.VAL[3] = 0x00; // (D) Spare 
-            break;
-        case 0x51: // Fuel Type 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] =
-                1; /* (A) 1: Gasoline / 2: Methanol / 3: Ethanol / 4: Diesel / 5:
-                    * LPG / 6: CNG / 7: Propane / 8: Electric / 21: Combined
-                    * continuous electric and internal combustion engine (Prius)*/
-            break;
-        case 0x52: // Ethanol fuel % 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Ethanol fuel 100/255*A 
-            break;
-        case 0x53:    // Absolute Evap system Vapor Pressure 
-            len                    += 2; // Absolute Evap system Vapor Pressure 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 327.675[kPa] Barometric pressure (256*A+B)/200 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x54:    // Evap system vapor pressure 
-            len                    += 2; // Evap system vapor pressure 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -32767 to 32767[Pa] Barometric pressure (256*A+B)-32767 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x55: // Short term secondary oxygen sensor trim, A: bank 1, B: bank 3 
-            len                    += 2; // Short term secondary oxygen sensor trim 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -100 to 99.2[%] Bank 1 adjustment value  100/128*A-100 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) -100 to 99.2[%] Bank 3 adjustment value  100/128*A-100 
-            break;
-        case 0x56:    // Long term secondary oxygen sensor trim, A: bank 1, B: bank 3 
-            len                    += 2; // Long term secondary oxygen sensor trim 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -100 to 99.2[%] Bank 1 adjustment value  100/128*A-100 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) -100 to 99.2[%] Bank 3 adjustment value  100/128*A-100 
-            break;
-        case 0x57: // Short term secondary oxygen sensor trim, A: bank 2, B: bank 4 
-            len                    += 2; // Short term secondary oxygen sensor trim 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -100 to 99.2[%] Bank 2 adjustment value  100/128*A-100 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) -100 to 99.2[%] Bank 4 adjustment value  100/128*A-100 
-            break;
-        case 0x58:    // Long term secondary oxygen sensor trim, A: bank 2, B: bank 4 
-            len                    += 2; // Long term secondary oxygen sensor trim 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -100 to 99.2[%] Bank 2 adjustment value  100/128*A-100 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) -100 to 99.2[%] Bank 4 adjustment value  100/128*A-100 
-            break;
-        case 0x59:    // Fuel rail absolute pressure 
-            len                    += 2; // Fuel rail absolute pressure 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 655350[kPa] Barometric pressure  10(256*A+B) 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x5A: // Relative accelerator pedal position 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Accelerator relative position 100/255*A 
-            break;
-        case 0x5B: // Hybrid battery pack remaining life 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 100[%] Hybrid battery level 100/255*A 
-            break;
-        case 0x5C: // Engine oil temperature 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // -40 to 210[° C] Engine oil temperature  A-40 
-            break;
-        case 0x5D:    // Fuel injection timing 
-            len                    += 2; // Fuel injection timing 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -210.00 to 301.992[°] Timing (256*A+B)/128-210 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x5E:    // Engine fuel rate 
-            len                    += 2; // Engine fuel rate 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 3276.75[L/h] Hourly fuel consumption (256*A+B)/20 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x5F: // Emission requirements to which vehicle is designed 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) Vehicle release condition design value? 
-            break;
-                   //------------------------------------------------------ 
-        case 0x60: // PIDs supported [61 - 80]
-                   // ------------------------------------------------------ 
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
-        case 0x61: // Driver's demand engine - percent torque 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -125 to 125[%] Driver demand torque  A-125 
-            break;
-        case 0x62: // Actual engine - percent torque 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -125 to 125[%] Actual engine torque  A-125 
-            break;
-        case 0x63: // Engine reference torque 
-            len                    += 2; // Engine reference torque 
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) 0 to 655.35[Nm] Torque 256*A+B 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) ↑ Lower 8bit 
-            break;
-        case 0x64: // Engine percent torque data 
-            len                    += 5;
-            obd2_ret.SAE_ECU.VAL[0] = 0; // (A) -125 to 125[%] Idle torque A-125 
-            obd2_ret.SAE_ECU.VAL[1] = 0; // (B) -125 to 125[%] Engine point 1 B-125 
-            obd2_ret.SAE_ECU.VAL[2] = 0; // (C) -125 to 125[%] Engine point 2 C-125 
-            obd2_ret.SAE_ECU.VAL[3] = 0; // (D) -125 to 125[%] Engine point 3 D-125 
-            obd2_ret.SAE_ECU.VAL[4] = 0; // (E) -125 to 125[%] Engine point 4 E-125 
-            break;
-        case 0x65: // Auxiliary input / output supported 
-            break;
-        case 0x66: // Mass air flow sensor 
-            break;
-        case 0x67: // Engine coolant temperature 
-            break;
-        case 0x68: // Intake air temperature sensor 
-            break;
-        case 0x69: // Commanded EGR and EGR Error 
-            break;
-        case 0x6A: /* Commanded Diesel intake air flow control and relative intake
-                    *   air flow position*/
-            break;
-        case 0x6B: // Exhaust gas recirculation temperature 
-            break;
-        case 0x6C: /* Commanded throttle actuator control and relative throttle
-                    *   position*/
-            break;
-        case 0x6D: // Fuel pressure control system 
-            break;
-        case 0x6E: // Injection pressure control system 
-            break;
-        case 0x6F: // Turbocharger compressor inlet pressure 
-            break;
-        case 0x70: // Boost pressure control 
-            break;
-        case 0x71: // Variable Geometry turbo (VGT) control 
-            break;
-        case 0x72: // Wastegate control 
-            break;
-        case 0x73: // Exhaust pressure 
-            break;
-        case 0x74: // Turbocharger RPM 
-            break;
-        case 0x75: // Turbocharger temperature 
-            break;
-        case 0x76: // Turbocharger temperature 
-            break;
-        case 0x77: // Charge air cooler temperature (CACT) 
-            break;
-        case 0x78:    // Exhaust Gas temperature (EGT) Bank 1 
-            len += 4; // Bank 1 exhaust gas temperature 
-            switch (obd2_ret_counter) {
-            case 0:
-                len = 1;
-                obd2_ret.SAE_ECU.VAL[0] = 0x01; /* 1: EGT sensor 1/2: EGT sensor
-                                                 * 2/4: EGT sensor 3/8: EGT sensor 4*/
-                break;
-            case 1: // EGT sensor 1, EGT sensor 2 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 2: // EGT sensor 3, EGT sensor 4 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
+        }
+        cnt[b] = lo;
+        seq[b] = (lo > 0) ? ((DTC_LOG_REC *)dtc_log_addr(b, 0))->SEQ : 0;
+    }
+    if (cnt[1] == 0) { // Newer block 
+        nw = 0;
+    } else if (cnt[0] == 0) {
+        nw = 1;
+    } else {
+        nw = ((short)(seq[1] - seq[0]) > 0) ? 1 : 0;
+    }
+    for (b = nw ^ 1, i = 0; i < 2; i++, b ^= 1) { // Older -> newer 
+        for (mid = 0; mid < cnt[b]; mid++) {
+            rp = (DTC_LOG_REC *)dtc_log_addr(b, mid);
+            dtc_replay(rp);
+            dtc_log.SEQ = rp->SEQ;
+        }
+    }
+    dtc_log.BLK  = nw;
+    dtc_log.SLOT = cnt[nw];
+    dtc_log.CPT  = -1;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * DTC log processing (call from main loop)
+ * ---------------------------------------------------------------------------------------- */
+void dtc_job(void)
+{
+    int             i;
+    unsigned long   code;
+    DTC_ENTRY *     e = 0;
+
+    if (dtc_log.RES == FLASH_BUSY || R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy 
+        return;
+    }
+    switch (dtc_log.STEP) {
+    case DTC_LS_ERASE: // Other block erased : switch the write block 
+        dtc_log.STEP = DTC_LS_IDLE;
+        if (dtc_log.RES != FLASH_SUCCESS) { // Retry from the compaction 
+            dtc_log.ERR++;
+            dtc_log.CPT = -1;
+            return;
+        }
+        dtc_log.BLK ^= 1;
+        dtc_log.SLOT = 0;
+        dtc_log.CPT  = -1;
+        return;
+    case DTC_LS_WRITE: // Record written 
+        dtc_log.STEP = DTC_LS_IDLE;
+        if (dtc_log.RES != FLASH_SUCCESS) {
+            dtc_log.ERR++;
+        }
+        dtc_log.SLOT++;
+        return;
+    }
+    if (uds_prog_busy() || uds_load.MODE != UDS_TD_NONE) { // UDS is using the flash 
+        return;
+    }
+    if (dtc_log.CPT < 0 && dtc_log.SLOT >= DTC_LOG_SLOTS - DTC_LOG_RESERVE) { // Reserve reached : compaction 
+        dtc_log.CPT = 0;
+    }
+    if (dtc_log.CLR == 0) {
+        if (dtc_log.CPT >= 0) { // Compaction : every live DTC 
+            for (; dtc_log.CPT < DTC_MAX; dtc_log.CPT++) {
+                if (dtc_tbl[dtc_log.CPT].CODE != 0) {
+                    e = &dtc_tbl[dtc_log.CPT++];
+                    break;
+                }
             }
-            obd2_ret_counter++;
-            if (obd2_ret_counter >= 3) {
-                obd2_ret_counter = 0;
+            if (e == 0) { // Compaction completed : erase the other block 
+                if (EraseBgo_FlashData((uint8_t)(DTC_LOG_BLOCK + (dtc_log.BLK ^ 1)), &dtc_log.RES) == FLASH_SUCCESS) {
+                    dtc_log.STEP = DTC_LS_ERASE;
+                } else {
+                    dtc_log.ERR++;
+                }
+                return;
             }
-            break;
-        case 0x79:    // Exhaust Gas temperature (EGT) Bank 2 
-            len += 4; // Bank 2 exhaust gas temperature 
-            switch (obd2_ret_counter) {
-            case 0:
-                len = 1;
-                obd2_ret.SAE_ECU.VAL[0] = 0x01; /* 1: EGT sensor 1/2: EGT sensor
-                                                 * 2/4: EGT sensor 3/8: EGT sensor 4*/
-                break;
-            case 1: // EGT sensor 1, EGT sensor 2 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 2: // EGT sensor 3, EGT sensor 4 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
+        } else { // Changed DTC 
+            for (i = 0; i < DTC_MAX; i++) {
+                if (dtc_tbl[i].DIRTY != 0) {
+                    e = &dtc_tbl[i];
+                    break;
+                }
             }
-            obd2_ret_counter++;
-            if (obd2_ret_counter >= 3) {
-                obd2_ret_counter = 0;
+            if (e == 0) { // No request 
+                return;
             }
-            break;
-        case 0x7A: // Diesel particulate filter (DPF) 
-            break;
-        case 0x7B: // Diesel particulate filter (DPF) 
-            break;
-        case 0x7C: // Diesel Particulate filter (DPF) temperature 
-            break;
-        case 0x7D: // NOx NTE control area status 
-            break;
-        case 0x7E: // PM NTE control area status 
-            break;
-        case 0x7F: // Engine run time 
-            break;
-        //------------------------------------------------------ 
-        case 0x80: /* PIDs supported [81 - A0]
-                    * ------------------------------------------------------ */
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
-        case 0x81: // Engine run time for Auxiliary Emissions Control Device(AECD) 
-            break;
-        case 0x82: // Engine run time for Auxiliary Emissions Control Device(AECD) 
-            break;
-        case 0x83: // NOx sensor 
-            break;
-        case 0x84: // Manifold surface temperature 
-            break;
-        case 0x85: // NOx reagent system 
-            break;
-        case 0x86: // Particulate matter (PM) sensor 
-            break;
-        case 0x87: // Intake manifold absolute pressure 
-            break;
-                   //------------------------------------------------------ 
-        case 0xA0: // PIDs supported [A1 - C0]
-                   // ------------------------------------------------------ 
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
-                   //------------------------------------------------------ 
-        case 0xC0: // PIDs supported [C1 - E0]
-                   // ------------------------------------------------------
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
-                   //------------------------------------------------------ 
-        case 0xE0: // PIDs supported [E1 - FF]
-                   // ------------------------------------------------------
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
         }
+    }
+    if (dtc_log.SLOT >= DTC_LOG_SLOTS) { // Block full (erase failure) 
+        return;
+    }
+    memset(&dtc_log.BUF, 0, sizeof(DTC_LOG_REC));
+    if (e == 0) { // Clear record 
+        code         = DTC_GROUP_ALL;
+        dtc_log.CLR  = 0;
     } else {
-        return 0;
+        code            = e->CODE;
+        e->DIRTY        = 0;
+        dtc_log.BUF.STAT = e->STAT;
+        dtc_log.BUF.OCC  = e->OCC;
+        dtc_log.BUF.FLAG = e->PERM;
+    }
+    dtc_log.BUF.CODE[0]  = (unsigned char)(code >> 16);
+    dtc_log.BUF.CODE[1]  = (unsigned char)(code >> 8);
+    dtc_log.BUF.CODE[2]  = (unsigned char)code;
+    dtc_log.BUF.FLAG    |= DTC_REC_MARK;
+    dtc_log.BUF.SEQ      = ++dtc_log.SEQ;
+    if (WriteBgo_FlashData(dtc_log_addr(dtc_log.BLK, dtc_log.SLOT), (uint32_t)&dtc_log.BUF, sizeof(DTC_LOG_REC), &dtc_log.RES) == FLASH_SUCCESS) {
+        dtc_log.STEP = DTC_LS_WRITE;
+    } else { // Not started : the slot stays blank and the record is written again at the next pass 
+        dtc_log.ERR++;  // (dtc_load stops at the first blank slot, so a skipped slot would hide the later records) 
+        dtc_log.SEQ--;
+        if (e == 0) {
+            dtc_log.CLR = 1;
+        } else if (dtc_log.CPT >= 0) {
+            dtc_log.CPT = (int)(e - dtc_tbl);
+        } else {
+            e->DIRTY = 1;
+        }
     }
-    return len;
 }
 
 /* ----------------------------------------------------------------------------------------
- * MODE2 Processing (DTC record return request)
+ * DTC snapshot record [Number of DIDs][DID F4xx][Value]... (latest freeze frame of the DTC)
  * ---------------------------------------------------------------------------------------- */
-int obd2_mode2(int len)
+int dtc_snapshot(unsigned long code, unsigned char *res)
 {
-    if (len == 2) { // Standard requirements 
-        len = 2;
-        obd2_ret.SAE_ECU.MODE   = obd2_req.SAE_OBD.MODE + 0x40;
-        obd2_ret.SAE_ECU.PID    = obd2_req.SAE_OBD.PID;
-        switch (obd2_req.SAE_OBD.PID) {
-                   //------------------------------------------------------ 
-        case 0x02: // DTC that caused freeze frame to be stored.
-                   // ------------------------------------------------------
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0x00;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
+    int                     i, k, n;
+    OBD2_FREEZE_FRAME *     ff;
+    const OBD2_PID_DESC *   pd;
+
+    for (i = 0; (ff = obd2_ff_get(i)) != 0; i++) { // Latest first 
+        if (ff->CODE == (unsigned short)(code >> 8)) {
             break;
         }
-    } else {
+    }
+    if (ff == 0) { // No freeze frame 
+        return -1;
+    }
+    res[0] = 0;
+    for (i = 0, n = 1, pd = obd2_pid_table; i < OBD2_PID_COUNT; i++, pd++) {
+        res[n]     = 0xF4; // DID F4xx (OBD PID) 
+        res[n + 1] = pd->PID;
+        k          = obd2_pid_value(pd, &ff->DATA[obd2_ff_ofs[i]], &res[n + 2]);
+        if (k > 0) {
+            n += 2 + k;
+            res[0]++;
+        }
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * OBD2 DTC list response [MODE+0x40][Count][DTC 2 byte]... (DTCs matching 'mask')
+ * ---------------------------------------------------------------------------------------- */
+int obd2_dtc_list(int mask, int perm, unsigned char *res)
+{
+    int         i, n;
+    DTC_ENTRY * e;
+
+    res[0] = obd2_req.SAE_OBD.MODE + 0x40;
+    for (i = 0, n = 0; i < DTC_MAX; i++) {
+        e = &dtc_tbl[i];
+        if (e->CODE == 0 || ((e->STAT & mask) == 0 && (perm == 0 || e->PERM == 0))) {
+            continue;
+        }
+        res[2 + n * 2] = (unsigned char)(e->CODE >> 16);
+        res[3 + n * 2] = (unsigned char)(e->CODE >> 8);
+        n++;
+    }
+    res[1] = (unsigned char)n;
+    return 2 + n * 2;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * MODE1 Processing (up to 6 PIDs per request)
+ * ---------------------------------------------------------------------------------------- */
+int obd2_mode1(int len, unsigned char *res)
+{
+    int i, k, n;
+
+    if (len < 2 || len > 7) { // 1 to 6 PIDs 
         return 0;
     }
-    return len;
+    res[0] = obd2_req.SAE_OBD.MODE + 0x40; // Response flag 
+    n      = 1;
+    for (i = 1; i < len; i++) {
+        res[n] = obd2_req.BYTE[i];         // Parameter ID copy 
+        k      = obd2_mode1_pid(obd2_req.BYTE[i], &res[n + 1]);
+        if (k > 0) { // Supported PID only 
+            n += 1 + k;
+        }
+    }
+    if (n == 1) { // No supported PID (no response) 
+        return 0;
+    }
+    return n;
 }
 
 /* ----------------------------------------------------------------------------------------
- * MODE3 Processing (reply saved DTC record)
+ * MODE2 Processing (freeze frame, up to 3 PID / frame pairs per request)
  * ---------------------------------------------------------------------------------------- */
-int obd2_mode3(int len)
+int obd2_mode2(int len, unsigned char *res)
 {
-    if (len == 2) { // Standard requirements 
-        len = 7;
-        obd2_ret.MD3_ECU.MODE   = obd2_req.SAE_OBD.MODE + 0x40;
-        obd2_ret.MD3_ECU.VAL[0] = 0x00;
-        obd2_ret.MD3_ECU.VAL[1] = 0x00;
-        obd2_ret.MD3_ECU.VAL[2] = 0x00;
-        obd2_ret.MD3_ECU.VAL[3] = 0x00;
-        obd2_ret.MD3_ECU.VAL[4] = 0x00;
-        obd2_ret.MD3_ECU.VAL[5] = 0x00;
-    } else {
+    int                     i, k, n, pid;
+    OBD2_FREEZE_FRAME *     ff;
+    const OBD2_PID_DESC *   pd;
+
+    if (len < 3 || (len & 1) == 0) { // [PID][Frame] pairs 
         return 0;
     }
-    return len;
+    res[0] = obd2_req.SAE_OBD.MODE + 0x40; // Response flag 
+    n      = 1;
+    for (i = 1; i + 1 < len; i += 2) {
+        pid        = obd2_req.BYTE[i];
+        ff         = obd2_ff_get(obd2_req.BYTE[i + 1]);
+        res[n]     = (unsigned char)pid;        // Parameter ID copy 
+        res[n + 1] = obd2_req.BYTE[i + 1];      // Frame number copy 
+        k          = 0;
+        if ((pid & 0x1F) == 0) {    // PIDs supported (PID 02 added) 
+            k = obd2_pid_support_get(pid, &res[n + 2]);
+            if (k > 0 && pid == 0x00) { // PID 01 is not available in MODE2 
+                res[n + 2] = (res[n + 2] & 0x3F) | 0x40;
+            }
+        } else if (pid == 0x02) {   // DTC that caused freeze frame to be stored (0000=None) 
+            res[n + 2] = (ff) ? (unsigned char)(ff->CODE >> 8) : 0;
+            res[n + 3] = (ff) ? (unsigned char)(ff->CODE & 0xFF) : 0;
+            k          = 2;
+        } else if (ff != 0 && obd2_pid_index[pid] != 0xFF) { // Captured value 
+            pd = &obd2_pid_table[obd2_pid_index[pid]];
+            k  = obd2_pid_value(pd, &ff->DATA[obd2_ff_ofs[obd2_pid_index[pid]]], &res[n + 2]);
+        }
+        if (k > 0) { // Supported PID only 
+            n += 2 + k;
+        }
+    }
+    if (n == 1) { // No supported PID (no response) 
+        return 0;
+    }
+    return n;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * MODE3 Processing (reply confirmed DTC)
+ * ---------------------------------------------------------------------------------------- */
+int obd2_mode3(int len, unsigned char *res)
+{
+    if (len != 1) { // Standard requirements 
+        return 0;
+    }
+    return obd2_dtc_list(DTC_ST_CDTC, 0, res);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -870,9 +815,10 @@ int obd2_mode3(int len)
  * ---------------------------------------------------------------------------------------- */
 int obd2_mode4(int len)
 {
-    if (len == 2) { // Standard requirements 
+    if (len == 1) { // Standard requirements 
         len                   = 1;
         obd2_ret.MD3_ECU.MODE = obd2_req.SAE_OBD.MODE + 0x40;
+        dtc_clear(DTC_GROUP_ALL); // DTC and freeze frame clear 
     } else {
         return 0;
     }
@@ -992,17 +938,14 @@ int obd2_mode6(int len)
 }
 
 /* ----------------------------------------------------------------------------------------
- * MODE7 Obtain unknown diagnostic trouble code information
+ * MODE7 Obtain unknown diagnostic trouble code information (pending DTC)
  * ---------------------------------------------------------------------------------------- */
-int obd2_mode7(int len)
+int obd2_mode7(int len, unsigned char *res)
 {
-    if (len == 2) { // Standard requirements 
-        len = 1;
-        obd2_ret.MD3_ECU.MODE = obd2_req.SAE_OBD.MODE + 0x40;
-    } else {
+    if (len != 1) { // Standard requirements 
         return 0;
     }
-    return len;
+    return obd2_dtc_list(DTC_ST_PDTC, 0, res);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1020,251 +963,78 @@ int obd2_mode8(int len)
 }
 
 /* ----------------------------------------------------------------------------------------
- * MODE9 Processing
+ * MODE9 prepared response generation
+ * ---------------------------------------------------------------------------------------- */
+extern const char def_ecu_name[]; // 16] = "ECU1S"; 
+extern const char def_ecu_vars[]; // 16] = "Ver2.5"; 
+const char obd2_unit_name[9][5] = { "POWE", "CHAS", "BODY", "ECU3", "ECU4", "ECU5", "ECU6", "CGW1", "????" };
+
+void obd2_mode9_prepare(void)
+{
+    int             i, n;
+    OBD2_PREP_STR * pp;
+
+    memset(obd2_mode9_prep, 0, sizeof(obd2_mode9_prep));
+    for (i = 0; i < OBD2_MODE9_PIDS; i++) {
+        obd2_mode9_prep[i].BUF[0] = REQUEST_VEHICLE_INFO + 0x40;
+        obd2_mode9_prep[i].BUF[1] = (unsigned char)i;
+    }
+    // Mode 9 supported PIDs (01 to 20) : 0x04, 0x09, 0x0A 
+    pp         = &obd2_mode9_prep[0x00];
+    pp->BUF[2] = 0x10;
+    pp->BUF[3] = 0xC0;
+    pp->LEN    = 6;
+    // Calibration ID (16 byte, name + version) 
+    pp         = &obd2_mode9_prep[0x04];
+    pp->BUF[2] = 1; // Number of data items 
+    n          = strlen(def_ecu_name);
+    n          = (n > 16) ? 16 : n;
+    memcpy(&pp->BUF[3], def_ecu_name, n);
+    i          = strlen(def_ecu_vars);
+    memcpy(&pp->BUF[3 + n], def_ecu_vars, (i > 16 - n) ? 16 - n : i);
+    pp->LEN    = 3 + 16;
+    // ECU name message count 
+    pp         = &obd2_mode9_prep[0x09];
+    pp->BUF[2] = 5; // (A) ECU name character length 
+    pp->LEN    = 3;
+    // ECU name (20 byte, "unit" + '-' + name) 
+    pp         = &obd2_mode9_prep[0x0A];
+    pp->BUF[2] = 1; // Number of data items 
+    i          = SELECT_ECU_UNIT;
+    memcpy(&pp->BUF[3], obd2_unit_name[(i < 8) ? i : 8], 4);
+    pp->BUF[7] = '-';
+    n          = strlen(def_ecu_name);
+    memcpy(&pp->BUF[8], def_ecu_name, (n > 15) ? 15 : n);
+    pp->LEN    = 3 + 20;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * MODE9 Processing (prepared response is handed over to CAN-TP without copy)
  * ---------------------------------------------------------------------------------------- */
 int obd2_mode9(int len)
 {
-    if (len >= 2) { // Standard requirements 
-        len = 2;
-        obd2_ret.SAE_ECU.MODE = obd2_req.SAE_OBD.MODE + 0x40;
-        obd2_ret.SAE_ECU.PID  = obd2_req.SAE_OBD.PID;
-        switch (obd2_req.SAE_OBD.PID) {
-                   //------------------------------------------------------ 
-        case 0x00: // Mode 9 supported PIDs (01 to 20)
-                   //------------------------------------------------------ 
-            len                    += 4;
-            obd2_ret.SAE_ECU.VAL[0] = 0x00;
-            obd2_ret.SAE_ECU.VAL[1] = 0xC0;
-            obd2_ret.SAE_ECU.VAL[2] = 0x00;
-            obd2_ret.SAE_ECU.VAL[3] = 0x00;
-            break;
-        case 0x01: /* VIN Message Count in PID 02. Only for ISO 9141-2, ISO 14230-4
-                    * and SAE J1850.*/
-            break;
-        case 0x02: // Vehicle Identification Number (VIN) 
-            break;
-        case 0x03: /* Calibration ID message count for PID 04. Only for ISO 9141-2,
-                    * ISO 14230-4 and SAE J1850.*/
-            break;
-        case 0x04: // Calibration ID 
-            break;
-        case 0x05: /* Calibration verification numbers (CVN) message count for PID
-                    * 06. Only for ISO 9141-2, ISO 14230-4 and SAE J1850.*/
-            break;
-        case 0x06: // Calibration Verification Numbers (CVN) 
-            break;
-        case 0x07: /* In-use performance tracking message count for PID 08 and 0B.
-                    * Only for ISO 9141-2, ISO 14230-4 and SAE J1850.*/
-            break;
-        case 0x08: // In-use performance tracking for spark ignition vehicles 
-            len += 4;
-            switch (obd2_ret_counter) {
-            case 0: // OBDCOND, IGNCNTR 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 1: // HCCATCOMP, HCCATCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 2: // NCATCOMP, NCATCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 3: // NADSCOMP, NADSCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 4: // PMCOMP, PMCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 5: // EGSCOMP, EGSCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 6: // EGRCOMP, EGRCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 7: // BPCOMP, BPCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 8: // FUELCOMP, FUELCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            }
-            obd2_ret_counter++;
-            if (obd2_ret_counter >= 9) {
-                obd2_ret_counter = 0;
-            }
-            break;
-        case 0x09: // ECU name message count for PID 0A 
-            len                    += 1;
-            obd2_ret.SAE_ECU.VAL[0] = 5; // (A) ECU name character length 
-            break;
-        case 0x0A: // ECU name 
-            len += 5;
-            switch (SELECT_ECU_UNIT) {
-            case 0: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'P';
-                obd2_ret.SAE_ECU.VAL[1] = 'O';
-                obd2_ret.SAE_ECU.VAL[2] = 'W';
-                obd2_ret.SAE_ECU.VAL[3] = 'E';
-                break;
-            case 1: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'C';
-                obd2_ret.SAE_ECU.VAL[1] = 'H';
-                obd2_ret.SAE_ECU.VAL[2] = 'A';
-                obd2_ret.SAE_ECU.VAL[3] = 'S';
-                break;
-            case 2: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'B';
-                obd2_ret.SAE_ECU.VAL[1] = 'O';
-                obd2_ret.SAE_ECU.VAL[2] = 'D';
-                obd2_ret.SAE_ECU.VAL[3] = 'Y';
-                break;
-            case 3: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'E';
-                obd2_ret.SAE_ECU.VAL[1] = 'C';
-                obd2_ret.SAE_ECU.VAL[2] = 'U';
-                obd2_ret.SAE_ECU.VAL[3] = '3';
-                break;
-            case 4: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'E';
-                obd2_ret.SAE_ECU.VAL[1] = 'C';
-                obd2_ret.SAE_ECU.VAL[2] = 'U';
-                obd2_ret.SAE_ECU.VAL[3] = '4';
-                break;
-            case 5: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'E';
-                obd2_ret.SAE_ECU.VAL[1] = 'C';
-                obd2_ret.SAE_ECU.VAL[2] = 'U';
-                obd2_ret.SAE_ECU.VAL[3] = '5';
-                break;
-            case 6: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'E';
-                obd2_ret.SAE_ECU.VAL[1] = 'C';
-                obd2_ret.SAE_ECU.VAL[2] = 'U';
-                obd2_ret.SAE_ECU.VAL[3] = '6';
-                break;
-            case 7: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = 'C';
-                obd2_ret.SAE_ECU.VAL[1] = 'G';
-                obd2_ret.SAE_ECU.VAL[2] = 'W';
-                obd2_ret.SAE_ECU.VAL[3] = '1';
-                break;
-            default: // (A) ECU name character 
-                obd2_ret.SAE_ECU.VAL[0] = '?';
-                obd2_ret.SAE_ECU.VAL[1] = '?';
-                obd2_ret.SAE_ECU.VAL[2] = '?';
-                obd2_ret.SAE_ECU.VAL[3] = '?';
-                break;
-            }
-            break;
-        case 0x0B: // In-use performance tracking for compression ignition vehicles 
-            len += 4;
-            switch (obd2_ret_counter) {
-            case 0: // OBDCOND, IGNCNTR 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 1: // HCCATCOMP, HCCATCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 2: // NCATCOMP, NCATCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 3: // NADSCOMP, NADSCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 4: // PMCOMP, PMCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 5: // EGSCOMP, EGSCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 6: // EGRCOMP, EGRCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 7: // BPCOMP, BPCOND 
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            case 8: // FUELCOMP, FUELCOND 
-            default:
-                obd2_ret.SAE_ECU.VAL[0] = 0x00;
-                obd2_ret.SAE_ECU.VAL[1] = 0x00;
-                obd2_ret.SAE_ECU.VAL[2] = 0x00;
-                obd2_ret.SAE_ECU.VAL[3] = 0x00;
-                break;
-            }
-            obd2_ret_counter++;
-            if (obd2_ret_counter >= 9) {
-                obd2_ret_counter = 0;
-            }
-            break;
-        }
-    } else {
+    OBD2_PREP_STR * pp;
+
+    if (len != 2 || obd2_req.SAE_OBD.PID >= OBD2_MODE9_PIDS) { // Standard requirements 
         return 0;
     }
-    return len;
+    pp = &obd2_mode9_prep[obd2_req.SAE_OBD.PID];
+    if (pp->LEN == 0) { // Unsupported 
+        return 0;
+    }
+    can_tp_handoff(pp->BUF);
+    return pp->LEN;
 }
 
 /* ----------------------------------------------------------------------------------------
- * MODE10 Persistent DTC information
+ * MODE10 Persistent DTC information (permanent DTC)
  * ---------------------------------------------------------------------------------------- */
-int obd2_modeA(int len)
+int obd2_modeA(int len, unsigned char *res)
 {
-    if (len == 2) { // Standard requirements 
-        len = 1;
-        obd2_ret.MD3_ECU.MODE = obd2_req.SAE_OBD.MODE + 0x40;
-    } else {
+    if (len != 1) { // Standard requirements 
         return 0;
     }
-    return len;
+    return obd2_dtc_list(0, 1, res);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1273,19 +1043,19 @@ int obd2_modeA(int len)
 int obd2_job(unsigned char *msg, int len,
              unsigned char *res) 
 {
+    if (len > sizeof(obd2_req)) { // Request over 
+        return 0;
+    }
     memset(&obd2_ret, 0x00, sizeof(obd2_ret));
     memset(&obd2_req, 0x00, sizeof(obd2_req));
     memcpy(&obd2_req.BYTE[0], msg, len);
     switch (obd2_req.SAE_OBD.MODE) {
-    case SHOW_CURRENT_DATA: // Present value 
-        len = obd2_mode1(len);
-        break;
-    case SHOW_FREEZE_FDATA:    // Stop frame 
-        len = obd2_mode2(len);
-        break;
-    case SHOW_STORED_DTC:      // Get saved DTC 
-        len = obd2_mode3(len);
-        break;
+    case SHOW_CURRENT_DATA: // Present value (multi PID, direct to response buffer) 
+        return obd2_mode1(len, res);
+    case SHOW_FREEZE_FDATA:    // Stop frame (multi PID, direct to response buffer) 
+        return obd2_mode2(len, res);
+    case SHOW_STORED_DTC:      // Get saved DTC (direct to response buffer) 
+        return obd2_mode3(len, res);
     case CLEAR_STORED_DTC:     // Delete saved DTC 
         len = obd2_mode4(len);
         break;
@@ -1295,18 +1065,15 @@ int obd2_job(unsigned char *msg, int len,
     case TEST_RESULT_ONLY_CAN: // Other monitors, exhaust monitoring (CAN) 
         len = obd2_mode6(len);
         break;
-    case SHOW_PENDING_DTC:     // Last DTC information 
-        len = obd2_mode7(len);
-        break;
+    case SHOW_PENDING_DTC:     // Last DTC information (direct to response buffer) 
+        return obd2_mode7(len, res);
     case CTRL_OPERATION_SYS:   // Control system operation 
         len = obd2_mode8(len);
         break;
-    case REQUEST_VEHICLE_INFO: // Vehicle information 
-        len = obd2_mode9(len);
-        break;
-    case PERMANENT_DTC: // Permanent DTC information 
-        len = obd2_modeA(len);
-        break;
+    case REQUEST_VEHICLE_INFO: // Vehicle information (prepared response) 
+        return obd2_mode9(len);
+    case PERMANENT_DTC: // Permanent DTC information (direct to response buffer) 
+        return obd2_modeA(len, res);
     default: // Unsupported mode 
         len = 3;
         obd2_ret.NOT_ECU.X7F  = 0x7F;
@@ -171,6 +171,67 @@ typedef union __obd2_query_frame__ {
 #define REQUEST_VEHICLE_INFO 0x09 // Get vehicle information 
 #define PERMANENT_DTC        0x0A // Persistent DTC information 
 
+/* ----------------------------------------------------------------------------------------
+ * MODE1 PID definition
+ * ---------------------------------------------------------------------------------------- */
+typedef struct __obd2_pid_desc__ {
+    unsigned char   PID;  // Parameter ID 
+    unsigned char   LEN;  // Data length (1 to 4) 
+    unsigned char   TYPE; // Source type (OBD2_SRC_xxx) 
+    unsigned short  ID;   // Source CAN-ID (can_buf) 
+    unsigned char   POS;  // Source byte position 
+    unsigned short  MUL;  // Scaling multiplier 
+    unsigned short  DIV;  // Scaling divisor 
+    unsigned long   VAL;  // Fixed value 
+} OBD2_PID_DESC;
+
+#define OBD2_SRC_CONST  0 // Fixed value 
+#define OBD2_SRC_BYTE   1 // Unsigned byte 
+#define OBD2_SRC_WORD   2 // Unsigned word (big endian) 
+#define OBD2_SRC_SWORD  3 // Signed word (big endian, absolute value) 
+
+/* ----------------------------------------------------------------------------------------
+ * MODE2 freeze frame definition
+ * ---------------------------------------------------------------------------------------- */
+#define OBD2_FF_MAX     8           // Freeze frame ring size (RAM) 
+#define OBD2_FF_DATA    28          // Captured source bytes per frame 
+#define OBD2_FF_SAVE                // Save freeze frames to data flash (delete for RAM only) 
+#define OBD2_FF_BLOCK   BLOCK_DB3   // Data flash save block 
+#define OBD2_FF_ADDR    0x00101800  // Data flash save address (BLOCK_DB3) 
+#define OBD2_FF_SLOTS   (2048 / sizeof(OBD2_FREEZE_FRAME)) // Frames per block 
+
+typedef struct __obd2_freeze_frame__ {
+    unsigned short  CODE;               // DTC that caused the freeze frame 
+    unsigned short  SEQ;                // Capture sequence number 
+    unsigned char   DATA[OBD2_FF_DATA]; // can_buf source bytes of MODE1 PIDs 
+} OBD2_FREEZE_FRAME;
+
+#define OBD2_FFS_LOAD   0 // Restore from data flash (until obd2_init) 
+#define OBD2_FFS_IDLE   1 // Waiting for request 
+#define OBD2_FFS_ERASE  2 // Erasing the block 
+#define OBD2_FFS_WRITE  3 // Writing one frame 
+
+typedef struct __obd2_ff_save_str__ {
+    int                 STEP;   // Processing step 
+    int                 SLOT;   // Next free slot in the block 
+    int                 RP;     // Ring position to save 
+    int                 CNT;    // Number of unsaved frames 
+    int                 CLR;    // Erase request 
+    int                 ERR;    // Error count 
+    volatile unsigned char RES; // Erase / write result (FLASH_BUSY while running) 
+    OBD2_FREEZE_FRAME   BUF;    // Write buffer 
+} OBD2_FF_SAVE_STR;
+
+/* ----------------------------------------------------------------------------------------
+ * MODE9 prepared response definition
+ * ---------------------------------------------------------------------------------------- */
+#define OBD2_MODE9_PIDS 0x0B    // PID 00 to 0A 
+
+typedef struct __obd2_prep_str__ {
+    int             LEN;        // Response length (0=Unsupported) 
+    unsigned char   BUF[24];    // Response data [0x49][PID][Data...] 
+} OBD2_PREP_STR;
+
 /* ----------------------------------------------------------------------------------------
  * Diagnostic trouble code (DTC) definition
  * ---------------------------------------------------------------------------------------- */
@@ -195,6 +256,69 @@ typedef union __obd2_dtc_str__ {
 #define DTC_ECU_CODE_BDY 2 // Body diagnostic code 
 #define DTC_ECU_CODE_NET 3 // Network diagnostic code 
 
+/* ----------------------------------------------------------------------------------------
+ * DTC manager definition
+ *
+ *  DTC code : 24 bit [OBD2 DTC 2 byte][Failure type byte] (ISO 15031-6 format)
+ * ---------------------------------------------------------------------------------------- */
+#define DTC_MAX             32          // DTC table size 
+#define DTC_HASH            64          // DTC index size (power of 2) 
+#define DTC_GROUP_ALL       0xFFFFFF    // All DTC group 
+
+// Status of DTC (ISO 14229-1) 
+#define DTC_ST_TF           0x01        // testFailed 
+#define DTC_ST_TFTOC        0x02        // testFailedThisOperationCycle 
+#define DTC_ST_PDTC         0x04        // pendingDTC 
+#define DTC_ST_CDTC         0x08        // confirmedDTC 
+#define DTC_ST_TNCSLC       0x10        // testNotCompletedSinceLastClear 
+#define DTC_ST_TFSLC        0x20        // testFailedSinceLastClear 
+#define DTC_ST_TNCTOC       0x40        // testNotCompletedThisOperationCycle 
+#define DTC_ST_AVAIL        0x7F        // DTC status availability mask 
+
+// DTC codes detected by this firmware 
+#define DTC_CODE_FLASH_PROG 0x062F00    // P062F Internal control module memory write error (UDS download) 
+#define DTC_CODE_SEC_ACCESS 0xD10000    // U1100 Security access invalid key (manufacturer) 
+
+typedef struct __dtc_entry__ {
+    unsigned long   CODE;   // DTC (0=Empty) 
+    unsigned char   STAT;   // Status of DTC 
+    unsigned char   OCC;    // Occurrence counter 
+    unsigned char   PERM;   // Permanent DTC (not erased by clear) 
+    unsigned char   DIRTY;  // Waiting for log write 
+} DTC_ENTRY;
+
+#define DTC_LOG_BLOCK       BLOCK_DB4   // Log blocks BLOCK_DB4 / BLOCK_DB5 
+#define DTC_LOG_ADDR        0x00102000  // Log address (BLOCK_DB4) 
+#define DTC_LOG_SLOTS       (2048 / sizeof(DTC_LOG_REC)) // Records per block 
+#define DTC_LOG_RESERVE     (DTC_MAX + 1)   // Reserve for the compaction (all DTCs + clear) 
+#define DTC_REC_MARK        0xA0        // Record mark (FLAG upper 4 bits) 
+
+typedef struct __dtc_log_rec__ {
+    unsigned char   FLAG;       // DTC_REC_MARK | Permanent DTC (first, never 0xFF : blank check) 
+    unsigned char   CODE[3];    // DTC (DTC_GROUP_ALL=Clear record) 
+    unsigned char   STAT;       // Status of DTC 
+    unsigned char   OCC;        // Occurrence counter 
+    unsigned short  SEQ;        // Record sequence number 
+} DTC_LOG_REC;
+
+#define DTC_LS_LOAD         0   // Restore from data flash (until obd2_init) 
+#define DTC_LS_IDLE         1   // Waiting for request 
+#define DTC_LS_ERASE        2   // Erasing the other block 
+#define DTC_LS_WRITE        3   // Writing one record 
+
+typedef struct __dtc_log_str__ {
+    int             STEP;   // Processing step 
+    int             BLK;    // Write block (0/1) 
+    int             SLOT;   // Next free slot 
+    int             CPT;    // Compaction position (-1=None) 
+    int             CLR;    // Clear record request 
+    int             ERR;    // Error count 
+    int             LOST;   // DTCs lost by table full 
+    unsigned short  SEQ;    // Last sequence number 
+    volatile unsigned char RES; // Erase / write result (FLASH_BUSY while running) 
+    DTC_LOG_REC     BUF;    // Write buffer 
+} DTC_LOG_STR;
+
 /* ----------------------------------------------------------------------------------------
  * Variable definition
  * ---------------------------------------------------------------------------------------- */
@@ -202,18 +326,104 @@ extern OBD2_QUERY_FRAME obd2_req; // Request data
 extern OBD2_QUERY_FRAME obd2_ret; // Response data 
 
 extern int obd2_ret_counter;
+
+extern const OBD2_PID_DESC  obd2_pid_table[];       // MODE1 PID definition table 
+extern unsigned char        obd2_pid_index[256];    // PID -> table index (0xFF=Unsupported) 
+extern unsigned char        obd2_pid_support[8][4]; // Supported PID bitmap [01-20]...[E1-FF] 
+extern unsigned char        obd2_ff_ofs[];          // Source position in the freeze frame 
+
+extern OBD2_FREEZE_FRAME    obd2_ff[OBD2_FF_MAX];   // Freeze frame ring 
+extern int                  obd2_ff_wp;             // Ring write position 
+extern int                  obd2_ff_num;            // Number of stored frames 
+extern unsigned short       obd2_ff_seq;            // Capture sequence number 
+extern OBD2_FF_SAVE_STR     obd2_ffs;               // Data flash save control 
+extern OBD2_PREP_STR        obd2_mode9_prep[OBD2_MODE9_PIDS]; // Prepared MODE9 responses 
+
+extern DTC_ENTRY            dtc_tbl[DTC_MAX];       // DTC table 
+extern unsigned char        dtc_index[DTC_HASH];    // Code -> table number + 1 
+extern DTC_LOG_STR          dtc_log;                // Log control 
+/* ----------------------------------------------------------------------------------------
+ * OBD2 initialization
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_init(void);
+/* ----------------------------------------------------------------------------------------
+ * PID source data size
+ * ---------------------------------------------------------------------------------------- */
+extern int obd2_src_size(int type);
 /* ----------------------------------------------------------------------------------------
- * MODE1 processing  0x0C, 0x0D, 0x1C, 0x2F, 0x31, 0x49, 0x51
+ * PID value generation from source data
  * ---------------------------------------------------------------------------------------- */
-extern int obd2_mode1(int len);
+extern int obd2_pid_value(const OBD2_PID_DESC *pd, unsigned char *sp, unsigned char *dp);
 /* ----------------------------------------------------------------------------------------
- * MODE2 processing (DTC record reply request)
+ * Supported PID bitmap response
  * ---------------------------------------------------------------------------------------- */
-extern int obd2_mode2(int len);
+extern int obd2_pid_support_get(int pid, unsigned char *dp);
+/* ----------------------------------------------------------------------------------------
+ * MODE1 single PID value generation
+ * ---------------------------------------------------------------------------------------- */
+extern int obd2_mode1_pid(int pid, unsigned char *dp);
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame capture (call when a DTC is set)
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_ff_capture(unsigned short dtc);
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame reference (0=Latest)
+ * ---------------------------------------------------------------------------------------- */
+extern OBD2_FREEZE_FRAME * obd2_ff_get(int frame);
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame clear
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_ff_clear(void);
+#ifdef OBD2_FF_SAVE
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame restore from data flash (obd2_init)
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_ff_load(void);
+/* ----------------------------------------------------------------------------------------
+ * Freeze frame data flash save processing (call from main loop)
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_ff_job(void);
+#endif
+/* ----------------------------------------------------------------------------------------
+ * DTC lookup (add=1 : Register when not found)
+ * ---------------------------------------------------------------------------------------- */
+extern DTC_ENTRY * dtc_entry(unsigned long code, int add);
+/* ----------------------------------------------------------------------------------------
+ * DTC test result report (failed=1 : Fault detected / 0 : Test passed)
+ * ---------------------------------------------------------------------------------------- */
+extern void dtc_report(unsigned long code, int failed);
+/* ----------------------------------------------------------------------------------------
+ * DTC clear (DTC_GROUP_ALL=All DTCs)
+ * ---------------------------------------------------------------------------------------- */
+extern int dtc_clear(unsigned long code);
+/* ----------------------------------------------------------------------------------------
+ * DTC log restore (obd2_init)
+ * ---------------------------------------------------------------------------------------- */
+extern void dtc_load(void);
+/* ----------------------------------------------------------------------------------------
+ * DTC log processing (call from main loop)
+ * ---------------------------------------------------------------------------------------- */
+extern void dtc_job(void);
+/* ----------------------------------------------------------------------------------------
+ * DTC snapshot record (-1=No freeze frame)
+ * ---------------------------------------------------------------------------------------- */
+extern int dtc_snapshot(unsigned long code, unsigned char *res);
+/* ----------------------------------------------------------------------------------------
+ * OBD2 DTC list response
+ * ---------------------------------------------------------------------------------------- */
+extern int obd2_dtc_list(int mask, int perm, unsigned char *res);
+/* ----------------------------------------------------------------------------------------
+ * MODE1 processing  0x01, 0x05, 0x0C, 0x0D, 0x11, 0x1C, 0x2F, 0x31, 0x49, 0x51
+ * ---------------------------------------------------------------------------------------- */
+extern int obd2_mode1(int len, unsigned char *res);
+/* ----------------------------------------------------------------------------------------
+ * MODE2 processing (Freeze frame)
+ * ---------------------------------------------------------------------------------------- */
+extern int obd2_mode2(int len, unsigned char *res);
 /* ----------------------------------------------------------------------------------------
  * MODE3 processing (Reply saved DTC record)
  * ---------------------------------------------------------------------------------------- */
-extern int obd2_mode3(int len);
+extern int obd2_mode3(int len, unsigned char *res);
 /* ----------------------------------------------------------------------------------------
  * MODE4 processing (Delete DTC record)
  * ---------------------------------------------------------------------------------------- */
@@ -229,11 +439,15 @@ extern int obd2_mode6(int len);
 /* ----------------------------------------------------------------------------------------
  * MODE7 Obtain unknown diagnostic trouble code information
  * ---------------------------------------------------------------------------------------- */
-extern int obd2_mode7(int len);
+extern int obd2_mode7(int len, unsigned char *res);
 /* ----------------------------------------------------------------------------------------
  * MODE8 On-board system support
  * ---------------------------------------------------------------------------------------- */
 extern int obd2_mode8(int len);
+/* ----------------------------------------------------------------------------------------
+ * MODE9 prepared response generation
+ * ---------------------------------------------------------------------------------------- */
+extern void obd2_mode9_prepare(void);
 /* ----------------------------------------------------------------------------------------
  * MODE9 processing
  * ---------------------------------------------------------------------------------------- */
@@ -241,7 +455,7 @@ extern int obd2_mode9(int len);
 /* ----------------------------------------------------------------------------------------
  * MODE10 Persistent DTC information
  * ---------------------------------------------------------------------------------------- */
-extern int obd2_modeA(int len);
+extern int obd2_modeA(int len, unsigned char *res);
 /* ----------------------------------------------------------------------------------------
  * OBD2 processing
  * ---------------------------------------------------------------------------------------- */
@@ -155,6 +155,13 @@ static uint32_t g_bgo_flash_addr;
 static uint32_t g_bgo_buffer_addr;
 #endif // if defined(DATA_FLASH_BGO) || defined(ROM_BGO)
 
+#if defined(MCU_RX630) || defined(MCU_RX631) || defined(MCU_RX63N)
+// ROM block of the suspended erase (R_FlashEraseSlice, -1=None) 
+static int16_t g_slice_block = -1;
+// Erase time left of the suspended erase (ICLK ticks) 
+static int32_t g_slice_wait;
+#endif
+
 // Flash intialisation function prototype 
 static uint8_t flash_init(void);
 // Enter PE mode function prototype 
@@ -216,8 +223,8 @@ static uint8_t flash_init(void)
 #if defined(DATA_FLASH_BGO) || defined(ROM_BGO)
     /* Enable flash ready interrupt (FRDYI)
      * Make sure IPL is high enough that interrupt will trigger*/
-    IPR(FCU, FRDYI) = FLASH_READY_IPL;
-    IEN(FCU, FRDYI) = 1;
+    ICU.IPR[IPR_FCU_FRDYI].BIT.IPR              = FLASH_READY_IPL;
+    ICU.IER[IER_FCU_FRDYI].BIT.IEN_FCU_FRDYI    = 1;
 #else
     // Disable flash ready interrupt (FRDYI) 
     ICU.IPR[IPR_FCU_FRDYI].BIT.IPR              = 0;
@@ -861,8 +868,8 @@ uint8_t R_FlashSetLockBitProtection(uint8_t lock_bit)
  *  Return
  *       None
  * ---------------------------------------------------------------------------------------- */
-#pragma interrupt flash_ready_isr(vect=VECT(FCU, FRDYI))
-void flash_ready_isr(void)
+//#pragma interrupt flash_ready_isr(vect=VECT(FCU, FRDYI)) 
+void interrupt __vectno__ {VECT_FCU_FRDYI} flash_ready_isr(void)
 {
     // Local variables 
     uint32_t    num_byte_to_write;
@@ -1732,6 +1739,146 @@ uint8_t R_FlashEraseRange(uint32_t start_addr, uint32_t bytes)
     // Return erase result 
     return result;
 }
+
+/* ----------------------------------------------------------------------------------------
+ * R_FlashEraseSlice
+ * 
+ *  Description
+ *      Erases a ROM block in bounded steps with the FCU P/E suspend command.
+ *      The first call starts the erase, the next calls with the same block resume
+ *      it. Each call lets the FCU erase for at most 'usec', then suspends it and
+ *      returns to ROM read mode, so interrupts can be served between the calls.
+ *      Erasure priority mode is used, so every step makes progress.
+ *      The API stays in the erasing state until the block is finished, other
+ *      operations get FLASH_BUSY (do not wait for the API before the block ends).
+ *      NOTE: ROM can not be read during the step, interrupts must be disabled
+ *            by the caller around each call.
+ * 
+ *  Arguments
+ *      block  The ROM block number to erase (BLOCK_0, BLOCK_1, etc...)
+ *      usec   Longest erase time of this step (1us unit)
+ *  
+ *  Return
+ *       FLASH_BUSY          Erase suspended, call again with the same block
+ *       FLASH_SUCCESS       Block erased
+ *       FLASH_FAILURE       Operation Failed, or another operation is in progress
+ *       FLASH_ERROR_ADDRESS Not a ROM block
+ * ---------------------------------------------------------------------------------------- */
+uint8_t R_FlashEraseSlice(uint8_t block, uint32_t usec)
+{
+    // Declare address pointer 
+    FCU_BYTE_PTR pAddr;
+    // Declare wait counter variable 
+    int32_t wait_cnt;
+    // Declare erase operation result container variable 
+    uint8_t result = FLASH_SUCCESS;
+    // Declare first step flag 
+    uint8_t start = 0;
+
+    // Only ROM blocks can be suspended 
+    if (block >= BLOCK_DB0) {
+        return FLASH_ERROR_ADDRESS;
+    }
+
+    // Erase Command Address 
+    pAddr = (FCU_BYTE_PTR)g_flash_BlockAddresses[ block ];
+
+    // Start a new erase (the API stays grabbed while the erase is suspended) 
+    if (g_slice_block != block) {
+        if (g_slice_block >= 0 || flash_grab_state(FLASH_ERASING) != FLASH_SUCCESS) {
+            // Another operation is in progress 
+            return FLASH_FAILURE;
+        }
+        g_slice_block   = block;
+        g_slice_wait    = WAIT_MAX_ERASE;
+        start           = 1;
+    }
+
+    // Set current FCU mode to ROM PE 
+    g_current_mode = ROM_PE_MODE;
+
+    // Enter ROM PE mode, check if operation successful 
+    if (enter_pe_mode(g_flash_BlockAddresses[ block ]) != FLASH_SUCCESS) {
+        result = FLASH_FAILURE;
+    } else {
+#ifdef  IGNORE_LOCK_BITS
+        // Cancel the ROM Protect feature 
+        FLASH.FPROTR.WORD = 0x5501;
+#else
+        /* Only disable lock bit protection if user has specified to
+         * do so earlier */
+        if (g_lock_bit_protection == false) {
+            // Cancel the ROM Protect feature 
+            FLASH.FPROTR.WORD = 0x5501;
+        }
+#endif // ifdef  IGNORE_LOCK_BITS
+
+        if (start) {
+            // Erasure priority mode, the erase goes on until suspend is accepted 
+            FLASH.FCPSR.WORD = 0x0001;
+
+            // Send the FCU erase command 
+            *pAddr = 0x20;
+            *pAddr = 0xD0;
+        } else {
+            // Send the FCU P/E resume command 
+            *pAddr = 0xD0;
+        }
+
+        // Erase for at most 'usec' 
+        wait_cnt = WAIT_ERASE_SLICE(usec);
+        while (FLASH.FSTATR0.BIT.FRDY == 0 && wait_cnt > 0) {
+            wait_cnt--;
+        }
+        g_slice_wait -= WAIT_ERASE_SLICE(usec) - wait_cnt;
+
+        if (FLASH.FSTATR0.BIT.FRDY == 0) {
+            // Suspend, the FCU accepts the command when SUSRDY is set 
+            wait_cnt = WAIT_MAX_ERASE_SUSPEND;
+            while (FLASH.FSTATR0.BIT.FRDY == 0 && FLASH.FSTATR0.BIT.SUSRDY == 0 && wait_cnt > 0) {
+                wait_cnt--;
+            }
+            if (FLASH.FSTATR0.BIT.FRDY == 0) {
+                // Send the FCU P/E suspend command 
+                *pAddr = 0xB0;
+            }
+            wait_cnt = WAIT_MAX_ERASE_SUSPEND;
+            while (FLASH.FSTATR0.BIT.FRDY == 0 && wait_cnt > 0) {
+                wait_cnt--;
+            }
+            if (FLASH.FSTATR0.BIT.FRDY == 0 || g_slice_wait <= 0) {
+                /* Suspend not accepted or the erase exceeds the maximum erasure time -
+                 * assume operation failure and reset the FCU */
+                flash_reset();
+                result = FLASH_FAILURE;
+            } else if (FLASH.FSTATR0.BIT.ERSSPD == 1) {
+                // Suspended, back to ROM read mode 
+                exit_pe_mode();
+
+                // Return, call again to resume 
+                return FLASH_BUSY;
+            }
+        }
+
+        // Erase finished, check FCU error 
+        if (
+            (FLASH.FSTATR0.BIT.ILGLERR == 1)
+            ||  (FLASH.FSTATR0.BIT.ERSERR  == 1)
+        ) {
+            result = FLASH_FAILURE;
+        }
+    }
+
+    // Leave Program/Erase Mode 
+    exit_pe_mode();
+
+    // Release state 
+    g_slice_block = -1;
+    flash_release_state();
+
+    // Return erase result 
+    return result;
+}
 #endif // defined(MCU_RX630) || defined(MCU_RX631) || defined(MCU_RX63N)
 
 /* ----------------------------------------------------------------------------------------
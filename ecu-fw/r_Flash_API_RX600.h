@@ -130,6 +130,7 @@
 uint8_t R_FlashErase(uint8_t block );
 #if defined(MCU_RX630) || defined(MCU_RX631) || defined(MCU_RX63N)
 uint8_t R_FlashEraseRange(uint32_t start_addr, uint32_t bytes);
+uint8_t R_FlashEraseSlice(uint8_t block, uint32_t usec);
 #endif
 uint8_t R_FlashWrite(uint32_t flash_addr, uint32_t buffer_addr, uint16_t bytes);
 uint8_t R_FlashProgramLockBit(uint8_t block);
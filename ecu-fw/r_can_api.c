@@ -77,6 +77,7 @@
 #include    "ecu.h"         // ECU common definition 
 #include    "timer.h"
 #include    "cantp.h"       // CAN-TP definition 
+#include    "trace.h"       // Event trace 
 
 
 void logging(char *fmt, ...);
@@ -1585,7 +1586,7 @@ void interrupt __vectno__ {VECT_CAN0_RXM0} CAN0_RXM0_ISR(void)
  * ---------------------------------------------------------------------------------------- */
 void interrupt __vectno__ {VECT_CAN0_RXF0} CAN0_RXF0_ISR(void)
 {
-    logging("CAN0_RXF0_ISR\r");
+    TRACE(TRC_CAN_FIFO, 0, 0);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1602,7 +1603,7 @@ void interrupt __vectno__ {VECT_CAN0_RXF0} CAN0_RXF0_ISR(void)
  * ---------------------------------------------------------------------------------------- */
 void interrupt __vectno__ {VECT_CAN0_TXF0} CAN0_TXF0_ISR(void)
 {
-    logging("CAN0_TXF0_ISR\r");
+    TRACE(TRC_CAN_FIFO, 0, 1);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1701,7 +1702,7 @@ void interrupt __vectno__ {VECT_CAN1_RXM1} CAN1_RXM1_ISR(void)
  * ---------------------------------------------------------------------------------------- */
 void interrupt __vectno__ {VECT_CAN1_RXF1} CAN1_RXF1_ISR(void)
 {
-    logging("CAN1_RXF1_ISR\r");
+    TRACE(TRC_CAN_FIFO, 1, 0);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1718,7 +1719,7 @@ void interrupt __vectno__ {VECT_CAN1_RXF1} CAN1_RXF1_ISR(void)
  * ---------------------------------------------------------------------------------------- */
 void interrupt __vectno__ {VECT_CAN1_TXF1} CAN1_TXF1_ISR(void)
 {
-    logging("CAN1_TXF1_ISR\r");
+    TRACE(TRC_CAN_FIFO, 1, 1);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1819,7 +1820,7 @@ void interrupt __vectno__ {VECT_CAN2_RXM2} CAN2_RXM2_ISR(void)
  * ---------------------------------------------------------------------------------------- */
 void interrupt __vectno__ {VECT_CAN2_RXF2} CAN2_RXF2_ISR(void)
 {
-    logging("CAN2_RXF2_ISR\r");
+    TRACE(TRC_CAN_FIFO, 2, 0);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1837,7 +1838,7 @@ void interrupt __vectno__ {VECT_CAN2_RXF2} CAN2_RXF2_ISR(void)
 //#pragma interrupt    CAN2_TXF2_ISR(vect=VECT_CAN2_TXF2, enable) 
 void interrupt __vectno__ {VECT_CAN2_TXF2} CAN2_TXF2_ISR(void)
 {
-    logging("CAN2_TXF2_ISR\r");
+    TRACE(TRC_CAN_FIFO, 2, 1);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1874,7 +1875,7 @@ void interrupt __vectno__ {VECT_ICU_GROUPE0} CANX_ERS_ISR(void)
                 }
             }
             if (CAN0.STR.BIT.BOST) {
-                logging("CAN0 BOST\r");
+                TRACE(TRC_CAN_BOST, 0, 0);
                 if (CAN0.CTLR.BIT.BOM = 0) { // Normal mode 
                     CAN0.CTLR.BIT.RBOC = 1; // Bus off forced return 
                 }
@@ -1895,7 +1896,7 @@ void interrupt __vectno__ {VECT_ICU_GROUPE0} CANX_ERS_ISR(void)
                 }
             }
             if (CAN1.STR.BIT.BOST) {
-                logging("CAN1 BOST\r");
+                TRACE(TRC_CAN_BOST, 1, 0);
                 if (CAN1.CTLR.BIT.BOM = 0) { // Normal mode 
                     CAN1.CTLR.BIT.RBOC = 1;  // Bus off forced return 
                 }
@@ -1916,7 +1917,7 @@ void interrupt __vectno__ {VECT_ICU_GROUPE0} CANX_ERS_ISR(void)
                 }
             }
             if (CAN2.STR.BIT.BOST) {
-                logging("CAN2 BOST\r");
+                TRACE(TRC_CAN_BOST, 2, 0);
                 if (CAN2.CTLR.BIT.BOM = 0) { // Normal mode 
                     CAN2.CTLR.BIT.RBOC = 1; // Bus off forced return 
                 }
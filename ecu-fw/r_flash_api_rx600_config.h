@@ -108,7 +108,7 @@
 /* If this is defined then the flash ready interrupt will be used and
  * FlashAPI routines that deal with the data flash will exit after the
  * operation has been started instead of polling for it to finish. */
-//#define DATA_FLASH_BGO 
+#define DATA_FLASH_BGO
 
 /******************************************************************************
 *  ENABLE BGO & NON-BLOCKING ROM OPERATIONS
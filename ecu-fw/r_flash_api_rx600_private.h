@@ -383,6 +383,16 @@
 #define WAIT_MAX_ERASE \
     ((int32_t)(1152000 * (50.0/(FLASH_CLOCK_HZ/1000000)))*(ICLK_HZ/1000000))
 
+/*  Number of ICLK ticks for one step of R_FlashEraseSlice. The wait loop
+ *  takes more than one tick per pass, so the step is never longer. */
+#define WAIT_ERASE_SLICE(usec) \
+    ((int32_t)(usec)*(ICLK_HZ/1000000))
+
+/*  Timeout for the FCU to accept and finish the P/E suspend command (0.5ms,
+ *  above the suspend delay of the HW Manual in erasure priority mode). */
+#define WAIT_MAX_ERASE_SUSPEND \
+    ((int32_t)500*(ICLK_HZ/1000000))
+
 #else // if defined(MCU_RX610)
 #error "!!! Need to define memory specifics for this RX600 family \
     in r_flash_api_rx600_private.h !!!"
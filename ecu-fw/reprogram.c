@@ -48,6 +48,10 @@
 #include "flash_rom.h"
 #include "ecu.h"            // ECU common definition 
 #include "can3_spi2.h"      // CAN3 definition 
+#include "cantp.h"          // CAN-TP definition 
+#include "uds.h"            // CAN-UDS definition 
+
+void logging(char *fmt, ...);
 
 /*
  *  Reprogram processing overview
@@ -132,6 +136,8 @@ REPRO_QUERY_FRAME   repro_req;      // Variable definition
 REPRO_QUERY_FRAME   repro_ret;      // Response data 
 unsigned char       fw_image[128];  // Write-only memory buffer 
 unsigned long       fw_address;     // Write-only memory address 
+ECU_JNL_STR         ecu_jnl;        // Configuration journal 
+ECU_CFG_STR         ecu_cfg = {-1}; // Configuration slots 
 
 /* ----------------------------------------------------------------------------------------
  * boot_copy
@@ -194,105 +200,633 @@ int bootclear(void)
 }
 
 /* ----------------------------------------------------------------------------------------
- * Batch storage of ECU operation data
+ * RAM address of an image offset
  * ---------------------------------------------------------------------------------------- */
-int ecu_data_write(void)
+unsigned char * ecu_image_ptr(int ofs)
 {
-    int bk, i;
-    int wp  = 0;
-    int fe  = 0;
-
-    // Execute area erase 
-    for (i = 0, bk = BLOCK_DB0; bk <= BLOCK_DB2; bk++, i++) {
-        if (R_FlashDataAreaBlankCheck(
-                                    g_flash_BlockAddresses[bk], 
-                                    BLANK_CHECK_ENTIRE_BLOCK
-        ) == FLASH_NOT_BLANK) { // With writing 
-            while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                ;
+    switch (ofs / ECU_IMAGE_BLOCK) {
+    case 0: // Routing map 
+        return (unsigned char *)&rout_map + ofs;
+    case 1: // Cycle / event list 
+        return (unsigned char *)&conf_ecu.LIST[0] + (ofs - ECU_IMAGE_BLOCK);
+    default: // I/O checklist 
+        return (unsigned char *)&ext_list[0] + (ofs - 2 * ECU_IMAGE_BLOCK);
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Journal record address
+ * ---------------------------------------------------------------------------------------- */
+unsigned long ecu_jnl_addr(int blk, int slot)
+{
+    return ADDRESS_OF_JOURNAL + (unsigned long)blk * 2048 + (unsigned long)slot * sizeof(ECU_JNL_REC);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Journal record check sum
+ * ---------------------------------------------------------------------------------------- */
+unsigned short ecu_jnl_sum(const ECU_JNL_REC *rp)
+{
+    int             i;
+    unsigned short  sum = (unsigned short)(rp->FLAG + rp->GEN + rp->CHUNK + rp->SEQ);
+
+    for (i = 0; i < ECU_JNL_UNIT; i++) {
+        sum = (unsigned short)((sum << 1) | (sum >> 15)) + rp->DATA[i];
+    }
+    return sum;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Saved contents of a chunk (data flash address)
+ * ---------------------------------------------------------------------------------------- */
+const unsigned char * ecu_jnl_saved(int chunk)
+{
+    int k = ecu_jnl.IDX[chunk];
+
+    if (k == 0) { // Image block 
+        return (const unsigned char *)(ecu_cfg_addr(ecu_cfg.ACT) + (unsigned long)chunk * ECU_JNL_UNIT);
+    }
+    k--;
+    return ((const ECU_JNL_REC *)ecu_jnl_addr(k / ECU_JNL_SLOTS, k % ECU_JNL_SLOTS))->DATA;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Journal record build in the write buffer (dp=NULL : commit record)
+ * ---------------------------------------------------------------------------------------- */
+void ecu_jnl_record(int chunk, const unsigned char *dp)
+{
+    unsigned char   tmp[ECU_JNL_UNIT];
+
+    if (dp != 0) { // Source may be the data flash or RAM being edited 
+        memcpy(tmp, dp, ECU_JNL_UNIT);
+    }
+    memset(&ecu_jnl.BUF, 0, sizeof(ECU_JNL_REC));
+    ecu_jnl.BUF.FLAG = (dp != 0) ? ECU_JNL_MARK : ECU_JNL_COMMIT;
+    ecu_jnl.BUF.GEN  = (unsigned char)ecu_cfg.GEN;
+    ecu_jnl.BUF.SEQ  = ++ecu_jnl.SEQ;
+    if (dp != 0) {
+        ecu_jnl.BUF.CHUNK = (unsigned short)chunk;
+        memcpy(ecu_jnl.BUF.DATA, tmp, ECU_JNL_UNIT);
+    }
+    ecu_jnl.BUF.SUM = ecu_jnl_sum(&ecu_jnl.BUF);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Journal index rebuild from one block (apply=1 : copy the records to RAM)
+ *  Records of another slot generation are skipped.
+ * ---------------------------------------------------------------------------------------- */
+void ecu_jnl_index(int blk, int cnt, int apply)
+{
+    int                 i;
+    const ECU_JNL_REC * rp;
+
+    memset(ecu_jnl.IDX, 0, sizeof(ecu_jnl.IDX));
+    for (i = 0; i < cnt; i++) {
+        rp = (const ECU_JNL_REC *)ecu_jnl_addr(blk, i);
+        if (rp->SUM != ecu_jnl_sum(rp)) { // Broken record 
+            continue;
+        }
+        ecu_jnl.SEQ = rp->SEQ;
+        if (rp->FLAG == ECU_JNL_MARK && rp->GEN == (unsigned char)ecu_cfg.GEN && rp->CHUNK < ECU_JNL_CHUNKS) {
+            if (apply) {
+                memcpy(ecu_image_ptr(rp->CHUNK * ECU_JNL_UNIT), rp->DATA, ECU_JNL_UNIT);
             }
-            if (R_FlashErase(bk) == FLASH_SUCCESS) {
-                while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                    ;
-                }
-                if (R_FlashDataAreaBlankCheck(
-                                            g_flash_BlockAddresses[bk],
-                                            BLANK_CHECK_ENTIRE_BLOCK
-                ) == FLASH_BLANK) { // Erase completed 
-                    fe |= (1 << i);
-                }
+            ecu_jnl.IDX[rp->CHUNK] = (unsigned short)(blk * ECU_JNL_SLOTS + i + 1);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration journal variable initialization
+ * ---------------------------------------------------------------------------------------- */
+void ecu_jnl_init(void)
+{
+    memset(&ecu_jnl, 0, sizeof(ecu_jnl));
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration journal replay (call after reading the image blocks)
+ *
+ *  Both blocks are in use only when a compaction was interrupted. The newer block is
+ *  kept if its commit record was written, otherwise the older block is kept.
+ *  The other block is erased and waited for here. This synchronous erase is left on
+ *  purpose : it happens at boot after a power loss during a compaction, before CAN
+ *  forwarding starts. A completed compaction leaves one block in use, so a reload
+ *  from uds_cfg_abort only gets here after a failed erase of the old block.
+ * ---------------------------------------------------------------------------------------- */
+void ecu_jnl_load(void)
+{
+    int                 b, lo, hi, mid, nw;
+    int                 cnt[2];
+    int                 done = 0;
+    unsigned short      seq[2];
+    const ECU_JNL_REC * rp;
+
+    ecu_jnl_init();
+    for (b = 0; b < 2; b++) { // First blank slot (binary search) 
+        for (lo = 0, hi = ECU_JNL_SLOTS; lo < hi; ) {
+            mid = (lo + hi) / 2;
+            if (BlankCheckWord_FlashData(ecu_jnl_addr(b, mid)) == FLASH_BLANK) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
             }
-        } else {
-            fe |= (1 << i);
         }
+        cnt[b] = lo;
+        seq[b] = (lo > 0) ? ((const ECU_JNL_REC *)ecu_jnl_addr(b, 0))->SEQ : 0;
+    }
+    if (cnt[1] == 0) { // Block in use 
+        nw = 0;
+    } else if (cnt[0] == 0) {
+        nw = 1;
+    } else { // Interrupted compaction 
+        nw = ((short)(seq[1] - seq[0]) > 0) ? 1 : 0;
+        for (mid = 0; mid < cnt[nw]; mid++) {
+            rp = (const ECU_JNL_REC *)ecu_jnl_addr(nw, mid);
+            if (rp->FLAG == ECU_JNL_COMMIT && rp->SUM == ecu_jnl_sum(rp)) {
+                done = 1;
+            }
+        }
+        if (done == 0) { // Copy not completed : keep the older block 
+            nw ^= 1;
+        }
+        Wait_FlashData();
+        R_FlashErase(ECU_JNL_BLOCK + (nw ^ 1));
+        Wait_FlashData();
     }
+    ecu_jnl_index(nw, cnt[nw], 1);
+    ecu_jnl.BLK  = nw;
+    ecu_jnl.SLOT = cnt[nw];
+}
 
-    // MAP writing 
-    if ((fe & 1) != 0) { // Erase confirmed 
-        if (R_FlashWrite(
-                        ADDRESS_OF_ROOTMAP,
-                        (int)&rout_map,
-                        sizeof(ECU_ROUT_MAP)
-        ) == FLASH_SUCCESS) { // Writing completed 
-            wp |= 1;
+/* ----------------------------------------------------------------------------------------
+ * Configuration slot image address
+ * ---------------------------------------------------------------------------------------- */
+unsigned long ecu_cfg_addr(int slot)
+{
+    return (slot != 0) ? ADDRESS_OF_SLOT1 : ADDRESS_OF_ROOTMAP;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration slot header check (1=Valid : generation in *gen)
+ * ---------------------------------------------------------------------------------------- */
+int ecu_cfg_valid(int slot, unsigned long *gen)
+{
+    const ECU_CFG_HDR * hp = (const ECU_CFG_HDR *)(ADDRESS_OF_SLOTHDR + (unsigned long)slot * 2048);
+    unsigned long       sum;
+
+    if (BlankCheckWord_FlashData((uint32_t)hp) == FLASH_BLANK) { // No header 
+        return 0;
+    }
+    if (hp->MAGIC != ECU_CFG_MAGIC || hp->CHK != ~(hp->MAGIC ^ hp->GEN ^ hp->SUM)) { // Broken header 
+        return 0;
+    }
+    sum = uds_crc32(0xFFFFFFFFul, (const unsigned char *)ecu_cfg_addr(slot), 3 * ECU_IMAGE_BLOCK) ^ 0xFFFFFFFFul;
+    if (sum != hp->SUM) { // Image not completed 
+        return 0;
+    }
+    *gen = hp->GEN;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration slot selection (newest valid slot, -1=No saved image)
+ * ---------------------------------------------------------------------------------------- */
+int ecu_cfg_select(void)
+{
+    int             s;
+    unsigned long   gen;
+
+    ecu_cfg.ACT = -1;
+    ecu_cfg.GEN = 0;
+    for (s = 0; s < ECU_CFG_SLOTS; s++) {
+        if (ecu_cfg_valid(s, &gen) && (ecu_cfg.ACT < 0 || (long)(gen - ecu_cfg.GEN) > 0)) {
+            ecu_cfg.ACT = s;
+            ecu_cfg.GEN = gen;
         }
     }
-    // CONF writing 
-    if ((fe & 2) != 0) { // Erase confirmed 
-        if (R_FlashWrite(
-                        ADDRESS_OF_CYCEVE,
-                        (int)&conf_ecu.LIST[0],
-                        (sizeof(ECU_CYC_EVE) * MESSAGE_MAX)
-        ) == FLASH_SUCCESS) { // Writing completed 
-            wp |= 2;
+    if (ecu_cfg.ACT < 0
+     && BlankCheckWord_FlashData(ADDRESS_OF_SLOTHDR) == FLASH_BLANK
+     && BlankCheckWord_FlashData(ADDRESS_OF_SLOTHDR + 2048) == FLASH_BLANK
+     && BlankCheck_FlashData(ADDRESS_OF_ROOTMAP) == FLASH_NOT_BLANK) { // Saved by an older firmware 
+        ecu_cfg.ACT = 0;
+    }
+    return ecu_cfg.ACT;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Chunk to be saved (1=RAM differs from the saved contents)
+ * ---------------------------------------------------------------------------------------- */
+int ecu_jnl_changed(int chunk, int msk)
+{
+    if ((msk & (1 << (chunk * ECU_JNL_UNIT / ECU_IMAGE_BLOCK))) == 0) { // Not applicable 
+        return 0;
+    }
+    return (memcmp(ecu_image_ptr(chunk * ECU_JNL_UNIT), ecu_jnl_saved(chunk), ECU_JNL_UNIT) != 0) ? 1 : 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job queue
+ *
+ *  Saves and erases of the ECU operation data are queued by ecu_data_save / ecu_data_erase
+ *  and processed by ecu_flash_job from the main loop, one erase or program operation
+ *  at a time in BGO mode. The FCU ready interrupt stores the result of each operation
+ *  in ecu_fjob.BGO, so CAN forwarding, CAN-TP and the console keep running.
+ *  The result of the last job is read by DID 0xF501 and printed on the console.
+ * ---------------------------------------------------------------------------------------- */
+ECU_FJ_STR  ecu_fjob;   // Data flash job queue 
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job operation start (blk>=0 : Erase / blk<0 : Program) Return 0=OK / -1=Error
+ * ---------------------------------------------------------------------------------------- */
+int ecu_flash_start(int blk, unsigned long adr, void *src, int size)
+{
+    uint8_t f;
+
+    if (blk >= 0) {
+        f = EraseBgo_FlashData((uint8_t)blk, &ecu_fjob.BGO);
+    } else {
+        f = WriteBgo_FlashData(adr, (uint32_t)src, (uint16_t)size, &ecu_fjob.BGO);
+    }
+#ifdef DATA_FLASH_BGO
+    if (f != FLASH_SUCCESS) { // Not started 
+        return -1;
+    }
+#endif
+    ecu_fjob.STAT = ECU_FS_WAIT;
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job request (ECU_FJ_SAVE : arg=ECU_DATA_xxx) Return 0=Queued / -1=Queue full
+ * ---------------------------------------------------------------------------------------- */
+int ecu_flash_request(int cmd, int arg)
+{
+    ECU_FJOB *  jp;
+
+    if (cmd == ECU_FJ_SAVE && ecu_fjob.CNT > 0) { // Merge into the waiting save 
+        jp = &ecu_fjob.Q[(ecu_fjob.WP + ECU_FJ_QUEUE - 1) % ECU_FJ_QUEUE];
+        if (jp->CMD == ECU_FJ_SAVE) {
+            jp->ARG |= arg;
+            return 0;
         }
     }
-    // I/O writing 
-    if ((fe & 4) != 0) { // Erase confirmed 
-        if (R_FlashWrite(
-                        ADDRESS_OF_IOLIST,
-                        (int)&ext_list[0],
-                        sizeof(ext_list)
-        ) == FLASH_SUCCESS) { // Writing completed 
-            wp |= 4;
+    if (ecu_fjob.CNT >= ECU_FJ_QUEUE) { // Queue full 
+        return -1;
+    }
+    jp          = &ecu_fjob.Q[ecu_fjob.WP];
+    jp->CMD     = cmd;
+    jp->ARG     = arg;
+    ecu_fjob.WP = (ecu_fjob.WP + 1) % ECU_FJ_QUEUE;
+    ecu_fjob.CNT++;
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job completion
+ * ---------------------------------------------------------------------------------------- */
+void ecu_flash_finish(void)
+{
+    ecu_fjob.LAST = ecu_fjob.CUR;
+    ecu_fjob.LRES = ecu_fjob.RES;
+    ecu_fjob.SEQ++;
+    ecu_fjob.STAT = ECU_FS_IDLE;
+    if (ecu_fjob.CUR.CMD == ECU_FJ_SAVE) {
+        if (ecu_fjob.RES == ecu_fjob.CUR.ARG) { // Save successful 
+            logging("WDF OK\r");
+        } else { // Save failed 
+            logging("WDF NG %d\r", ecu_fjob.RES);
         }
+    } else {
+        logging("EDF %X\r", ecu_fjob.RES);
     }
-    while (R_FlashGetStatus() != FLASH_SUCCESS) {
-        ;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job operation end (ok=1 : Operation successful)
+ * ---------------------------------------------------------------------------------------- */
+void ecu_flash_end(int ok)
+{
+    int b = ecu_fjob.POS;
+
+    if (!ok && ecu_fjob.STEP != ECU_FJ_APPEND && ecu_fjob.STEP != ECU_FJ_CPT_DROP && ecu_fjob.STEP != ECU_FJ_JNL_DROP && ecu_fjob.STEP != ECU_FJ_ALL_ERASE) {
+        ecu_fjob.RES = 0; // Compaction / new slot failed (the active slot and journal are kept) 
+        ecu_flash_finish();
+        return;
+    }
+    switch (ecu_fjob.STEP) {
+    case ECU_FJ_APPEND:     // Journal record written 
+        if (ok) {
+            ecu_jnl.IDX[b] = (unsigned short)(ecu_jnl.BLK * ECU_JNL_SLOTS + ecu_jnl.SLOT + 1);
+        } else {
+            ecu_fjob.RES &= ~(1 << (b * ECU_JNL_UNIT / ECU_IMAGE_BLOCK));
+        }
+        ecu_jnl.SLOT++;
+        ecu_fjob.POS++;
+        return;
+    case ECU_FJ_CPT_ERASE:  // Other journal block erased 
+        ecu_fjob.STEP = ECU_FJ_CPT_COPY;
+        ecu_fjob.POS  = 0;
+        ecu_fjob.NUM  = 0;
+        return;
+    case ECU_FJ_CPT_COPY:   // Live chunk copied 
+        ecu_fjob.NUM++;
+        ecu_fjob.POS++;
+        return;
+    case ECU_FJ_CPT_COMMIT: // Commit written : switch the journal block 
+        ecu_fjob.NUM++;
+        ecu_jnl_index(ecu_jnl.BLK ^ 1, ecu_fjob.NUM, 0);
+        ecu_fjob.STEP = ECU_FJ_CPT_DROP;
+        return;
+    case ECU_FJ_CPT_DROP:   // Old journal block erased 
+        ecu_jnl.BLK ^= 1;
+        ecu_jnl.SLOT  = ecu_fjob.NUM;
+        ecu_fjob.STEP = ECU_FJ_APPEND;
+        ecu_fjob.POS  = 0;
+        return;
+    case ECU_FJ_JNL_ERASE:  // Stale journal block erased 
+        ecu_fjob.POS++;
+        return;
+    case ECU_FJ_HDR_ERASE:  // New slot header erased 
+        ecu_fjob.STEP = ECU_FJ_IMG_ERASE;
+        ecu_fjob.POS  = 0;
+        ecu_cfg.SUM   = 0xFFFFFFFFul;
+        return;
+    case ECU_FJ_IMG_ERASE:  // New slot image block erased 
+        ecu_fjob.STEP = ECU_FJ_IMG_WRITE;
+        return;
+    case ECU_FJ_IMG_WRITE:  // New slot image written 
+        ecu_cfg.SUM   = uds_crc32(ecu_cfg.SUM, ecu_cfg.BUF, ECU_CFG_UNIT);
+        ecu_fjob.POS += ECU_CFG_UNIT;
+        if (ecu_fjob.POS >= 3 * ECU_IMAGE_BLOCK) {
+            ecu_fjob.STEP = ECU_FJ_HDR_WRITE;
+        } else if ((ecu_fjob.POS % ECU_IMAGE_BLOCK) == 0) {
+            ecu_fjob.STEP = ECU_FJ_IMG_ERASE;
+        }
+        return;
+    case ECU_FJ_HDR_WRITE:  // New slot header written : switch the slot 
+        ecu_cfg.ACT  = (ecu_cfg.ACT < 0) ? 0 : (ecu_cfg.ACT ^ 1);
+        ecu_cfg.GEN  = ecu_cfg.HDR.GEN;
+        memset(ecu_jnl.IDX, 0, sizeof(ecu_jnl.IDX)); // Journal records belong to the previous slot 
+        ecu_fjob.STEP = ECU_FJ_JNL_DROP;
+        return;
+    case ECU_FJ_JNL_DROP:   // Journal of the previous slot erased 
+        if (ok) {
+            ecu_jnl.SLOT = 0;
+        }
+        ecu_flash_finish();
+        return;
+    case ECU_FJ_ALL_ERASE:  // Configuration block erased 
+        if (ok) {
+            ecu_fjob.RES |= 1 << (b - BLOCK_DB0);
+        }
+        ecu_fjob.POS++;
+        return;
     }
-    return wp;
 }
 
 /* ----------------------------------------------------------------------------------------
- * Batch deletion of ECU operation data
+ * Data flash job image unit build (saved blocks from RAM, others from the saved contents)
  * ---------------------------------------------------------------------------------------- */
-int ecu_data_erase(void)
+void ecu_flash_unit(int ofs, int msk)
 {
-    int bk, i;
-    int fe = 0;
+    int c;
 
-    for (i = 0, bk = BLOCK_DB0; bk <= BLOCK_DB15; bk++, i++) {
-        if (R_FlashDataAreaBlankCheck(
-                                    g_flash_BlockAddresses[bk],
-                                    BLANK_CHECK_ENTIRE_BLOCK
-        ) == FLASH_NOT_BLANK) { // With writing 
-            while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                ;
+    for (c = 0; c < ECU_CFG_UNIT; c += ECU_JNL_UNIT) {
+        if (ecu_cfg.ACT < 0 || (msk & (1 << ((ofs + c) / ECU_IMAGE_BLOCK)))) {
+            memcpy(&ecu_cfg.BUF[c], ecu_image_ptr(ofs + c), ECU_JNL_UNIT);
+        } else {
+            memcpy(&ecu_cfg.BUF[c], ecu_jnl_saved((ofs + c) / ECU_JNL_UNIT), ECU_JNL_UNIT);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job next operation
+ * ---------------------------------------------------------------------------------------- */
+void ecu_flash_next(void)
+{
+    int msk = ecu_fjob.CUR.ARG;
+    int nxt = (ecu_cfg.ACT < 0) ? 0 : (ecu_cfg.ACT ^ 1); // Inactive slot 
+    int c, n, live;
+
+    for (;;) {
+        switch (ecu_fjob.STEP) {
+        case ECU_FJ_START:      // Select the save method 
+            if (ecu_fjob.CUR.CMD == ECU_FJ_ERASE) { // Erase configuration slots and journal blocks 
+                ecu_fjob.STEP = ECU_FJ_ALL_ERASE;
+                ecu_fjob.POS  = BLOCK_DB0;
+                continue;
             }
-            if (R_FlashErase(bk) == FLASH_SUCCESS) {
-                while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                    ;
+            if (ecu_cfg.ACT < 0) { // No image yet : write all blocks to a new slot 
+                ecu_fjob.CUR.ARG = ECU_DATA_ALL;
+                ecu_fjob.RES    |= ECU_DATA_ALL & ~msk;
+                ecu_fjob.STEP    = ECU_FJ_JNL_ERASE;
+                ecu_fjob.POS     = 0;
+                continue;
+            }
+            for (c = 0, n = 0, live = 0; c < ECU_JNL_CHUNKS; c++) { // Count the changes 
+                if (ecu_jnl_changed(c, msk)) {
+                    n++;
+                    if (ecu_jnl.IDX[c] == 0) {
+                        live++;
+                    }
                 }
-                if (R_FlashDataAreaBlankCheck(
-                                            g_flash_BlockAddresses[bk],
-                                            BLANK_CHECK_ENTIRE_BLOCK
-                ) == FLASH_BLANK) { // Erase completed 
-                    fe |= (1 << i);
+                if (ecu_jnl.IDX[c] != 0) {
+                    live++;
                 }
             }
+            ecu_fjob.POS = 0;
+            if (live + 1 > ECU_JNL_SLOTS) { // Too many changes : write a new slot 
+                ecu_fjob.STEP = ECU_FJ_HDR_ERASE;
+            } else {
+                ecu_fjob.STEP = (ecu_jnl.SLOT + n > ECU_JNL_SLOTS) ? ECU_FJ_CPT_ERASE : ECU_FJ_APPEND;
+            }
+            continue;
+        case ECU_FJ_APPEND:     // Append the changed chunks 
+            for (c = ecu_fjob.POS; c < ECU_JNL_CHUNKS && !ecu_jnl_changed(c, msk); c++) {
+                ;
+            }
+            if (c >= ECU_JNL_CHUNKS) { // Completed 
+                ecu_flash_finish();
+                return;
+            }
+            if (ecu_jnl.SLOT >= ECU_JNL_SLOTS) { // Changed again while saving : select again 
+                ecu_fjob.STEP = ECU_FJ_START;
+                continue;
+            }
+            ecu_fjob.POS = c;
+            ecu_jnl_record(c, ecu_image_ptr(c * ECU_JNL_UNIT));
+            if (ecu_flash_start(-1, ecu_jnl_addr(ecu_jnl.BLK, ecu_jnl.SLOT), &ecu_jnl.BUF, sizeof(ECU_JNL_REC)) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_CPT_ERASE:  // Compaction : erase the other journal block 
+        case ECU_FJ_CPT_DROP:   // Compaction : erase the old journal block 
+            c = (ecu_fjob.STEP == ECU_FJ_CPT_ERASE) ? (ecu_jnl.BLK ^ 1) : ecu_jnl.BLK;
+            if (ecu_flash_start(ECU_JNL_BLOCK + c, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_CPT_COPY:   // Compaction : copy the live chunks 
+            for (c = ecu_fjob.POS; c < ECU_JNL_CHUNKS; c++) {
+                if (msk & (1 << (c * ECU_JNL_UNIT / ECU_IMAGE_BLOCK))) { // Saved block : RAM contents 
+                    if (ecu_jnl.IDX[c] != 0 || ecu_jnl_changed(c, msk)) {
+                        break;
+                    }
+                } else if (ecu_jnl.IDX[c] != 0) { // Other block : carry over the saved contents 
+                    break;
+                }
+            }
+            if (c >= ECU_JNL_CHUNKS) { // Copy completed 
+                ecu_fjob.STEP = ECU_FJ_CPT_COMMIT;
+                continue;
+            }
+            ecu_fjob.POS = c;
+            ecu_jnl_record(c, (msk & (1 << (c * ECU_JNL_UNIT / ECU_IMAGE_BLOCK))) ? ecu_image_ptr(c * ECU_JNL_UNIT) : ecu_jnl_saved(c));
+            if (ecu_flash_start(-1, ecu_jnl_addr(ecu_jnl.BLK ^ 1, ecu_fjob.NUM), &ecu_jnl.BUF, sizeof(ECU_JNL_REC)) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_CPT_COMMIT: // Compaction : commit record 
+            ecu_jnl_record(0, 0);
+            if (ecu_flash_start(-1, ecu_jnl_addr(ecu_jnl.BLK ^ 1, ecu_fjob.NUM), &ecu_jnl.BUF, sizeof(ECU_JNL_REC)) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_JNL_ERASE:  // First slot : the journal may still hold records of slots that failed the CRC 
+            for (c = ecu_fjob.POS; c < 2 && BlankCheck_FlashData(ADDRESS_OF_JOURNAL + (unsigned long)c * 2048) == FLASH_BLANK; c++) {
+                ;
+            }
+            if (c >= 2) { // Both blocks blank : start the journal from the top 
+                ecu_jnl_init();
+                ecu_fjob.STEP = ECU_FJ_HDR_ERASE;
+                continue;
+            }
+            ecu_fjob.POS = c;
+            if (ecu_flash_start(ECU_JNL_BLOCK + c, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_HDR_ERASE:  // New slot : invalidate the header first 
+            if (ecu_flash_start(ECU_CFG_HDR_BLOCK + nxt, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_IMG_ERASE:  // New slot : erase the image block 
+            if (ecu_flash_start(ECU_CFG_BLOCK(nxt) + ecu_fjob.POS / ECU_IMAGE_BLOCK, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_IMG_WRITE:  // New slot : write the image 
+            ecu_flash_unit(ecu_fjob.POS, msk);
+            if (ecu_flash_start(-1, ecu_cfg_addr(nxt) + (unsigned long)ecu_fjob.POS, ecu_cfg.BUF, ECU_CFG_UNIT) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_HDR_WRITE:  // New slot : header (generation and CRC32) 
+            ecu_cfg.HDR.MAGIC = ECU_CFG_MAGIC;
+            ecu_cfg.HDR.GEN   = ecu_cfg.GEN + 1;
+            ecu_cfg.HDR.SUM   = ecu_cfg.SUM ^ 0xFFFFFFFFul;
+            ecu_cfg.HDR.CHK   = ~(ecu_cfg.HDR.MAGIC ^ ecu_cfg.HDR.GEN ^ ecu_cfg.HDR.SUM);
+            if (ecu_flash_start(-1, ADDRESS_OF_SLOTHDR + (unsigned long)nxt * 2048, &ecu_cfg.HDR, sizeof(ECU_CFG_HDR)) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_JNL_DROP:   // Erase the journal of the previous slot 
+            if (ecu_jnl.SLOT == 0) { // Journal not used 
+                ecu_flash_finish();
+                return;
+            }
+            if (ecu_flash_start(ECU_JNL_BLOCK + ecu_jnl.BLK, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        case ECU_FJ_ALL_ERASE:  // Erase the slots, journal and header blocks (not the OBD2 / DTC logs) 
+            if (ecu_fjob.POS == ECU_CFG_BLOCK(0) + 3) {
+                ecu_fjob.POS = ECU_JNL_BLOCK;
+            }
+            if (ecu_fjob.POS > ECU_CFG_HDR_BLOCK + 1) { // Completed 
+                ecu_cfg.ACT = -1;
+                ecu_cfg.GEN = 0;
+                ecu_jnl_init();
+                ecu_flash_finish();
+                return;
+            }
+            if (ecu_flash_start(ecu_fjob.POS, 0, 0, 0) != 0) {
+                ecu_flash_end(0);
+            }
+            return;
+        default:
+            ecu_flash_finish();
+            return;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Data flash job processing (call from main loop)
+ * ---------------------------------------------------------------------------------------- */
+void ecu_flash_job(void)
+{
+    if (ecu_fjob.STAT == ECU_FS_WAIT) { // Waiting for the FCU ready interrupt 
+        if (ecu_fjob.BGO == FLASH_BUSY || R_FlashGetStatus() != FLASH_SUCCESS) {
+            return;
         }
+        ecu_fjob.STAT = ECU_FS_RUN;
+        ecu_flash_end(ecu_fjob.BGO == FLASH_SUCCESS);
+        return;
+    }
+    if (R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy 
+        return;
+    }
+    if (ecu_fjob.STAT == ECU_FS_IDLE) { // Start the next job 
+        if (ecu_fjob.CNT == 0 || uds_prog_busy() || uds_load.MODE != UDS_TD_NONE) {
+            return;
+        }
+        ecu_fjob.CUR  = ecu_fjob.Q[ecu_fjob.RP];
+        ecu_fjob.RP   = (ecu_fjob.RP + 1) % ECU_FJ_QUEUE;
+        ecu_fjob.CNT--;
+        ecu_fjob.STEP = ECU_FJ_START;
+        ecu_fjob.RES  = (ecu_fjob.CUR.CMD == ECU_FJ_SAVE) ? ecu_fjob.CUR.ARG : 0;
+        ecu_fjob.STAT = ECU_FS_RUN;
+    }
+    ecu_flash_next();
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Selective storage of ECU operation data (ECU_DATA_MAP / ECU_DATA_CONF / ECU_DATA_IO)
+ *
+ *  Queued to the data flash job. Changed 8 byte chunks are appended to the journal.
+ *  Return the accepted block bits (0=Queue full)
+ * ---------------------------------------------------------------------------------------- */
+int ecu_data_save(int msk)
+{
+    msk &= ECU_DATA_ALL;
+    if (msk == 0 || ecu_flash_request(ECU_FJ_SAVE, msk) != 0) {
+        return 0;
+    }
+    return msk;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Batch storage of ECU operation data
+ * ---------------------------------------------------------------------------------------- */
+int ecu_data_write(void)
+{
+    return ecu_data_save(ECU_DATA_ALL);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Batch deletion of ECU operation data (queued, configuration slots and journal)
+ * Return the block bits to be erased (0=Queue full)
+ * ---------------------------------------------------------------------------------------- */
+int ecu_data_erase(void)
+{
+    if (ecu_flash_request(ECU_FJ_ERASE, 0) != 0) {
+        return 0;
     }
-    return fe;
+    return ECU_DATA_ALL | (((1 << (ECU_CFG_HDR_BLOCK + 2 - ECU_JNL_BLOCK)) - 1) << (ECU_JNL_BLOCK - BLOCK_DB0));
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -303,11 +837,9 @@ int ecu_data_check(void)
     int bk, i;
     int wf = 0;
 
+    Wait_FlashData(); // Data flash cannot be read during a job operation 
     for (i = 0, bk = BLOCK_DB0; bk <= BLOCK_DB15; bk++, i++) {
-        if (R_FlashDataAreaBlankCheck(
-                                    g_flash_BlockAddresses[bk],
-                                    BLANK_CHECK_ENTIRE_BLOCK
-        ) == FLASH_NOT_BLANK) { // With writing 
+        if (BlankCheck_FlashData(g_flash_BlockAddresses[bk]) == FLASH_NOT_BLANK) { // With writing 
             wf |= (1 << i);
         }
     }
@@ -42,6 +42,7 @@
 #include "iodefine.h"
 #include "ecu.h"            // ECU common definition 
 #include "sci.h"
+#include "trace.h"          // Event trace 
 
 /*
  *  Port setting
@@ -89,6 +90,11 @@ SCI_MODULE sci_com[7];
 // Log function 
 void logging(char *fmt, ...);
 
+// DMAC transmission 
+void sci_txdma_init(volatile struct st_dmac1 __evenaccess *dma, volatile unsigned char __evenaccess *rsr, int vect, volatile unsigned char __evenaccess *tdr);
+void sci_txdma_start(SCI_MODULE *com, volatile struct st_dmac1 __evenaccess *dma, volatile unsigned char __evenaccess *tdr);
+void sci_txdma_done(SCI_MODULE *com);
+
 /* ----------------------------------------------------------------------------------------
  * sci0_init
  *
@@ -190,6 +196,9 @@ void sci0_init(long bps, int datalen, int stoplen, int parity)
     SYSTEM.MSTPCRA.BIT.ACSE = 0;
     // Release of SCI0 module stop state 
     MSTP_SCI0 = 0;
+#ifdef  SCI0_TXDMA
+    sci_txdma_init(&DMAC2, &ICU.DMRSR2.BYTE, VECT_SCI0_TXI0, &SCI0.TDR);
+#endif
 
 
     // Select an On-chip baud rate generator to the clock source 
@@ -578,6 +587,9 @@ void sci2_init(long bps, int datalen, int stoplen, int parity)
     SYSTEM.MSTPCRA.BIT.ACSE = 0;
     // Release of SCI2 module stop state 
     MSTP_SCI2 = 0;
+#ifdef  SCI2_TXDMA
+    sci_txdma_init(&DMAC3, &ICU.DMRSR3.BYTE, VECT_SCI2_TXI2, &SCI2.TDR);
+#endif
 
     // Select an On-chip baud rate generator to the clock source 
     SCI2.SCR.BIT.CKE = 0;
@@ -1280,16 +1292,16 @@ int sci_txbytes(int ch)
 /* ----------------------------------------------------------------------------------------
  * SCI0 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci0_putb(unsigned char *buf, int size)
+int sci0_putb(unsigned char *buf, int size)
 {
-    int i, ch = 0;
+    int n = size, ch = 0;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef      SCI0_ACTIVATE
 #ifdef  SCI0_FLOW
         if (SCI0_CTS_PORT != 0) { // CTS=Disable 
             if (sci_putcheck(ch) < 2) {
-                return;
+                break;
             }
         }
 #endif // ifdef  SCI0_FLOW
@@ -1336,20 +1348,21 @@ void sci0_putb(unsigned char *buf, int size)
 #endif
     }
 #endif // ifdef      SCI0_ACTIVATE
+    return (n - size);
 }
 /* ----------------------------------------------------------------------------------------
  * SCI1 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci1_putb(unsigned char *buf, int size)
+int sci1_putb(unsigned char *buf, int size)
 {
-    int i, ch = 1;
+    int n = size, ch = 1;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef      SCI1_ACTIVATE
 #ifdef  SCI1_FLOW
         if (SCI1_CTS_PORT != 0) { // CTS=Disable 
             if (sci_putcheck(ch) < 2) {
-                return;
+                break;
             }
         }
 #endif // ifdef  SCI1_FLOW
@@ -1396,20 +1409,21 @@ void sci1_putb(unsigned char *buf, int size)
 #endif
     }
 #endif // ifdef      SCI1_ACTIVATE
+    return (n - size);
 }
 /* ----------------------------------------------------------------------------------------
  * SCI2 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci2_putb(unsigned char *buf, int size)
+int sci2_putb(unsigned char *buf, int size)
 {
-    int i, ch = 2;
+    int n = size, ch = 2;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef      SCI2_ACTIVATE
 #ifdef  SCI2_FLOW
         if (SCI2_CTS_PORT != 0) { // CTS=Disable 
             if (sci_putcheck(ch) < 2) {
-                return;
+                break;
             }
         }
 #endif // ifdef  SCI2_FLOW
@@ -1456,20 +1470,21 @@ void sci2_putb(unsigned char *buf, int size)
 #endif
     }
 #endif // ifdef      SCI2_ACTIVATE
+    return (n - size);
 }
 /* ----------------------------------------------------------------------------------------
  * SCI3 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci3_putb(unsigned char *buf, int size)
+int sci3_putb(unsigned char *buf, int size)
 {
-    int i, ch = 3;
+    int n = size, ch = 3;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef      SCI3_ACTIVATE
 #ifdef  SCI3_FLOW
         if (SCI3_CTS_PORT != 0) { // CTS=Disable 
             if (sci_putcheck(ch) < 2) {
-                return;
+                break;
             }
         }
 #endif // ifdef  SCI3_FLOW
@@ -1516,13 +1531,14 @@ void sci3_putb(unsigned char *buf, int size)
 #endif
     }
 #endif // ifdef      SCI3_ACTIVATE
+    return (n - size);
 }
 /* ----------------------------------------------------------------------------------------
  * SCI5 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci5_putb(unsigned char *buf, int size)
+int sci5_putb(unsigned char *buf, int size)
 {
-    int i, ch = 5;
+    int n = size, ch = 5;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef SCI5_ACTIVATE
@@ -1551,20 +1567,21 @@ void sci5_putb(unsigned char *buf, int size)
         SCI5.SCR.BIT.TE  = 1;   // Transmission enable 
     }
 #endif
+    return (n - size);
 }
 /* ----------------------------------------------------------------------------------------
  * SCI6 SEND
  * ---------------------------------------------------------------------------------------- */
-void sci6_putb(unsigned char *buf, int size)
+int sci6_putb(unsigned char *buf, int size)
 {
-    int i, ch = 6;
+    int n = size, ch = 6;
     SCI_MODULE *com = &sci_com[ch];
     while (size > 0) {
 #ifdef      SCI6_ACTIVATE
 #ifdef  SCI6_FLOW
         if (SCI6_CTS_PORT != 0) { // CTS=Disable 
             if (sci_putcheck(ch) < 2) {
-                return;
+                break;
             }
         }
 #endif // ifdef  SCI6_FLOW
@@ -1611,6 +1628,38 @@ void sci6_putb(unsigned char *buf, int size)
 #endif
     }
 #endif // ifdef      SCI6_ACTIVATE
+    return (n - size);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * sci_write
+ * 
+ *  Function description
+ *      Transmit byte sequence to SCI without waiting
+ *      (writes as much as fits in the transmission buffer)
+ * 
+ *  Argument
+ *      ch    SCI channel
+ *      *buf  Transmit byte sequence
+ *      len   Byte length
+ * 
+ *  Return
+ *      int   Number of bytes written (the caller resumes from there)
+ * ----------------------------------------------------------------------------------------*/
+int sci_write(int ch, unsigned char *buf, int len)
+{
+    int f;
+    if (ch < 0 || ch >= 7) {
+        return 0;
+    }
+    f = sci_putcheck(ch) - 1; // sciN_putb waits while less than 2 bytes are free 
+    if (len > f) {
+        len = f;
+    }
+    if (len <= 0) {
+        return 0;
+    }
+    return sci_putb(ch, buf, len);
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1624,41 +1673,22 @@ void sci6_putb(unsigned char *buf, int size)
  *      *str  Sent string
  * 
  *  Return
- *      int   Number of free bytes
+ *      int   Number of bytes written (less only when CTS is disabled, the rest is counted)
  * ----------------------------------------------------------------------------------------*/
-void sci_puts(int ch, char *str)
+int sci_puts(int ch, char *str)
 {
     int len = 0;
     for (len = 0; str[len] != 0 && len < 256; len++) {
         ;
     }
-    switch (ch) {
-    case 0:
-        sci0_putb((unsigned char *)str, len);
-        break;
-    case 1:
-        sci1_putb((unsigned char *)str, len);
-        break;
-    case 2:
-        sci2_putb((unsigned char *)str, len);
-        break;
-    case 3:
-        sci3_putb((unsigned char *)str, len);
-        break;
-    case 5:
-        sci5_putb((unsigned char *)str, len);
-        break;
-    case 6:
-        sci6_putb((unsigned char *)str, len);
-        break;
-    }
+    return sci_putb(ch, (unsigned char *)str, len);
 }
 
 /* ----------------------------------------------------------------------------------------
  * sci_putb
  *
  *  Function description
- *      Transmit byte sequence to SCI
+ *      Transmit byte sequence to SCI (waits while the transmission buffer is full)
  * 
  *  Argument
  *      ch    SCI channel
@@ -1666,30 +1696,37 @@ void sci_puts(int ch, char *str)
  *      len   Byte length
  * 
  *  Return
- *      int   Number of free bytes
+ *      int   Number of bytes written (less only when CTS is disabled, the rest is counted)
  * ----------------------------------------------------------------------------------------*/
-void sci_putb(int ch, unsigned char *buf, int len)
+int sci_putb(int ch, unsigned char *buf, int len)
 {
+    int n = 0;
     switch (ch) {
     case 0:
-        sci0_putb(buf, len);
+        n = sci0_putb(buf, len);
         break;
     case 1:
-        sci1_putb(buf, len);
+        n = sci1_putb(buf, len);
         break;
     case 2:
-        sci2_putb(buf, len);
+        n = sci2_putb(buf, len);
         break;
     case 3:
-        sci3_putb(buf, len);
+        n = sci3_putb(buf, len);
         break;
     case 5:
-        sci5_putb(buf, len);
+        n = sci5_putb(buf, len);
         break;
     case 6:
-        sci6_putb(buf, len);
+        n = sci6_putb(buf, len);
         break;
+    default:
+        return 0;
     }
+    if (n < len) {
+        sci_com[ch].drop += len - n; // CTS disabled with the buffer full 
+    }
+    return n;
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -1707,28 +1744,117 @@ void sci_putb(int ch, unsigned char *buf, int len)
  * ----------------------------------------------------------------------------------------*/
 void sci_putc(int ch, char data)
 {
-    char str[2];
-    str[0]  = data;
-    str[1]  = 0;
-    switch (ch) {
-    case 0:
-        sci0_putb((unsigned char *)str, 1);
-        break;
-    case 1:
-        sci1_putb((unsigned char *)str, 1);
-        break;
-    case 2:
-        sci2_putb((unsigned char *)str, 1);
-        break;
-    case 3:
-        sci3_putb((unsigned char *)str, 1);
-        break;
-    case 5:
-        sci5_putb((unsigned char *)str, 1);
-        break;
-    case 6:
-        sci6_putb((unsigned char *)str, 1);
-        break;
+    sci_putb(ch, (unsigned char *)&data, 1);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * sci_txdrop
+ * 
+ *  Function description
+ *      Number of transmit bytes dropped by sci_putb / sci_puts / sci_putc (CTS disabled)
+ * 
+ *  Argument
+ *      ch    SCI channel
+ * 
+ *  Return
+ *      int   Dropped bytes since the SCI initialization
+ * ----------------------------------------------------------------------------------------*/
+int sci_txdrop(int ch)
+{
+    if (ch < 0 || ch >= 7) {
+        return 0;
+    }
+    return sci_com[ch].drop;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * sci_txdma_init
+ * 
+ *  Function description
+ *      DMAC channel setting for SCI transmission (byte transfer to TDR, activated by TXI)
+ *      No DMAC interrupt is used : while DTE=1 the TXI requests go to the DMAC, and the
+ *      TXI after the last byte goes to the CPU again, which starts the next part.
+ * 
+ *  Argument
+ *      dma   DMAC channel (DMAC1 to DMAC3)
+ *      rsr   DMAC activation request select register
+ *      vect  TXI vector number
+ *      tdr   SCI transmit data register
+ * 
+ *  Return
+ *      None
+ * ----------------------------------------------------------------------------------------*/
+void sci_txdma_init(volatile struct st_dmac1 __evenaccess *dma, volatile unsigned char __evenaccess *rsr, int vect, volatile unsigned char __evenaccess *tdr)
+{
+    MSTP_DMAC               = 0;    // Release DMAC module stop 
+    dma->DMCNT.BIT.DTE      = 0;    // Transfer disable 
+    *rsr                    = (unsigned char)vect; // Activation source 
+    dma->DMTMD.BIT.MD       = 0;    // Normal transfer 
+    dma->DMTMD.BIT.SZ       = 0;    // 8 bit 
+    dma->DMTMD.BIT.DCTG     = 1;    // Activated by peripheral interrupt 
+    dma->DMAMD.BIT.SM       = 2;    // Source address increment 
+    dma->DMAMD.BIT.DM       = 0;    // Destination address fixed 
+    dma->DMDAR              = (unsigned long)tdr;
+    dma->DMINT.BYTE         = 0;    // No DMAC interrupt 
+    dma->DMCSL.BIT.DISEL    = 0;    // TXI is not passed to the CPU while transferring 
+    DMAC.DMAST.BIT.DMST     = 1;    // DMAC operation enable 
+}
+
+/* ----------------------------------------------------------------------------------------
+ * sci_txdma_start
+ * 
+ *  Function description
+ *      Send the contiguous part of txbuf from txrp (call from TXI / TEI with data remaining)
+ *      The first byte is written by the CPU, the rest by the DMAC.
+ * 
+ *  Argument
+ *      com   SCI management structure
+ *      dma   DMAC channel
+ *      tdr   SCI transmit data register
+ * 
+ *  Return
+ *      None
+ * ----------------------------------------------------------------------------------------*/
+void sci_txdma_start(SCI_MODULE *com, volatile struct st_dmac1 __evenaccess *dma, volatile unsigned char __evenaccess *tdr)
+{
+    int i = com->txrp;
+    int n = ((com->txwp > i) ? com->txwp : BUFSIZE) - i; // Bytes up to the write pointer or the buffer end 
+
+    if (n > SCI_TXDMA_MAX) {
+        n = SCI_TXDMA_MAX;
+    }
+    com->txseg++;
+    if (n > 1) { // Start the DMAC before TDR becomes empty 
+        dma->DMSAR         = (unsigned long)&com->txbuf[i + 1];
+        dma->DMCRA         = (unsigned long)(n - 1);
+        dma->DMCNT.BIT.DTE = 1;
+        com->txdma         = n;
+    } else {
+        com->txrp = (i + 1 < BUFSIZE) ? (i + 1) : 0;
+    }
+    *tdr = com->txbuf[i];
+}
+
+/* ----------------------------------------------------------------------------------------
+ * sci_txdma_done
+ * 
+ *  Function description
+ *      Release the part sent by the DMAC from txbuf
+ * 
+ *  Argument
+ *      com   SCI management structure
+ * 
+ *  Return
+ *      None
+ * ----------------------------------------------------------------------------------------*/
+void sci_txdma_done(SCI_MODULE *com)
+{
+    if (com->txdma > 0) {
+        com->txrp += com->txdma;
+        if (com->txrp >= BUFSIZE) {
+            com->txrp -= BUFSIZE;
+        }
+        com->txdma = 0;
     }
 }
 
@@ -1752,8 +1878,13 @@ void sci_putc(int ch, char data)
 // 215
 void interrupt __vectno__ {VECT_SCI0_TXI0} sci0_txi(void)
 {
+#ifndef SCI0_TXDMA
     int i;
+#endif
     SCI_MODULE *com = &sci_com[0];
+#ifdef  SCI0_TXDMA
+    sci_txdma_done(com); // Part sent by the DMAC 
+#endif
     if (com->txrp != com->txwp) { // Data remains in buffer 
 #ifdef  SCI0_TXOSDN
         SCI0_TXOSDN_PORT = 1; // 0=Receive only / 1=Transmit possible 
@@ -1761,11 +1892,15 @@ void interrupt __vectno__ {VECT_SCI0_TXI0} sci0_txi(void)
 #ifdef  SCI0_FLOW
         if (SCI0_CTS_PORT == 0) { // CTS=Enable 
 #endif
+#ifdef  SCI0_TXDMA
+        sci_txdma_start(com, &DMAC2, &SCI0.TDR);
+#else
         i = com->txrp++;
         if (com->txrp >= BUFSIZE) {
             com->txrp = 0;
         }
         SCI0.TDR = com->txbuf[i];
+#endif
 #ifdef  SCI0_FLOW
     } else { // Stop transmission by CTS 
         SCI0.SCR.BIT.TIE  = 0; // TXI interrupt disable 
@@ -1817,8 +1952,13 @@ void interrupt sci1_txi(void)
  * 221*/
 void interrupt __vectno__ {VECT_SCI2_TXI2} sci2_txi(void)
 {
+#ifndef SCI2_TXDMA
     int i;
+#endif
     SCI_MODULE *com = &sci_com[2];
+#ifdef  SCI2_TXDMA
+    sci_txdma_done(com); // Part sent by the DMAC 
+#endif
     if (com->txrp != com->txwp) { // Data remains in buffer 
 #ifdef  SCI2_TXOSDN
         SCI2_TXOSDN_PORT = 1;     // 0=Receive only / 1=Transmit enable 
@@ -1826,11 +1966,15 @@ void interrupt __vectno__ {VECT_SCI2_TXI2} sci2_txi(void)
 #ifdef  SCI2_FLOW
         if (SCI2_CTS_PORT == 0) { // CTS=Enable 
 #endif
+#ifdef  SCI2_TXDMA
+        sci_txdma_start(com, &DMAC3, &SCI2.TDR);
+#else
         i = com->txrp++;
         if (com->txrp >= BUFSIZE) {
             com->txrp = 0;
         }
         SCI2.TDR = com->txbuf[i];
+#endif
 #ifdef  SCI2_FLOW
     } else { // Stop transmission by CTS 
         SCI2.SCR.BIT.TIE  = 0; // TXI interrupt disable 
@@ -1952,19 +2096,28 @@ void interrupt __vectno__ {VECT_SCI6_TXI6} sci6_txi(void)
  * 216*/
 void interrupt __vectno__ {VECT_SCI0_TEI0} sci0_tei(void)
 {
+#ifndef SCI0_TXDMA
     int i;
+#endif
     SCI_MODULE *com = &sci_com[0];
     SCI0.SCR.BIT.TEIE = 0; // TEI interrupt disable 
+#ifdef  SCI0_TXDMA
+    sci_txdma_done(com); // Part sent by the DMAC 
+#endif
 #ifdef  SCI0_TXOSDN
     SCI0_TXOSDN_PORT = 0; // 0=nRE(Receiving) / 1=DE(Transmission) 
 #endif
     if (com->txrp != com->txwp) { // Data remains in buffer 
         SCI0.SCR.BIT.TIE = 1; // Transmit operation enable 
+#ifdef  SCI0_TXDMA
+        sci_txdma_start(com, &DMAC2, &SCI0.TDR);
+#else
         i = com->txrp++;
         if (com->txrp >= BUFSIZE) {
             com->txrp = 0;
         }
         SCI0.TDR = com->txbuf[i];
+#endif
     } else {
         SCI0.SCR.BIT.TE = 0; // Transmit operation disable 
     }
@@ -2001,19 +2154,28 @@ void interrupt sci1_tei(void)
  * 222*/
 void interrupt __vectno__ {VECT_SCI2_TEI2} sci2_tei(void)
 {
+#ifndef SCI2_TXDMA
     int i;
+#endif
     SCI_MODULE *com = &sci_com[2];
     SCI2.SCR.BIT.TEIE = 0; // TEI interrupt disable 
+#ifdef  SCI2_TXDMA
+    sci_txdma_done(com); // Part sent by the DMAC 
+#endif
 #ifdef  SCI2_TXOSDN
     SCI2_TXOSDN_PORT = 0;  // 0=nRE(Receiving) / 1=DE(Transmission) 
 #endif
     if (com->txrp != com->txwp) {   // Data remains in buffer 
         SCI2.SCR.BIT.TIE = 1; // Transmit operation enable 
+#ifdef  SCI2_TXDMA
+        sci_txdma_start(com, &DMAC3, &SCI2.TDR);
+#else
         i = com->txrp++;
         if (com->txrp >= BUFSIZE) {
             com->txrp = 0;
         }
         SCI2.TDR = com->txbuf[i];
+#endif
     } else {
         SCI2.SCR.BIT.TE = 0; // Transmit operation disable 
     }
@@ -2269,14 +2431,14 @@ void interrupt __vectno__ {VECT_ICU_GROUPL0} sci_err(void)
     if (ICU.GRP[GRP_RSPI1_SPEI1].BIT.IS_RSPI1_SPEI1) { // RSPI1 With error 
         e = (unsigned short)RSPI1.SPSR.BYTE;
         RSPI1.SPSR.BYTE = 0;
-        logging("SPI1 Error %02X\r", (int)e);
+        TRACE(TRC_SPI_ERR, 1, e);
     }
 #endif // ifdef      RSPI1_ACTIVATE
     // RSPI2 
     if (ICU.GRP[GRP_RSPI2_SPEI2].BIT.IS_RSPI2_SPEI2) { // RSPI2 With error 
         e = (unsigned short)RSPI2.SPSR.BYTE;
         RSPI2.SPSR.BYTE = 0;
-        logging("SPI2 Error %02X\r", (int)e);
+        TRACE(TRC_SPI_ERR, 2, e);
     }
 }
 
@@ -2592,6 +2754,16 @@ int sci_get_line(int ch, char *str, int size, char echar)
 void sci_clear(int ch)
 {
     SCI_MODULE *com = &sci_com[ch];
+#ifdef  SCI0_TXDMA
+    if (ch == 0) {
+        DMAC2.DMCNT.BIT.DTE = 0; // Stop the part being sent 
+    }
+#endif
+#ifdef  SCI2_TXDMA
+    if (ch == 2) {
+        DMAC3.DMCNT.BIT.DTE = 0; // Stop the part being sent 
+    }
+#endif
     memset(com, 0, sizeof(SCI_MODULE));
     switch (ch) {
 #ifdef      SCI0_ACTIVATE
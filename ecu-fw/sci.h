@@ -94,6 +94,13 @@
 
 // SCI buffer size 
 #define     BUFSIZE     1024
+/* Transmit by DMAC : the DMAC moves each contiguous part of txbuf to TDR,
+ * one TXI interrupt per part instead of one per byte
+ * (SCI0 : DMAC2 / SCI2 : DMAC3, DMAC0 and DMAC1 are free)
+ * Not verified on hardware yet, off until checked on the target
+ * #define  SCI0_TXDMA
+ * #define  SCI2_TXDMA */
+#define     SCI_TXDMA_MAX   128     // Bytes per part (txbuf space is released per part) 
 /* Use SCI0 as RS-485 half duplex
  * #define  SCI0_RS485
  * Use nRTS and nCTS of SCI1
@@ -108,12 +115,15 @@ typedef struct  __sci_module__ {
     unsigned char   rxbuf[BUFSIZE];     // Receiving buffer 
     int             txwp;               // Transmit write pointer 
     int             txrp;               // Transmit  read pointer 
+    int             txdma;              // Bytes handed to the DMAC (advance txrp on the next TXI) 
+    int             txseg;              // Transmitted parts (TXI / TEI interrupts with data) 
     int             rxwp;               // Receive  write pointer 
     int             rxrp;               // Receive   read pointer 
     int             err;                // Total    error counter 
     int             perr;               // Parity   error counter 
     int             ferr;               // Framing  error counter 
     int             oerr;               // Overrun  error counter 
+    int             drop;               // Transmit bytes dropped (buffer full) 
 }   SCI_MODULE;
 
 //Indirect call prototype (1 argument) 
@@ -319,14 +329,30 @@ extern int sci_txbytes(int ch);
  *      size  Number of transmit bytes
  * 
  *  Return
- *      None
+ *      int   Number of bytes written (waits while the buffer is full, stops when CTS is disabled)
  * ----------------------------------------------------------------------------------------*/
-extern void sci0_putb(unsigned char *buf, int size);
-extern void sci1_putb(unsigned char *buf, int size);
-extern void sci2_putb(unsigned char *buf, int size);
-extern void sci3_putb(unsigned char *buf, int size);
-extern void sci5_putb(unsigned char *buf, int size);
-extern void sci6_putb(unsigned char *buf, int size);
+extern int sci0_putb(unsigned char *buf, int size);
+extern int sci1_putb(unsigned char *buf, int size);
+extern int sci2_putb(unsigned char *buf, int size);
+extern int sci3_putb(unsigned char *buf, int size);
+extern int sci5_putb(unsigned char *buf, int size);
+extern int sci6_putb(unsigned char *buf, int size);
+
+/* ----------------------------------------------------------------------------------------
+ * sci_write
+ * 
+ *  Function description
+ *      Transmit byte sequence to SCI without waiting
+ * 
+ *  Argument
+ *      ch    SCI channel
+ *      *buf  Transmit byte sequence
+ *      len   Byte length
+ * 
+ *  Return
+ *      int   Number of bytes written (the caller resumes from there)
+ * ----------------------------------------------------------------------------------------*/
+extern int sci_write(int ch, unsigned char *buf, int len);
 
 /* ----------------------------------------------------------------------------------------
  * sci_puts
@@ -339,15 +365,15 @@ extern void sci6_putb(unsigned char *buf, int size);
  *      *str  Sent string
  * 
  *  Return
- *      int   Number of free bytes
+ *      int   Number of bytes written (less only when CTS is disabled, the rest is counted)
  * ----------------------------------------------------------------------------------------*/
-extern void sci_puts(int ch, char *str);
+extern int sci_puts(int ch, char *str);
 
 /* ----------------------------------------------------------------------------------------
  * sci_putb
  *
  *  Function description
- *      Transmit byte sequence to SCI
+ *      Transmit byte sequence to SCI (waits while the transmission buffer is full)
  * 
  *  Argument
  *      ch    SCI channel
@@ -355,9 +381,9 @@ extern void sci_puts(int ch, char *str);
  *      len   Byte length
  * 
  *  Return
- *      int   Number of free bytes
+ *      int   Number of bytes written (less only when CTS is disabled, the rest is counted)
  * ----------------------------------------------------------------------------------------*/
-extern void sci_putb(int ch, unsigned char *buf, int len);
+extern int sci_putb(int ch, unsigned char *buf, int len);
 
 /* ----------------------------------------------------------------------------------------
  *
@@ -374,6 +400,20 @@ extern void sci_putb(int ch, unsigned char *buf, int len);
  */
 extern void sci_putc(int ch, char data);
 
+/* ----------------------------------------------------------------------------------------
+ * sci_txdrop
+ * 
+ *  Function description
+ *      Number of transmit bytes dropped by sci_putb / sci_puts / sci_putc (CTS disabled)
+ * 
+ *  Argument
+ *      ch    SCI channel
+ * 
+ *  Return
+ *      int   Dropped bytes since the SCI initialization
+ * ----------------------------------------------------------------------------------------*/
+extern int sci_txdrop(int ch);
+
 /* ----------------------------------------------------------------------------------------
  * sci_putc
  * 
@@ -57,6 +57,7 @@ typedef void (*TIMER_CALL)(void);
 #define     ECU_TIMER_ID    0                   // ECU timer (1ms) 
 #define     TP_TIMER_ID     1                   // Separation timer 
 #define     DTC_TIMER_ID    2                   // DTC continuation timer 
+#define     UDS_TIMER_ID    3                   // UDS response pending timer 
 
 /* ----------------------------------------------------------------------------------------
  *  cmt0_init
@@ -0,0 +1,181 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 LandF Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ----------------------------------------------------------------------------------------
+ *
+ * Binary event trace
+ *
+ * ----------------------------------------------------------------------------------------
+ * Development history
+ *
+ * 2026/10/19 Start coding
+ *
+ * ----------------------------------------------------------------------------------------
+ * L&F
+ * ----------------------------------------------------------------------------------------
+ */
+
+#include <sysio.h>
+#include <string.h>
+#include <stdio.h>
+#include "iodefine.h"
+#include "timer.h"
+#include "sci.h"
+#include "trace.h"
+
+/* ----------------------------------------------------------------------------------------
+ * Variable definition
+ * ---------------------------------------------------------------------------------------- */
+TRACE_STR   trace;                          // Event ring 
+
+extern unsigned int freerun_timer;          // Free run timer (timer.c) 
+
+/* ----------------------------------------------------------------------------------------
+ * Event name table (text drain)
+ * ---------------------------------------------------------------------------------------- */
+const char *const trace_name[TRC_EVT_MAX] = {
+    "-",            // TRC_NONE 
+    "CONF.NEW",     // TRC_CONF_NEW 
+    "CONF.TOP",     // TRC_CONF_TOP 
+    "CONF.ADD",     // TRC_CONF_ADD 
+    "CONF.INS",     // TRC_CONF_INS 
+    "WAIT.NEW",     // TRC_WAIT_NEW 
+    "WAIT.TOP",     // TRC_WAIT_TOP 
+    "WAIT.INS",     // TRC_WAIT_INS 
+    "WAIT.ADD",     // TRC_WAIT_ADD 
+    "WAIT.CHAIN",   // TRC_WAIT_CHAIN 
+    "CAN.TXERR",    // TRC_CAN_TXERR 
+    "CAN.BOST",     // TRC_CAN_BOST 
+    "CAN.FIFO",     // TRC_CAN_FIFO 
+    "CAN3.RDBK",    // TRC_CAN3_RDBK 
+    "CAN3.TMO",     // TRC_CAN3_TMO 
+    "CAN3.ERR",     // TRC_CAN3_ERR 
+    "CAN3.WAKE",    // TRC_CAN3_WAKE 
+    "CAN3.MERR",    // TRC_CAN3_MERR 
+    "SPI.ERR",      // TRC_SPI_ERR 
+    "SPI.IDLE",     // TRC_SPI_IDLE 
+    "OPMODE"        // TRC_OPMODE 
+};
+
+/* ----------------------------------------------------------------------------------------
+ * trace_init
+ * 
+ * Outline
+ *     Clear the ring and stop the text drain
+ * ---------------------------------------------------------------------------------------- */
+void trace_init(void)
+{
+    memset(&trace, 0, sizeof(TRACE_STR));
+    trace.PORT = -1;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * trace_put
+ * 
+ * Outline
+ *     Record one event
+ *
+ * Argument
+ *     int evt          Event ID (TRC_xxx)
+ *     unsigned long a  Argument 1
+ *     unsigned long b  Argument 2
+ *
+ * Description
+ *     Only the writers touch WP and only the main loop reader touches RP, so no interrupt
+ *     masking is needed against trace_get. The slot is claimed before it is filled; an
+ *     interrupt recording between the WP load and store of a main loop call reuses the
+ *     same slot and one of the two events is lost, which is accepted for a trace.
+ *     When the ring is full the new event is dropped and counted in LOST.
+ * ---------------------------------------------------------------------------------------- */
+void trace_put(int evt, unsigned long a, unsigned long b)
+{
+    unsigned int    wp = trace.WP;
+    TRACE_EVENT     *ev;
+
+    if (wp - trace.RP >= TRACE_MAX) { // Ring full 
+        trace.LOST++;
+        return;
+    }
+    trace.WP    = wp + 1;                   // Claim the slot 
+    ev          = &trace.BUF[wp & TRACE_MSK];
+    ev->EVT     = (unsigned short)evt;
+    ev->SUB     = (unsigned short)CMT0.CMCNT;
+    ev->TIM     = (unsigned long)freerun_timer;
+    ev->A       = a;
+    ev->B       = b;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * trace_get
+ * 
+ * Outline
+ *     Take the oldest event
+ *
+ * Argument
+ *     TRACE_EVENT *ev  Copy destination
+ *
+ * Return
+ *     1:event copied  0:ring empty
+ * ---------------------------------------------------------------------------------------- */
+int trace_get(TRACE_EVENT *ev)
+{
+    unsigned int    rp = trace.RP;
+
+    if (rp == trace.WP) {
+        return 0;
+    }
+    memcpy(ev, &trace.BUF[rp & TRACE_MSK], sizeof(TRACE_EVENT));
+    trace.RP = rp + 1;
+    return 1;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * trace_job
+ * 
+ * Outline
+ *     Text drain of one event per call
+ *
+ * Description
+ *     Runs only while more than half of the console transmission buffer is free, so
+ *     command replies and the EXU stream keep their bandwidth.
+ *     Output : TRC <msec>.<usec> <name> <A> <B>
+ * ---------------------------------------------------------------------------------------- */
+void trace_job(void)
+{
+    TRACE_EVENT ev;
+    char        line[TRACE_LINE];
+    int         n;
+
+    if (trace.PORT < 0 || trace.RP == trace.WP) {
+        return;
+    }
+    if (sci_putcheck(trace.PORT) < BUFSIZE / 2) {
+        return; // Console is busy 
+    }
+    trace_get(&ev);
+    n = sprintf(line, "TRC %lu.%03u %s %08lX %08lX\r",
+        ev.TIM, (unsigned int)(ev.SUB / CMT1_1US),
+        (ev.EVT < TRC_EVT_MAX) ? trace_name[ev.EVT] : "?", ev.A, ev.B);
+    sci_putb(trace.PORT, (unsigned char *)line, n);
+}
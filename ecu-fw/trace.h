@@ -0,0 +1,152 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 LandF Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* ________________________________________________________________________________________
+ *
+ * Binary event trace
+ *
+ * ----------------------------------------------------------------------------------------
+ * Development history
+ *
+ * 2026/10/19 Start coding
+ *
+ * ----------------------------------------------------------------------------------------
+ * L&F
+ * ________________________________________________________________________________________
+ */
+#ifndef __ECU_EVENT_TRACE__
+#define __ECU_EVENT_TRACE__
+
+/*
+ *    Trace overview
+ *
+ *    Call sites (main loop and interrupt handlers) record a fixed 16 byte event into a RAM
+ *    ring instead of formatting text. Nothing is printed at the call site.
+ *    trace_job() drains one event per main loop pass as text when the console has idle
+ *    transmission bandwidth, and the host can pull raw events with the binary command TRC.
+ *
+ *        +-------+-------+---------------+---------------+---------------+
+ *        |  EVT  |  SUB  |      TIM      |       A       |       B       |
+ *        +-------+-------+---------------+---------------+---------------+
+ *         2 byte  2 byte  4 byte(msec)    4 byte          4 byte
+ */
+
+//#define   TRACE_DISABLE                   // Compile out all TRACE() call sites 
+
+#define     TRACE_MAX       128             // Event ring size (power of 2) 
+#define     TRACE_MSK       (TRACE_MAX - 1)
+#define     TRACE_LINE      64              // Text drain line buffer 
+
+/* ----------------------------------------------------------------------------------------
+ * Event ID                                    A                   B
+ * ---------------------------------------------------------------------------------------- */
+#define     TRC_NONE        0
+#define     TRC_CONF_NEW    1               // List index          CAN-ID 
+#define     TRC_CONF_TOP    2               // List index          CAN-ID 
+#define     TRC_CONF_ADD    3               // List index          CAN-ID 
+#define     TRC_CONF_INS    4               // List index          CAN-ID 
+#define     TRC_WAIT_NEW    5               // Message ID.LONG     Wait index 
+#define     TRC_WAIT_TOP    6               // Message ID.LONG     Wait index << 16 | next 
+#define     TRC_WAIT_INS    7               // Message ID.LONG     Wait index << 16 | next 
+#define     TRC_WAIT_ADD    8               // Message ID.LONG     Wait index 
+#define     TRC_WAIT_CHAIN  9               // Message ID.LONG     Index << 16 | next (A=0:timer job) 
+#define     TRC_CAN_TXERR   10              // R_CAN_TxSet result  Channel << 8 | mailbox 
+#define     TRC_CAN_BOST    11              // Channel             0 
+#define     TRC_CAN_FIFO    12              // Channel             0:RX / 1:TX 
+#define     TRC_CAN3_RDBK   13              // TX buffer           0 
+#define     TRC_CAN3_TMO    14              // TX buffer           0 
+#define     TRC_CAN3_ERR    15              // EFLG                0 
+#define     TRC_CAN3_WAKE   16              // 0                   0 
+#define     TRC_CAN3_MERR   17              // 0                   0 
+#define     TRC_SPI_ERR     18              // Channel             SPSR 
+#define     TRC_SPI_IDLE    19              // Channel             0 
+#define     TRC_OPMODE      20              // New mode            Previous mode 
+#define     TRC_EVT_MAX     21
+
+/* ----------------------------------------------------------------------------------------
+ * Event record
+ * ---------------------------------------------------------------------------------------- */
+typedef struct __trace_event__ {
+    unsigned short  EVT;                    // Event ID 
+    unsigned short  SUB;                    // CMT0 count in the millisecond (6 count = 1usec) 
+    unsigned long   TIM;                    // Free run timer (msec) 
+    unsigned long   A;                      // Argument 1 
+    unsigned long   B;                      // Argument 2 
+} TRACE_EVENT;
+
+/* ----------------------------------------------------------------------------------------
+ * Event ring
+ * ---------------------------------------------------------------------------------------- */
+typedef struct __trace_str__ {
+    TRACE_EVENT     BUF[TRACE_MAX];         // Event ring 
+    unsigned int    WP;                     // Write counter (ring index = WP & TRACE_MSK) 
+    unsigned int    RP;                     // Read counter 
+    unsigned long   LOST;                   // Events dropped with the ring full 
+    int             PORT;                   // Text drain SCI channel (-1:host pull only) 
+} TRACE_STR;
+
+extern TRACE_STR    trace;
+
+#ifndef TRACE_DISABLE
+#define TRACE(e, a, b)  trace_put((e), (unsigned long)(a), (unsigned long)(b))
+#else
+#define TRACE(e, a, b)
+#endif
+
+/* ----------------------------------------------------------------------------------------
+ * trace_init
+ * 
+ * Outline
+ *     Clear the ring and stop the text drain
+ * ---------------------------------------------------------------------------------------- */
+extern void trace_init(void);
+
+/* ----------------------------------------------------------------------------------------
+ * trace_put
+ * 
+ * Outline
+ *     Record one event (callable from interrupt handlers)
+ * ---------------------------------------------------------------------------------------- */
+extern void trace_put(int evt, unsigned long a, unsigned long b);
+
+/* ----------------------------------------------------------------------------------------
+ * trace_get
+ * 
+ * Outline
+ *     Take the oldest event (main loop only)
+ *
+ * Return
+ *     1:event copied  0:ring empty
+ * ---------------------------------------------------------------------------------------- */
+extern int trace_get(TRACE_EVENT *ev);
+
+/* ----------------------------------------------------------------------------------------
+ * trace_job
+ * 
+ * Outline
+ *     Text drain of one event to the console when the transmission buffer is idle
+ * ---------------------------------------------------------------------------------------- */
+extern void trace_job(void);
+
+#endif //__ECU_EVENT_TRACE__
@@ -43,6 +43,7 @@
 #include "iodefine.h"
 #include "timer.h"
 #include "ecu.h"            // ECU common definition 
+#include "ecu_io.h"         // ECU I/O port definition 
 #include "can3_spi2.h"      // CAN3 definition 
 #include "cantp.h"          // CAN-TP definition 
 #include "uds.h"            // CAN-UDS definition 
@@ -51,6 +52,8 @@
 #include "mcu_info.h"
 #include "r_flash_API_RX600.h"
 #include "r_flash_api_rx600_private.h"
+#include "flash_data.h"
+#include "obd2.h"           // OBD2 / DTC definition 
 
 /*
  *  Overview of UDS (Unified Diagnostics Service) processing
@@ -88,9 +91,9 @@
  * +                   +-------+-------+-----------------------------------------------+-------+
  * |                   |    24 |    64 |    Read Scaling Data By Identifier            |   X   |
  * +                   +-------+-------+-----------------------------------------------+-------+
- * |                   |    2A |    6A |    Read Data By Identifire Periodic           |   X   |
+ * |                   |    2A |    6A |    Read Data By Identifire Periodic           |   O   |
  * +                   +-------+-------+-----------------------------------------------+-------+
- * |                   |    2C |    6C |    Dynamically Define Data Identifire         |   X   |
+ * |                   |    2C |    6C |    Dynamically Define Data Identifire         |   O   |
  * +                   +-------+-------+-----------------------------------------------+-------+
  * |                   |    2E |    6E |    Write Data By Identifire                   |   O   |
  * +                   +-------+-------+-----------------------------------------------+-------+
@@ -129,12 +132,33 @@ int uds_security_access     = 0; // Security access
 
 UDS_LOAD_STR uds_load;           // Download / upload management 
 
+UDS_PROG_BUF uds_prog[UDS_PROG_BUFS]; // Flash programming staging buffers 
+int          uds_prog_rp    = 0;      // Staging buffer programming position 
+int          uds_prog_wp    = 0;      // Staging buffer storage position 
+int          uds_prog_err   = 0;      // Programming failure latch 
+
+UDS_PEND_STR uds_pend;           // Response pending request 
+UDS_CRC_STR  uds_crc;            // Memory CRC32 routine 
+
+UDS_ERASE_STR uds_erase;         // Download area erase 
+
+UDS_LZSS_STR uds_lzss;           // Download decompression 
+
+UDS_DDDID_STR uds_dddid[UDS_DDDID_MAX]; // Dynamically defined DIDs 
+
+unsigned char uds_f1_resp[UDS_F1_PREP][UDS_F1_RSIZE]; // Prepared 0x22 F1xx responses 
+
+int uds_cfg_trans = 0;           // Configuration transaction 
+int uds_cfg_dirty = 0;           // Configuration changed area 
+int uds_cfg_reload = 0;          // Deferred configuration reload 
+
 /*
  *  Repro regulations
  *
  *  ROM area setting
  *  E2DataFlash
- *  0x00100000 to 0x00107FFF  8K*4  Parameter      <--- 0x00100000 to 0x00107FFF Download permission  / Erase size 0x00002000
+ *  0x00100000 to 0x001067FF  2K*13 Parameter      <--- 0x00100000 to 0x001067FF Download prohibition / Erase size 0x00000800
+ *  0x00106800 to 0x00107FFF  2K*3  Free           <--- 0x00106800 to 0x00107FFF Download permission  / Erase size 0x00000800
  *  Program Block
  *  0xFFE00000 to 0xFFEFFFFF 64K*16 Data Area      <--- 0xFFE00000 to 0xFFEFFFFF Download permission  / Erase size 0x00010000
  *  0xFFF00000 to 0xFFF3FFFF 32K*8  Download F/W   <--- 0xFFF00000 to 0xFFF3FFFF Download permission  / Erase size 0x00008000
@@ -149,6 +173,244 @@ UDS_LOAD_STR uds_load;           // Download / upload management
 void can_uds_init(void)
 {
     memset(&uds_load, 0, sizeof(UDS_LOAD_STR));
+    memset(&uds_prog, 0, sizeof(uds_prog));
+    memset(&uds_pend, 0, sizeof(UDS_PEND_STR));
+    memset(&uds_crc, 0, sizeof(UDS_CRC_STR));
+    memset(&uds_erase, 0, sizeof(UDS_ERASE_STR));
+    memset(&uds_lzss, 0, sizeof(UDS_LZSS_STR));
+    memset(&uds_dddid, 0, sizeof(uds_dddid));
+    uds_prog_rp     = 0;
+    uds_prog_wp     = 0;
+    uds_prog_err    = 0;
+    uds_f1_prepare();
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Prepared ECU information response generation (0x22 F100 to F104)
+ * ---------------------------------------------------------------------------------------- */
+void uds_f1_prepare(void)
+{
+    int             i, n;
+    unsigned long   d;
+
+    for (i = 0; i < UDS_F1_PREP; i++) {
+        uds_f1_resp[i][0] = 0x22 | UDS_RES_SID;
+        uds_f1_resp[i][1] = 0xF1;
+        uds_f1_resp[i][2] = (unsigned char)i;
+        n = uds_did_source(0xF100 + i, &d);
+        memcpy(&uds_f1_resp[i][3], (void *)d, (n > 16) ? 16 : n);
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer stacking (0x36 double buffer)
+ * ---------------------------------------------------------------------------------------- */
+int uds_prog_stack(unsigned long adr, unsigned char *dp, int sz)
+{
+    int             i;
+    UDS_PROG_BUF *  pb = &uds_prog[uds_prog_wp];
+
+    if (pb->STAT != UDS_PB_FREE) { // All buffers are waiting for the FCU 
+        return -1;
+    }
+    memcpy(pb->BUF, dp, sz);
+    if (adr >= 0xFFE00000ul) { // Program Flash ROM 
+        for (i = sz; i < ROM_PROGRAM_SIZE; i++) { // Fill in the program unit shortfall with FF 
+            pb->BUF[i] = 0xFF;
+        }
+        for (i = 0; i < ROM_PROGRAM_SIZE && pb->BUF[i] == 0xFF; i++) {
+            ;
+        }
+        if (i >= ROM_PROGRAM_SIZE) { // Erased state as it is, no need to program 
+            return sz;
+        }
+        i = ROM_PROGRAM_SIZE;
+    } else { // E2Data 
+        for (i = sz; (i & (DF_PROGRAM_SIZE_SMALL - 1)) != 0; i++) { // Fill with 00 if the minimum write byte has not been reached 
+            pb->BUF[i] = 0;
+        }
+    }
+    pb->ADDR    = adr;
+    pb->SIZE    = i;
+    pb->STAT    = UDS_PB_QUEUED;
+    uds_prog_wp = (uds_prog_wp + 1) % UDS_PROG_BUFS;
+    return sz;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer busy check
+ * ---------------------------------------------------------------------------------------- */
+int uds_prog_busy(void)
+{
+    int i;
+
+    for (i = 0; i < UDS_PROG_BUFS; i++) {
+        if (uds_prog[i].STAT != UDS_PB_FREE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer processing (call from uds_pending_job)
+ * ---------------------------------------------------------------------------------------- */
+void uds_prog_job(void)
+{
+    int             f;
+    UDS_PROG_BUF *  pb = &uds_prog[uds_prog_rp];
+
+    switch (pb->STAT) {
+    case UDS_PB_QUEUED: // Start programming 
+        if (R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy 
+            return;
+        }
+        if (pb->ADDR >= 0xFFE00000ul) { // Program Flash ROM (Blocking, ROM can not be read during P/E) 
+            _di();
+            f = R_FlashWrite(pb->ADDR, (int)pb->BUF, pb->SIZE);
+            _ei();
+        } else { // E2Data (BGO, completed by FRDYI) 
+            f = WriteBgo_FlashData(pb->ADDR, (uint32_t)pb->BUF, (uint16_t)pb->SIZE, &pb->RES);
+            if (f == FLASH_SUCCESS) {
+                pb->STAT = UDS_PB_BUSY;
+                return;
+            }
+        }
+        break;
+    case UDS_PB_BUSY:   // Waiting for completion 
+        if (pb->RES == FLASH_BUSY || R_FlashGetStatus() != FLASH_SUCCESS) {
+            return;
+        }
+        f = pb->RES;
+        break;
+    default:
+        return;
+    }
+    if (f != FLASH_SUCCESS) { // Write failed 
+        uds_prog_err = 1;
+        dtc_report(DTC_CODE_FLASH_PROG, 1);
+    }
+    pb->STAT    = UDS_PB_FREE;
+    uds_prog_rp = (uds_prog_rp + 1) % UDS_PROG_BUFS;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Download area erase processing (call from uds_pending_job)
+ * ---------------------------------------------------------------------------------------- */
+void uds_erase_job(void)
+{
+    int i, f;
+
+    if (uds_erase.STEP == 0 && (uds_load.MODE != UDS_TD_ERASE || uds_erase.CNT <= 0)) { // No erase request (a started block is finished first) 
+        return;
+    }
+    if (uds_erase.BLK < BLOCK_DB0) { // Program Flash ROM (Suspended steps, ROM can not be read during P/E) 
+        if (uds_erase.STEP == 0 && R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy (BGO) 
+            return;
+        }
+        for (f = FLASH_BUSY, i = 0; i < UDS_ERASE_STEPS && f == FLASH_BUSY; i++) {
+            _di();
+            f = R_FlashEraseSlice((uint8_t)uds_erase.BLK, UDS_ERASE_SLICE);
+            _ei(); // Pending CAN / SCI interrupts are served between the steps 
+        }
+        if (f == FLASH_BUSY) { // Erase suspended 
+            uds_erase.STEP = 1;
+            return;
+        }
+        uds_erase.STEP = 0;
+        if (f != FLASH_SUCCESS) { // Erase failed 
+            uds_erase.ERR = 1;
+            uds_erase.CNT = 0;
+            return;
+        }
+        uds_erase.BLK--;
+        uds_erase.CNT--;
+        return;
+    }
+    if (R_FlashGetStatus() != FLASH_SUCCESS) { // FCU busy (BGO) 
+        return;
+    }
+    // E2Data (BGO, completed by FRDYI) 
+    if (uds_erase.STEP == 0) { // Blank check 
+        f = BlankCheck_FlashData(g_flash_BlockAddresses[uds_erase.BLK]);
+        if (f == FLASH_NOT_BLANK) { // Start erase 
+            if (EraseBgo_FlashData((uint8_t)uds_erase.BLK, &uds_erase.RES) != FLASH_SUCCESS) {
+                uds_erase.ERR = 1;
+                uds_erase.CNT = 0;
+                return;
+            }
+            uds_erase.STEP = 1;
+            return;
+        }
+    } else if (uds_erase.RES == FLASH_BUSY) { // Erase running 
+        return;
+    } else { // Erase completed 
+        f = (uds_erase.RES == FLASH_SUCCESS) ? BlankCheck_FlashData(g_flash_BlockAddresses[uds_erase.BLK]) : FLASH_FAILURE;
+    }
+    if (f != FLASH_BLANK) { // Erase failed 
+        uds_erase.ERR = 1;
+        uds_erase.CNT = 0;
+        return;
+    }
+    uds_erase.STEP = 0;
+    uds_erase.BLK++;
+    uds_erase.CNT--;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Compressed download decompression output (1 byte)
+ * ---------------------------------------------------------------------------------------- */
+void uds_lzss_put(int c)
+{
+    uds_lzss.WIN[uds_lzss.WP]       = (unsigned char)c;
+    uds_lzss.WP                     = (uds_lzss.WP + 1) & (UDS_LZ_WINDOW - 1);
+    uds_lzss.OBUF[uds_lzss.OCNT++]  = (unsigned char)c;
+    uds_load.CNT++;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Compressed download decompression (0x36 block, returns -1 when the staging buffer is full)
+ * ---------------------------------------------------------------------------------------- */
+int uds_lzss_job(unsigned char *dp, int sz)
+{
+    int c;
+
+    for (;;) {
+        if (uds_lzss.OCNT >= UDS_LZ_UNIT || (uds_lzss.OCNT > 0 && uds_load.CNT >= uds_load.SIZE)) { // Programming unit assembled 
+            if (uds_prog_stack(uds_load.ADDR, uds_lzss.OBUF, uds_lzss.OCNT) < 0) { // Both buffers are waiting for the FCU 
+                return -1;  // Continue from IPOS at the next call 
+            }
+            uds_load.ADDR   += uds_lzss.OCNT;
+            uds_lzss.OCNT   = 0;
+        }
+        if (uds_load.CNT >= uds_load.SIZE) { // Decompression completed (ignore the rest) 
+            break;
+        }
+        if (uds_lzss.LEN > 0) { // Copy match from the window 
+            uds_lzss.LEN--;
+            uds_lzss_put(uds_lzss.WIN[(uds_lzss.WP - uds_lzss.DIST) & (UDS_LZ_WINDOW - 1)]);
+            continue;
+        }
+        if (uds_lzss.IPOS >= sz) { // Block consumed 
+            break;
+        }
+        c = (int)dp[uds_lzss.IPOS++] & 0xFF;
+        if (uds_lzss.STEP != 0) { // Match length 
+            uds_lzss.LEN    = c + UDS_LZ_MIN_MATCH;
+            uds_lzss.STEP   = 0;
+        } else if (uds_lzss.FLAG <= 1) { // Flag byte 
+            uds_lzss.FLAG   = c | 0x100;
+        } else if (uds_lzss.FLAG & 1) { // Literal 
+            uds_lzss.FLAG >>= 1;
+            uds_lzss_put(c);
+        } else { // Match distance 
+            uds_lzss.FLAG >>= 1;
+            uds_lzss.DIST   = c + 1;
+            uds_lzss.STEP   = 1;
+        }
+    }
+    uds_lzss.IPOS = 0;
+    return 0;
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -156,9 +418,18 @@ void can_uds_init(void)
  * ---------------------------------------------------------------------------------------- */
 void uds_timeup(void)
 {
+    UDS_ERASE_STR   e;
+
     uds_diag_session    = 0; // Session control 
     uds_security_access = 0; // Security access 
-    can_uds_init();
+    if (uds_cfg_trans != 0) { // Discard the unfinished transaction 
+        uds_cfg_abort();
+    }
+    memcpy(&e, &uds_erase, sizeof(UDS_ERASE_STR));
+    can_uds_init(); // Dynamic DIDs and periodic transmission are cleared with the session 
+    if (e.STEP != 0) { // A suspended ROM erase holds the FCU, uds_erase_job finishes the block 
+        memcpy(&uds_erase, &e, sizeof(UDS_ERASE_STR));
+    }
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -170,6 +441,7 @@ int uds_sid_10(unsigned char *req, int sz, unsigned char *res, int *len)
     switch (req[1] & 0x3F) {
     case 1: // Default session 
         uds_diag_session = 1;
+        memset(&uds_dddid, 0, sizeof(uds_dddid)); // Clear dynamic DIDs and stop periodic transmission 
         break;
     case 2: // ECU programming session 
         uds_diag_session = 2;
@@ -242,8 +514,10 @@ int uds_sid_27(unsigned char *req, int sz, unsigned char *res, int *len)
         ) { // 0x17C0 Release 
             uds_security_access = 1; // Unlocked 
             *len = 2;
+            dtc_report(DTC_CODE_SEC_ACCESS, 0);
         } else { // Key mismatch 
             uds_security_access = 0; // Locked 
+            dtc_report(DTC_CODE_SEC_ACCESS, 1);
             return UDS_EC_IK;
         }
         break;
@@ -298,6 +572,279 @@ int uds_sid_27(unsigned char *req, int sz, unsigned char *res, int *len)
     return UDS_EC_NONE;
 }
 
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x19 Read DTC Information
+ *  01 : reportNumberOfDTCByStatusMask          [19 01 Mask]
+ *  02 : reportDTCByStatusMask                  [19 02 Mask]
+ *  04 : reportDTCSnapshotRecordByDTCNumber     [19 04 DTC(3) RecNo]
+ *  06 : reportDTCExtDataRecordByDTCNumber      [19 06 DTC(3) RecNo]
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_19(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int             i, n;
+    unsigned long   code;
+    DTC_ENTRY *     e;
+
+    if (sz < 2) {
+        return UDS_EC_IML_IF;
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    res[1] = req[1];
+    switch (req[1]) {
+    case 0x01: // Number of DTC 
+    case 0x02: // DTC list 
+        if (sz != 3) {
+            return UDS_EC_IML_IF;
+        }
+        res[2] = DTC_ST_AVAIL;
+        n      = (req[1] == 0x01) ? 6 : 3;
+        for (i = 0; i < DTC_MAX; i++) {
+            e = &dtc_tbl[i];
+            if (e->CODE == 0 || (e->STAT & req[2] & DTC_ST_AVAIL) == 0) {
+                continue;
+            }
+            if (req[1] == 0x01) {
+                n++;
+            } else {
+                res[n]     = (unsigned char)(e->CODE >> 16);
+                res[n + 1] = (unsigned char)(e->CODE >> 8);
+                res[n + 2] = (unsigned char)e->CODE;
+                res[n + 3] = e->STAT;
+                n += 4;
+            }
+        }
+        if (req[1] == 0x01) {
+            res[3] = 0x00; // DTC format ISO 15031-6 
+            res[4] = (unsigned char)((n - 6) >> 8);
+            res[5] = (unsigned char)(n - 6);
+            n      = 6;
+        }
+        *len = n;
+        break;
+    case 0x04: // Snapshot record 
+    case 0x06: // Extended data record 
+        if (sz != 6) {
+            return UDS_EC_IML_IF;
+        }
+        code = ((unsigned long)req[2] << 16) | ((unsigned long)req[3] << 8) | (unsigned long)req[4];
+        e    = dtc_entry(code, 0);
+        if (e == 0 || (req[5] != 0x01 && req[5] != 0xFF)) { // Unknown DTC / record 
+            return UDS_EC_ROOR;
+        }
+        memcpy(&res[2], &req[2], 3);
+        res[5] = e->STAT;
+        n      = 6;
+        if (req[1] == 0x04) {
+            res[6] = 0x01; // Record number 
+            i      = dtc_snapshot(code, &res[7]);
+            if (i > 0) {
+                n += 1 + i;
+            }
+        } else {
+            res[6] = 0x01;   // Record number 
+            res[7] = e->OCC; // Occurrence counter 
+            n     += 2;
+        }
+        *len = n;
+        break;
+    default:
+        return UDS_EC_SFNS;
+    }
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x14 Clear Diagnostic Information [14 GroupOfDTC(3)]
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_14(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    unsigned long   code;
+
+    if (sz != 4) {
+        return UDS_EC_IML_IF;
+    }
+    code = ((unsigned long)req[1] << 16) | ((unsigned long)req[2] << 8) | (unsigned long)req[3];
+    if (dtc_clear(code) < 0) { // Unknown DTC 
+        return UDS_EC_ROOR;
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    *len   = 1;
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * CRC32 table (IEEE 802.3 reflected polynomial 0xEDB88320)
+ * ---------------------------------------------------------------------------------------- */
+const unsigned long uds_crc32_table[256] = {
+    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+    0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+    0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+    0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+    0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+    0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+    0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+    0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+    0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+    0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+    0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+    0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+    0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+    0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+    0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+    0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+    0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+    0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+    0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+    0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+    0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+    0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+
+/* ----------------------------------------------------------------------------------------
+ * CRC32 (IEEE 802.3) update, crc starts from 0xFFFFFFFF and is inverted at the end
+ * ---------------------------------------------------------------------------------------- */
+unsigned long uds_crc32(unsigned long crc, const unsigned char *dp, unsigned long sz)
+{
+    while (sz-- > 0) {
+        crc = uds_crc32_table[(crc ^ *dp++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Memory range check (UDS_EC_NONE=Readable / UDS_EC_ROOR=Out of map or busy data flash)
+ *  The range must lie inside one of RAM / E2DataFlash / ROM. E2DataFlash can not be read
+ *  while the FCU is in P/E mode, so it is refused while any flash operation is running.
+ * ---------------------------------------------------------------------------------------- */
+int uds_mem_check(unsigned long adr, unsigned long sz)
+{
+    unsigned long   e = adr + sz - 1; // Last address 
+
+    if (sz == 0 || e < adr) { // Empty or wrapped range 
+        return UDS_EC_ROOR;
+    }
+    if (adr >= UDS_RAM_TOP && e < UDS_RAM_END) { // RAM 
+        return UDS_EC_NONE;
+    }
+    if (adr >= UDS_ROM_TOP) { // ROM 
+        return UDS_EC_NONE;
+    }
+    if (adr >= UDS_DF_TOP && e < UDS_DF_END) { // E2DataFlash 
+        if (R_FlashGetStatus() != FLASH_SUCCESS || ecu_fjob.STAT != ECU_FS_IDLE || uds_erase.STEP != 0) { // Being written 
+            return UDS_EC_ROOR;
+        }
+        return UDS_EC_NONE;
+    }
+    return UDS_EC_ROOR;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x31 Routine Control
+ *  RID 0x0202 : Memory CRC32
+ *      Start   [31 01 02 02 ALFID Address Size]  -> [71 01 02 02 CRC32(4)]
+ *      Result  [31 03 02 02]                     -> [71 03 02 02 Status CRC32(4)]
+ *      Ranges larger than UDS_CRC_SLICE are calculated one slice per main loop pass
+ *      (response pending from uds_pending_job), so CAN forwarding continues.
+ *      Extended / programming session and security unlock only. The range must pass
+ *      uds_mem_check, a slice that meets busy data flash waits for the next pass.
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_31(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int             i, an, ln;
+    unsigned long   adr, z;
+
+    if (uds_diag_session < 2) {    // Session low 
+        return UDS_EC_GR;          // General rejection 
+    }
+    if (uds_security_access < 1) { // Unauthorized 
+        return UDS_EC_SAD;         // Security denied 
+    }
+    if (sz < 4) {
+        return UDS_EC_IML_IF;
+    }
+    if ((((int)req[2] << 8) | (int)req[3]) != UDS_RID_CRC32) { // Unknown routine 
+        return UDS_EC_ROOR;
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    res[1] = req[1];
+    res[2] = req[2];
+    res[3] = req[3];
+    switch (req[1]) {
+    case 0x01: // Start routine 
+        if (uds_pend.SID == 0 || uds_crc.STAT != UDS_CRC_RUN) { // New request 
+            if (sz < 5) {
+                return UDS_EC_IML_IF;
+            }
+            an = req[4] & 0x0F;         // Address length 
+            ln = (req[4] >> 4) & 0x0F;  // Size length 
+            if (an == 0 || an > 4 || ln == 0 || ln > 4) { // Format error 
+                return UDS_EC_ROOR;
+            }
+            if (sz != 5 + an + ln) { // Length error 
+                return UDS_EC_IML_IF;
+            }
+            for (adr = 0, i = 5; i < 5 + an; i++) {
+                adr = (adr << 8) | (unsigned long)req[i];
+            }
+            for (z = 0; i < 5 + an + ln; i++) {
+                z = (z << 8) | (unsigned long)req[i];
+            }
+            if (uds_mem_check(adr, z) != UDS_EC_NONE) { // Outside the memory map or busy data flash 
+                return UDS_EC_ROOR;
+            }
+            if (uds_prog_busy() || uds_load.MODE == UDS_TD_ERASE) { // Flash being rewritten 
+                return UDS_EC_CNC;
+            }
+            uds_crc.STAT = UDS_CRC_RUN;
+            uds_crc.ADR  = adr;
+            uds_crc.REM  = z;
+            uds_crc.VAL  = 0xFFFFFFFFul;
+        }
+        z            = (uds_crc.REM < UDS_CRC_SLICE) ? uds_crc.REM : UDS_CRC_SLICE;
+        if (uds_mem_check(uds_crc.ADR, z) != UDS_EC_NONE) { // Data flash job started meanwhile, retry at the next pass 
+            return UDS_EC_RCR;
+        }
+        uds_crc.VAL  = uds_crc32(uds_crc.VAL, (const unsigned char *)uds_crc.ADR, z);
+        uds_crc.ADR += z;
+        uds_crc.REM -= z;
+        if (uds_crc.REM > 0) { // Continued in uds_pending_job 
+            return UDS_EC_RCR;
+        }
+        uds_crc.VAL ^= 0xFFFFFFFFul;
+        uds_crc.STAT = UDS_CRC_DONE;
+        i = 4;
+        break;
+    case 0x03: // Request routine results 
+        if (sz != 4) {
+            return UDS_EC_IML_IF;
+        }
+        if (uds_crc.STAT != UDS_CRC_DONE) { // Not started or not finished 
+            return UDS_EC_RSE;
+        }
+        res[4] = 0x00; // Completed 
+        i = 5;
+        break;
+    default:
+        return UDS_EC_SFNS;
+    }
+    res[i]     = (unsigned char)(uds_crc.VAL >> 24);
+    res[i + 1] = (unsigned char)(uds_crc.VAL >> 16);
+    res[i + 2] = (unsigned char)(uds_crc.VAL >> 8);
+    res[i + 3] = (unsigned char)uds_crc.VAL;
+    *len = i + 4;
+    return UDS_EC_NONE;
+}
+
 /* ----------------------------------------------------------------------------------------
  * UDS 0x3E Tester Present
  * ---------------------------------------------------------------------------------------- */
@@ -310,55 +857,60 @@ int uds_sid_3e(unsigned char *req, int sz, unsigned char *res, int *len)
 }
 
 /* ----------------------------------------------------------------------------------------
- * UDS 0x22 Read Data By Identifier
+ * DID data acquisition (returns UDS error code)
  * ---------------------------------------------------------------------------------------- */
 extern const char def_ecu_corp[]; // 16] = "PASTA"; 
 extern const char def_ecu_name[]; // 16] = "CAN2ECU"; 
 extern const char def_ecu_vars[]; // 16] = "Ver?.?.?"; 
 extern const char def_ecu_date[]; // 16] = __DATE__; 
 extern const char def_ecu_time[]; // 16] = __TIME__; 
-int uds_sid_22(unsigned char *req, int sz, unsigned char *res, int *len)
+int uds_did_read(unsigned char *req, int rsz, unsigned char *res, int *len, int max)
 {
-    int             i, k, b;
+    int             i, k, n, b;
     unsigned long   d;
+    unsigned char * p;
+    unsigned char   tmp[8];
 
-    res[0] = req[0] | UDS_RES_SID;
-    res[1] = req[1]; // CID 
-    res[2] = req[2]; // CID 
-    i = 3;
-    switch (req[1]) {
+    if (rsz < 2) { // No DID 
+        return UDS_EC_IML_IF;
+    }
+    i = 2; // DID echo size, written with the data after the size check 
+    switch (req[0]) {
     default:
-        return UDS_EC_SFNS;
+        return UDS_EC_ROOR;
+    case 0xC0: case 0xC1: case 0xC2: case 0xC3: // CAN data buffer 
+    case 0xC4: case 0xC5: case 0xC6: case 0xC7:
+    case 0xD0: // External I/O status 
+        n = uds_did_source(((int)req[0] << 8) | ((int)req[1] & 0xFF), &d);
+        if (n < 0) {
+            return UDS_EC_ROOR;
+        }
+        p = (unsigned char *)d;
+        break;
     case 0xF1:  // ECU information 
-        switch (req[2]) {
-        default:
-            return UDS_EC_SNS;
-        case 0x00:  // Manufacturer's name 
-            memcpy(&res[3], &def_ecu_corp[0], 16);
-            i += 16;
-            break;
-        case 0x01:  // Vehicle code 
-            memcpy(&res[3], &def_ecu_name[0], 16);
-            i += 16;
-            break;
-        case 0x02:  // ECU version 
-            memcpy(&res[3], &def_ecu_vars[0], 16);
-            i += 16;
-            break;
-        case 0x03:  // F/W date 
-            memcpy(&res[3], &def_ecu_date[0], 16);
-            i += 16;
-            break;
-        case 0x04:  // F/W time 
-            memcpy(&res[3], &def_ecu_time[0], 16);
-            i += 16;
-            break;
+        n = uds_did_source(((int)req[0] << 8) | ((int)req[1] & 0xFF), &d);
+        if (n < 0) {
+            return UDS_EC_ROOR;
         }
+        p = (unsigned char *)d;
         break;
     case 0xF2: // Memory map information 
-        switch (req[2]) {
+        k = (((int)req[0] << 8) | ((int)req[1] & 0xFF)) - UDS_DDDID_TOP;
+        if (k >= 0 && k < UDS_DDDID_MAX) { // Dynamically defined DID 
+            if (uds_dddid[k].CNT == 0) {
+                return UDS_EC_ROOR;
+            }
+            if (i + uds_dddid[k].SIZE > max) {
+                return UDS_EC_RTL;
+            }
+            res[0] = req[0]; // DID 
+            res[1] = req[1]; // DID 
+            *len = i + uds_dddid_read(&uds_dddid[k], &res[i]);
+            return UDS_EC_NONE;
+        }
+        switch (req[1]) {
         default:
-            return UDS_EC_SNS;
+            return UDS_EC_ROOR;
         case 0x00: // Routing map address 
             d = (unsigned long)&rout_map;
             b = 1;
@@ -376,84 +928,520 @@ int uds_sid_22(unsigned char *req, int sz, unsigned char *res, int *len)
             b   = 1;
             break;
         }
-        res[3] = (d >> 16);  // Address H 
-        res[4] = (d >> 8);   // Address M 
-        res[5] = (d & 0xFF); // Address L 
-        res[6] = (b & 0xFF); // Address size (byte) 
-        i      += 4;
-        break;
-    case 0xF3: // Parameter access 
-        k = ((int)req[3] << 8) | ((int)req[4] & 0xFF);
-        res[3] = req[3];
-        res[4] = req[4];
-        i += 2;
-        switch (req[2]) {
-        default:
-            return UDS_EC_SNS;
-        case 0x00: // Routing map 
-            if (k >= CAN_ID_MAX) {
+        tmp[0] = (d >> 16);  // Address H 
+        tmp[1] = (d >> 8);   // Address M 
+        tmp[2] = (d & 0xFF); // Address L 
+        tmp[3] = (b & 0xFF); // Address size (byte) 
+        p = tmp;
+        n = 4;
+        break;
+    case 0xF3: // Parameter access [DID][Index] 
+        if (rsz < 4) {
+            return UDS_EC_IML_IF;
+        }
+        k = ((int)req[2] << 8) | ((int)req[3] & 0xFF);
+        i += 2; // Index echo 
+        switch (req[1]) {
+        default:
+            return UDS_EC_ROOR;
+        case 0x00: // Routing map 
+            if (k >= CAN_ID_MAX) {
+                return UDS_EC_ROOR;
+            }
+            p = &rout_map.ID[k].BYTE;
+            n = 1;
+            break;
+        case 0x01: // Period / event / remote management definition variables 
+            if (k >= MESSAGE_MAX) {
+                return UDS_EC_ROOR;
+            }
+            p = (unsigned char *)&conf_ecu.LIST[k];
+            n = sizeof(ECU_CYC_EVE);
+            break;
+        case 0x02:  // ECU input / output checklist 
+            if (k >= ECU_EXT_MAX) {
+                return UDS_EC_ROOR;
+            }
+            p = (unsigned char *)&ext_list[k];
+            n = sizeof(EXTERNUL_IO);
+            break;
+        case 0x03:  // CAN-ID -> EX-I/O-ID Conversion table 
+            if (k >= CAN_ID_MAX) {
+                return UDS_EC_ROOR;
+            }
+            p = &can_to_exio[k];
+            n = 1;
+            break;
+        }
+        break;
+    case 0xFD: // Parameter range access [DID][First index][Count] 
+        if (rsz < 6) {
+            return UDS_EC_IML_IF;
+        }
+        k = ((int)req[2] << 8) | ((int)req[3] & 0xFF);
+        n = ((int)req[4] << 8) | ((int)req[5] & 0xFF);
+        i += 4; // Range echo 
+        switch (req[1]) {
+        default:
+            return UDS_EC_ROOR;
+        case 0x00: // Routing map 
+            b = CAN_ID_MAX;
+            p = &rout_map.ID[0].BYTE;
+            d = 1;
+            break;
+        case 0x01: // Period / event / remote management definition variables 
+            b = MESSAGE_MAX;
+            p = (unsigned char *)&conf_ecu.LIST[0];
+            d = sizeof(ECU_CYC_EVE);
+            break;
+        case 0x02:  // ECU input / output checklist 
+            b = ECU_EXT_MAX;
+            p = (unsigned char *)&ext_list[0];
+            d = sizeof(EXTERNUL_IO);
+            break;
+        case 0x03:  // CAN-ID -> EX-I/O-ID Conversion table 
+            b = CAN_ID_MAX;
+            p = &can_to_exio[0];
+            d = 1;
+            break;
+        }
+        if (n == 0 || k >= b || n > (b - k)) { // Range error 
+            return UDS_EC_ROOR;
+        }
+        p += k * d;
+        n *= d;
+        break;
+    case 0xF5:  // Data flash operation 
+        switch (req[1]) {
+        default:
+            return UDS_EC_ROOR;
+        case 0x00:  // Check writing status 
+            if (uds_erase.STEP != 0) { // Download area erase holds the FCU 
+                return UDS_EC_BRR;
+            }
+            k = ecu_data_check();
+            tmp[0] = (unsigned char)(k >> 8);
+            tmp[1] = (unsigned char)(k & 0xFF);
+            p = tmp;
+            n = 2;
+            break;
+        case 0x01:  // Data flash job status 
+            tmp[0] = (unsigned char)ecu_fjob.STAT;
+            tmp[1] = (unsigned char)ecu_fjob.LAST.CMD;
+            tmp[2] = (unsigned char)(ecu_fjob.LRES >> 8);
+            tmp[3] = (unsigned char)(ecu_fjob.LRES & 0xFF);
+            tmp[4] = (unsigned char)(ecu_fjob.SEQ >> 8);
+            tmp[5] = (unsigned char)(ecu_fjob.SEQ & 0xFF);
+            tmp[6] = (unsigned char)ecu_fjob.CNT;
+            p = tmp;
+            n = 7;
+            break;
+        }
+        break;
+    }
+    if (i + n > max) { // Response buffer over 
+        return UDS_EC_RTL;
+    }
+    memcpy(res, req, i); // DID [Index / Range] 
+    memcpy(&res[i], p, n);
+    *len = i + n;
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x22 Read Data By Identifier
+ *  [0x22][DID][DID]...  Several DIDs in one request, responses are concatenated in order
+ *  0xF3xx takes a 2 byte index, 0xFDxx takes a 2 byte first index and 2 byte count
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_22(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int i, r, n, k, f, ercd;
+
+    if (sz < 3) {
+        return UDS_EC_IML_IF;
+    }
+    if (sz == 3 && req[1] == 0xF1 && req[2] < UDS_F1_PREP) { // Single ECU information DID : prepared response 
+        can_tp_handoff(uds_f1_resp[req[2]]);
+        *len = UDS_F1_RSIZE;
+        return UDS_EC_NONE;
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    for (i = 1, r = 1, f = 0; r < sz; r += n) {
+        n    = (req[r] == 0xF3) ? 4 : (req[r] == 0xFD) ? 6 : 2; // Request size of the DID 
+        ercd = uds_did_read(&req[r], sz - r, &res[i], &k, UDS_READ_MAX + 1 - i);
+        if (ercd == UDS_EC_ROOR) { // Unsupported DID is skipped 
+            continue;
+        }
+        if (ercd != UDS_EC_NONE) {
+            return ercd;
+        }
+        i += k;
+        f++;
+    }
+    if (f == 0) { // No supported DID 
+        return UDS_EC_ROOR;
+    }
+    *len = i;
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x23 Read Memory By Address
+ *  [0x23][ALFID][Address 1-4 byte][Size 1-4 byte]  ALFID = (Size length << 4) | Address length
+ *  Up to UDS_READ_MAX bytes in one multi-frame response
+ *  (500kbps 7 byte / consecutive frame, BS=0 STmin=0 : about 4KB in 0.2s, 20KB/s)
+ *  Security unlock only, the range must pass uds_mem_check
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_23(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int             i, an, ln;
+    unsigned long   adr;
+    unsigned long   z;
+
+    if (uds_security_access < 1) { // Unauthorized 
+        return UDS_EC_SAD;         // Security denied 
+    }
+    an = req[1] & 0x0F;         // Address length 
+    ln = (req[1] >> 4) & 0x0F;  // Size length 
+    if (an == 0 || an > 4 || ln == 0 || ln > 4) { // Format error 
+        return UDS_EC_ROOR;
+    }
+    if (sz != 2 + an + ln) { // Length error 
+        return UDS_EC_IML_IF;
+    }
+    for (adr = 0, i = 2; i < 2 + an; i++) {
+        adr <<= 8;
+        adr |= (unsigned long)req[i] & 0xFF;
+    }
+    for (z = 0; i < 2 + an + ln; i++) {
+        z <<= 8;
+        z |= (unsigned long)req[i] & 0xFF;
+    }
+    if (z == 0 || z > UDS_READ_MAX) { // Batch read over 
+        return UDS_EC_ROOR;
+    }
+    if (uds_mem_check(adr, z) != UDS_EC_NONE) { // Outside the memory map or busy data flash 
+        return UDS_EC_ROOR;
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    memcpy(&res[1], (unsigned char *)adr, (int)z);
+    *len = (int)z + 1;
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Source DID address acquisition (returns data size, -1=Not applicable)
+ * ---------------------------------------------------------------------------------------- */
+int uds_did_source(int did, unsigned long *adr)
+{
+    if (did >= 0xC000 && did < (0xC000 + CAN_ID_MAX)) { // CAN data buffer 
+        *adr = (unsigned long)&can_buf.ID[did - 0xC000];
+        return sizeof(CAN_DATA_BYTE);
+    }
+    if (did >= 0xD000 && did < (0xD000 + EX_IO_MAX)) { // External I/O status 
+        *adr = (unsigned long)&exiosts.DATA[did - 0xD000];
+        return sizeof(EX_IO_MEM);
+    }
+    switch (did) {
+    case 0xF100: // Manufacturer's name 
+        *adr = (unsigned long)&def_ecu_corp[0];
+        return 16;
+    case 0xF101: // Vehicle code 
+        *adr = (unsigned long)&def_ecu_name[0];
+        return 16;
+    case 0xF102: // ECU version 
+        *adr = (unsigned long)&def_ecu_vars[0];
+        return 16;
+    case 0xF103: // F/W date 
+        *adr = (unsigned long)&def_ecu_date[0];
+        return 16;
+    case 0xF104: // F/W time 
+        *adr = (unsigned long)&def_ecu_time[0];
+        return 16;
+    }
+    return -1;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Dynamically defined DID element addition
+ * ---------------------------------------------------------------------------------------- */
+int uds_dddid_add(UDS_DDDID_STR *dd, unsigned long adr, int sz)
+{
+    if (dd->CNT >= UDS_DDDID_ELMS || sz <= 0 || (dd->SIZE + sz) > UDS_DDDID_SIZE) { // Definition over 
+        return -1;
+    }
+    dd->ELM[dd->CNT].ADDR   = adr;
+    dd->ELM[dd->CNT].SIZE   = sz;
+    dd->CNT++;
+    dd->SIZE                += sz;
+    return dd->CNT;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Dynamically defined DID data acquisition
+ * ---------------------------------------------------------------------------------------- */
+int uds_dddid_read(UDS_DDDID_STR *dd, unsigned char *dp)
+{
+    int i, k;
+
+    for (i = 0, k = 0; i < dd->CNT; i++) {
+        memcpy(&dp[k], (unsigned char *)dd->ELM[i].ADDR, dd->ELM[i].SIZE);
+        k += dd->ELM[i].SIZE;
+    }
+    return k;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x2A Read Data By Periodic Identifier
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_2a(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int i, k, t;
+
+    if (uds_diag_session < 2) { // Default session 
+        return UDS_EC_SNSAS;
+    }
+    if (sz < 2) {
+        return UDS_EC_IML_IF;
+    }
+    switch (req[1]) { // Transmission mode 
+    case 0x01: // Slow rate 
+        t = UDS_PERIOD_SLOW;
+        break;
+    case 0x02: // Medium rate 
+        t = UDS_PERIOD_MEDIUM;
+        break;
+    case 0x03: // Fast rate 
+        t = UDS_PERIOD_FAST;
+        break;
+    case 0x04: // Stop sending 
+        t = 0;
+        break;
+    default:
+        return UDS_EC_ROOR;
+    }
+    if (sz == 2) {
+        if (t != 0) { // No periodic DID 
+            return UDS_EC_IML_IF;
+        }
+        for (i = 0; i < UDS_DDDID_MAX; i++) { // Stop all 
+            uds_dddid[i].TIME = 0;
+        }
+    } else {
+        for (i = 2; i < sz; i++) { // Check all periodic DIDs first 
+            k = (int)req[i] - (UDS_DDDID_TOP & 0xFF);
+            if (k < 0 || k >= UDS_DDDID_MAX) {
                 return UDS_EC_ROOR;
             }
-            res[5] = rout_map.ID[k].BYTE;
-            i++;
-            break;
-        case 0x01: // Period / event / remote management definition variables 
-            if (k >= MESSAGE_MAX) {
+            if (t != 0 && (uds_dddid[k].CNT == 0 || uds_dddid[k].SIZE > UDS_PDID_SIZE)) { // Undefined or not in a single frame 
                 return UDS_EC_ROOR;
             }
-            memcpy(&res[5], &conf_ecu.LIST[k], sizeof(ECU_CYC_EVE));
-            i += sizeof(ECU_CYC_EVE);
-            break;
-        case 0x02:  // ECU input / output checklist 
-            if (k >= ECU_EXT_MAX) {
+        }
+        for (i = 2; i < sz; i++) {
+            k = (int)req[i] - (UDS_DDDID_TOP & 0xFF);
+            uds_dddid[k].TIME   = t;
+            uds_dddid[k].TCNT   = t;
+            uds_dddid[k].CH     = tp_pack.CH;
+        }
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    *len   = 1;
+    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x2C Dynamically Define Data Identifier
+ *  Non-default session only, the definitions are cleared when the session returns to default.
+ *  Memory ranges must pass uds_mem_check and may not touch E2DataFlash, because the
+ *  periodic reads are not synchronised with the data flash jobs.
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_2c(unsigned char *req, int sz, unsigned char *res, int *len)
+{
+    int             i, k, an, ln, z;
+    unsigned long   adr, d;
+    UDS_DDDID_STR   dd;
+
+    if (uds_diag_session < 2) { // Default session 
+        return UDS_EC_SNSAS;
+    }
+    if (sz < 2) {
+        return UDS_EC_IML_IF;
+    }
+    k = (sz >= 4) ? ((((int)req[2] << 8) | ((int)req[3] & 0xFF)) - UDS_DDDID_TOP) : -1;
+    if (sz >= 4 && (k < 0 || k >= UDS_DDDID_MAX)) { // Not a dynamically defined DID 
+        return UDS_EC_ROOR;
+    }
+    switch (req[1] & 0x7F) {
+    case 0x01: // Define by identifier [DDDID][Source DID][Position][Size]... 
+        if (sz < 8 || ((sz - 4) & 3) != 0) {
+            return UDS_EC_IML_IF;
+        }
+        memcpy(&dd, &uds_dddid[k], sizeof(UDS_DDDID_STR));
+        for (i = 4; i < sz; i += 4) {
+            z = uds_did_source(((int)req[i] << 8) | ((int)req[i + 1] & 0xFF), &d);
+            if (z < 0 || req[i + 2] == 0 || req[i + 3] == 0 || ((int)req[i + 2] - 1 + (int)req[i + 3]) > z) { // Position is 1 origin 
                 return UDS_EC_ROOR;
             }
-            memcpy(&res[5], &ext_list[k], sizeof(EXTERNUL_IO));
-            i += sizeof(EXTERNUL_IO);
-            break;
-        case 0x03:  // CAN-ID -> EX-I/O-ID Conversion table 
-            if (k >= CAN_ID_MAX) {
+            if (uds_dddid_add(&dd, d + req[i + 2] - 1, (int)req[i + 3]) < 0) {
                 return UDS_EC_ROOR;
             }
-            res[5] = can_to_exio[k];
-            i++;
-            break;
         }
         break;
-    case 0xF5:  // Data flash operation 
-        switch (req[2]) {
-        default:
-            return UDS_EC_SNS;
-        case 0x00:  // Check writing status 
-            k = ecu_data_check();
-            res[3] = (unsigned char)(k >> 8);
-            res[4] = (unsigned char)(k & 0xFF);
-            i += 2;
-            break;
+    case 0x02: // Define by memory address [DDDID][ALFID][Address][Size]... 
+        if (sz < 5) {
+            return UDS_EC_IML_IF;
+        }
+        an = req[4] & 0x0F;         // Address length 
+        ln = (req[4] >> 4) & 0x0F;  // Size length 
+        if (an == 0 || an > 4 || ln == 0 || ln > 2) {
+            return UDS_EC_ROOR;
+        }
+        if (sz < (5 + an + ln) || ((sz - 5) % (an + ln)) != 0) {
+            return UDS_EC_IML_IF;
+        }
+        memcpy(&dd, &uds_dddid[k], sizeof(UDS_DDDID_STR));
+        for (i = 5; i < sz; ) {
+            for (adr = 0, z = i + an; i < z; i++) {
+                adr <<= 8;
+                adr |= (unsigned long)req[i] & 0xFF;
+            }
+            for (d = 0, z = i + ln; i < z; i++) {
+                d <<= 8;
+                d |= (unsigned long)req[i] & 0xFF;
+            }
+            if (uds_mem_check(adr, d) != UDS_EC_NONE || (adr < UDS_DF_END && adr + d > UDS_DF_TOP)) { // Outside the memory map or data flash 
+                return UDS_EC_ROOR;
+            }
+            if (uds_dddid_add(&dd, adr, (int)d) < 0) {
+                return UDS_EC_ROOR;
+            }
+        }
+        break;
+    case 0x03: // Clear dynamically defined data identifier 
+        if (sz == 2) { // Clear all 
+            memset(&uds_dddid, 0, sizeof(uds_dddid));
+        } else if (sz == 4) {
+            memset(&uds_dddid[k], 0, sizeof(UDS_DDDID_STR));
+        } else {
+            return UDS_EC_IML_IF;
         }
         break;
+    default:
+        return UDS_EC_SFNS;
+    }
+    if ((req[1] & 0x7F) != 0x03) { // Definition update 
+        if (uds_dddid[k].TIME != 0 && dd.SIZE > UDS_PDID_SIZE) { // Periodic transmission no longer fits a single frame 
+            dd.TIME = 0;
+        }
+        memcpy(&uds_dddid[k], &dd, sizeof(UDS_DDDID_STR));
+    }
+    res[0] = req[0] | UDS_RES_SID;
+    res[1] = req[1];
+    *len   = 2;
+    if (sz >= 4) {
+        res[2] = req[2];
+        res[3] = req[3];
+        *len   = 4;
     }
-    *len = i;
     return UDS_EC_NONE;
 }
 
 /* ----------------------------------------------------------------------------------------
- * UDS 0x23 Read Memory By Address
+ * UDS periodic transmission processing (1ms cycle, call with the elapsed time)
  * ---------------------------------------------------------------------------------------- */
-int uds_sid_23(unsigned char *req, int sz, unsigned char *res, int *len)
+void uds_periodic_job(int tcnt)
 {
-    int             z;
-    unsigned char * p;
+    int             i;
+    int             id = SELECT_ECU_UNIT + 0x7E8;
+    UDS_DDDID_STR * dd;
 
-    p = (unsigned char *)(((int)req[1] << 16) | ((int)req[2] << 8) | ((int)req[3] & 0xFF));
-    z = (int)req[4];
-    if (z > 64) { // Batch read over 
-        return UDS_EC_IML_IF;
+    for (i = 0; i < UDS_DDDID_MAX; i++) {
+        dd = &uds_dddid[i];
+        if (dd->TIME == 0) { // Stop 
+            continue;
+        }
+        dd->TCNT -= tcnt;
+        if (dd->TCNT > 0) { // Waiting 
+            continue;
+        }
+        if (tp_pack.MODE != 0 || dd->CH < 0) { // Diagnostic response in progress, send at the next cycle 
+            dd->TCNT = 0;
+            continue;
+        }
+        dd->TCNT += dd->TIME;
+        if (dd->TCNT <= 0) { // Overrun 
+            dd->TCNT = dd->TIME;
+        }
+        memset(&can_buf.ID[id], 0, sizeof(CAN_DATA_BYTE));
+        can_buf.ID[id].BYTE[0]  = (unsigned char)(1 + dd->SIZE);    // Single frame PCI 
+        can_buf.ID[id].BYTE[1]  = (unsigned char)(UDS_DDDID_TOP + i); // Periodic DID 
+        uds_dddid_read(dd, &can_buf.ID[id].BYTE[2]);
+        CANID_DIRTY(id);
+        add_mbox_frame(dd->CH, 8, CAN_DATA_FRAME, id); // Stack buffer for transmission 
     }
-    res[0] = req[0] | UDS_RES_SID;
-    memcpy(&res[1], p, z);
-    *len = z + 1;
-    return UDS_EC_NONE;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction change marking (memory write)
+ * ---------------------------------------------------------------------------------------- */
+void uds_cfg_mark(unsigned long adr, int sz)
+{
+    unsigned long ead = adr + (unsigned long)sz;
+
+    if (ead > (unsigned long)&rout_map && adr < ((unsigned long)&rout_map + sizeof(rout_map))) {
+        UDS_CFG_DIRTY(ECU_DATA_MAP);
+    }
+    if (ead > (unsigned long)&conf_ecu.LIST[0] && adr < ((unsigned long)&conf_ecu.LIST[0] + sizeof(conf_ecu.LIST))) {
+        UDS_CFG_DIRTY(ECU_DATA_CONF);
+    }
+    if (ead > (unsigned long)&ext_list[0] && adr < ((unsigned long)&ext_list[0] + sizeof(ext_list))) {
+        UDS_CFG_DIRTY(ECU_DATA_IO);
+    }
+    if (ead > (unsigned long)&can_buf && adr < ((unsigned long)&can_buf + sizeof(can_buf))) {
+        EXT_RESCAN(); // Frame data written directly 
+    }
+    if (ead > (unsigned long)&exiosts && adr < ((unsigned long)&exiosts + sizeof(exiosts))) {
+        EXT_RESCAN(); // External I/O status written directly 
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction commit (returns the saved block bits)
+ * ---------------------------------------------------------------------------------------- */
+int uds_cfg_commit(void)
+{
+    int k = 0;
+
+    if (uds_cfg_dirty & (ECU_DATA_CONF | ECU_DATA_IO)) { // Rebuild chain / conversion table / mask once 
+        ecu_config_index();
+    }
+    if (uds_cfg_dirty & ECU_DATA_CONF) { // Restart periodic / event transmission 
+        ecu_event_start();
+    }
+    if (uds_cfg_dirty != 0) { // Save only the changed blocks at once 
+        k = ecu_data_save(uds_cfg_dirty);
+    }
+    uds_cfg_trans = 0;
+    uds_cfg_dirty = 0;
+    return k;
+}
+
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction abort (reload the saved configuration)
+ *  While a data flash job is writing the slot the reload is left to uds_pending_job.
+ * ---------------------------------------------------------------------------------------- */
+void uds_cfg_abort(void)
+{
+    if (uds_cfg_dirty != 0) {
+        if (ecu_fjob.STAT != ECU_FS_IDLE) { // Slot being written 
+            uds_cfg_reload = 1;
+        } else {
+            ecu_config_load();
+            ecu_event_start();
+        }
+    }
+    uds_cfg_trans = 0;
+    uds_cfg_dirty = 0;
 }
 
 /* ----------------------------------------------------------------------------------------
@@ -461,8 +1449,8 @@ int uds_sid_23(unsigned char *req, int sz, unsigned char *res, int *len)
  * ---------------------------------------------------------------------------------------- */
 int uds_sid_2e(unsigned char *req, int sz, unsigned char *res, int *len)
 {
-    int             i, k;
-    unsigned long   d;
+    int             i, k, n, b;
+    unsigned char * p;
 
     res[0] = req[0] | UDS_RES_SID;
     res[1] = req[1]; // CID 
@@ -492,6 +1480,7 @@ int uds_sid_2e(unsigned char *req, int sz, unsigned char *res, int *len)
             rout_map.ID[k].BYTE = req[5];
             res[5] = rout_map.ID[k].BYTE;
             i++;
+            UDS_CFG_DIRTY(ECU_DATA_MAP);
             break;
         case 0x01:  // Period / event / remote management definition variables 
             if (k >= MESSAGE_MAX) {
@@ -500,6 +1489,7 @@ int uds_sid_2e(unsigned char *req, int sz, unsigned char *res, int *len)
             memcpy(&conf_ecu.LIST[k], &req[5], sizeof(ECU_CYC_EVE));
             memcpy(&res[5], &conf_ecu.LIST[k], sizeof(ECU_CYC_EVE));
             i += sizeof(ECU_CYC_EVE);
+            UDS_CFG_DIRTY(ECU_DATA_CONF);
             break;
         case 0x02:  // ECU input / output checklist 
             if (k >= ECU_EXT_MAX) {
@@ -508,33 +1498,115 @@ int uds_sid_2e(unsigned char *req, int sz, unsigned char *res, int *len)
             memcpy(&ext_list[k], &req[5], sizeof(EXTERNUL_IO));
             memcpy(&res[5], &ext_list[k], sizeof(EXTERNUL_IO));
             i += sizeof(EXTERNUL_IO);
+            UDS_CFG_DIRTY(ECU_DATA_IO);
             break;
         case 0x03:  // CAN-ID -> EX-I/O-ID Conversion table 
-            if (k >= CAN_ID_MAX) {
+            return UDS_EC_ROOR;     // Read only : rebuilt from the checklist (ecu_config_index) 
+        }
+        break;
+    case 0xFD:  // Parameter range access [DID][First index][Count][Data...] 
+        if (uds_diag_session < 2) {    // Session low 
+            return UDS_EC_GR;          // General rejection 
+        }
+        if (uds_security_access < 1) { // Unauthorized 
+            return UDS_EC_SAD;         // Security denied 
+        }
+        if (sz < 8) {
+            return UDS_EC_IML_IF;
+        }
+        k = ((int)req[3] << 8) | ((int)req[4] & 0xFF);
+        n = ((int)req[5] << 8) | ((int)req[6] & 0xFF);
+        memcpy(&res[3], &req[3], 4);
+        i += 4;
+        switch (req[2]) {
+        default:
+            return UDS_EC_SNS;
+        case 0x00:  // Routing map 
+            if (k >= CAN_ID_MAX || n > (CAN_ID_MAX - k)) {
                 return UDS_EC_ROOR;
             }
-            can_to_exio[k] = req[5];
-            res[5] = can_to_exio[k];
-            i++;
+            p = &rout_map.ID[k].BYTE;
+            b = 1;
+            UDS_CFG_DIRTY(ECU_DATA_MAP);
+            break;
+        case 0x01:  // Period / event / remote management definition variables 
+            if (k >= MESSAGE_MAX || n > (MESSAGE_MAX - k)) {
+                return UDS_EC_ROOR;
+            }
+            p = (unsigned char *)&conf_ecu.LIST[k];
+            b = sizeof(ECU_CYC_EVE);
+            UDS_CFG_DIRTY(ECU_DATA_CONF);
+            break;
+        case 0x02:  // ECU input / output checklist 
+            if (k >= ECU_EXT_MAX || n > (ECU_EXT_MAX - k)) {
+                return UDS_EC_ROOR;
+            }
+            p = (unsigned char *)&ext_list[k];
+            b = sizeof(EXTERNUL_IO);
+            UDS_CFG_DIRTY(ECU_DATA_IO);
             break;
+        case 0x03:  // CAN-ID -> EX-I/O-ID Conversion table 
+            return UDS_EC_ROOR;     // Read only : rebuilt from the checklist (ecu_config_index) 
         }
+        if (n == 0 || sz != (7 + n * b)) { // Data length mismatch 
+            return UDS_EC_IML_IF;
+        }
+        memcpy(p, &req[7], n * b);
         break;
     case 0xF5: // Data flash operation 
         switch (req[2]) {
         default:
             return UDS_EC_SNS;
-        case 0x01: // Save 
+        case 0x01: // Save (queued, result in DID 0xF501) 
             k = ecu_data_write();
+            if (k == 0) { // Queue full 
+                return UDS_EC_BRR;
+            }
             res[3] = (unsigned char)(k >> 8);
             res[4] = (unsigned char)(k & 0xFF);
             i += 2;
             break;
-        case 0x02: // Erase 
+        case 0x02: // Erase (queued, result in DID 0xF501) 
             k = ecu_data_erase();
+            if (k == 0) { // Queue full 
+                return UDS_EC_BRR;
+            }
             res[3] = (unsigned char)(k >> 8);
             res[4] = (unsigned char)(k & 0xFF);
             i += 2;
             break;
+        case 0x10: // Open transaction 
+        case 0x11: // Commit transaction 
+        case 0x12: // Abort transaction 
+            if (uds_diag_session < 2) {    // Session low 
+                return UDS_EC_GR;          // General rejection 
+            }
+            if (uds_security_access < 1) { // Unauthorized 
+                return UDS_EC_SAD;         // Security denied 
+            }
+            if (req[2] == 0x10) {
+                if (uds_cfg_trans != 0) { // Already open 
+                    return UDS_EC_RSE;
+                }
+                if (uds_cfg_reload != 0) { // Previous abort not reloaded yet 
+                    return UDS_EC_BRR;
+                }
+                uds_cfg_trans = 1;
+                uds_cfg_dirty = 0;
+                break;
+            }
+            if (uds_cfg_trans == 0) { // Not open 
+                return UDS_EC_RSE;
+            }
+            if (req[2] == 0x11) {
+                k = uds_cfg_commit();
+                res[3] = (unsigned char)(k >> 8);
+                res[4] = (unsigned char)(k & 0xFF);
+                i += 2;
+            } else {
+                uds_cfg_abort();
+            }
+            break;
         }
         break;
     }
@@ -547,9 +1619,9 @@ int uds_sid_2e(unsigned char *req, int sz, unsigned char *res, int *len)
  * ---------------------------------------------------------------------------------------- */
 int uds_sid_3d(unsigned char *req, int sz, unsigned char *res, int *len)
 {
-    int i;
-    int z;
-    unsigned char *p, *r;
+    int             i, an, ln;
+    unsigned long   adr;
+    unsigned long   z;
 
     if (uds_diag_session < 2) {    // Session low 
         return UDS_EC_GR;          // General rejection 
@@ -557,15 +1629,30 @@ int uds_sid_3d(unsigned char *req, int sz, unsigned char *res, int *len)
     if (uds_security_access < 1) { // Unauthorized 
         return UDS_EC_SAD;         // Security denied 
     }
-    p   = (unsigned char *)(((int)req[1] << 16) | ((int)req[2] << 8) | ((int)req[3] & 0xFF));
-    z   = (int)req[4];
-    if (z > 64) { // Batch write over 
+    if (sz < 4) {
+        return UDS_EC_IML_IF;
+    }
+    an = req[1] & 0x0F;         // Address length 
+    ln = (req[1] >> 4) & 0x0F;  // Size length 
+    if (an == 0 || an > 4 || ln == 0 || ln > 4) { // Format error 
+        return UDS_EC_ROOR;
+    }
+    for (adr = 0, i = 2; i < 2 + an && i < sz; i++) {
+        adr <<= 8;
+        adr |= (unsigned long)req[i] & 0xFF;
+    }
+    for (z = 0; i < 2 + an + ln && i < sz; i++) {
+        z <<= 8;
+        z |= (unsigned long)req[i] & 0xFF;
+    }
+    if (z == 0 || z > UDS_READ_MAX || (unsigned long)sz != (2 + an + ln + z)) { // Length error 
         return UDS_EC_IML_IF;
     }
-    memcpy(p, &req[5], z);
-    memcpy(res, req, 5);
+    memcpy((unsigned char *)adr, &req[i], (int)z);
+    uds_cfg_mark(adr, (int)z);
+    memcpy(res, req, i);
     res[0] |= UDS_RES_SID;
-    *len = 5;
+    *len = i;
     return UDS_EC_NONE;
 }
 
@@ -574,7 +1661,7 @@ int uds_sid_3d(unsigned char *req, int sz, unsigned char *res, int *len)
  * ---------------------------------------------------------------------------------------- */
 int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len)
 {
-    int i, j, sb, eb, bs;
+    int i, sb, eb, cnt;
     int siz;
     unsigned long adr;
 
@@ -584,11 +1671,24 @@ int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len)
     if (uds_security_access == 0) { // Lock status 
         return UDS_EC_UDNA;
     }
-    if (uds_load.MODE) {  // Running error 
+    if (uds_load.MODE == UDS_TD_ERASE) { // Erasing (called again from uds_pending_job) 
+        if (uds_erase.CNT > 0) { // Still in progress 
+            return UDS_EC_RCR;
+        }
+        if (uds_erase.ERR != 0) { // Erase failed 
+            uds_load.MODE = UDS_TD_NONE;
+            return UDS_EC_GPF;
+        }
+        return uds_sid_34_accept(req, res, len);
+    }
+    if (uds_load.MODE || uds_prog_busy() || uds_erase.STEP != 0) { // Running error (or the block erase of a stopped download) 
         return UDS_EC_BRR;
     }
-    if (req[1] != 0x00) { // No support for compression 
-        return UDS_EC_SFNS;
+    if (ecu_fjob.STAT != ECU_FS_IDLE || ecu_fjob.CNT > 0) { // Data flash job queued or running 
+        return UDS_EC_BRR;
+    }
+    if (req[1] != UDS_DFI_NONE && req[1] != UDS_DFI_LZSS) { // Unsupported compression / encryption 
+        return UDS_EC_ROOR;
     }
     switch (req[2]) { // Format 
     case 0x44:
@@ -604,40 +1704,21 @@ int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len)
     default:
         return UDS_EC_SFNS;
     }
+    uds_prog_err = 0;
+    cnt = 0;
+    memset(&uds_lzss, 0, sizeof(UDS_LZSS_STR)); // Clear the window 
     if (adr >= 0x00000000ul && adr <= 0x0003FFFF) { // RAM 
         return UDS_EC_CNC;  // Range error 
     } else if (adr >= 0x00100000ul && adr <= 0x00107FFF) { // E2Data 
-        if (siz > (0x00108000 - adr) || siz < 0) { // Size error 
+        if (adr < UDS_E2_TOP) { // Slots / journal / DTC / freeze frame blocks 
+            return UDS_EC_CNC;  // Range error 
+        }
+        if (siz > (UDS_E2_END - adr) || siz < 0) { // Size error 
             return UDS_EC_UDNA;
         }
-        if ((adr & 0x00001FFF) == 0) { // Erase 
-            i = BLOCK_DB0 + (adr >> 13); // Erase block 
-            for (j = siz; j > 0; j -= 0x2000, i--) { // Erase block to be written first 
-                if (
-                    R_FlashDataAreaBlankCheck(
-                        g_flash_BlockAddresses[i], 
-                        BLANK_CHECK_ENTIRE_BLOCK
-                    ) == FLASH_NOT_BLANK
-                ) { // Erase 
-                    while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                        ;
-                    }
-                    if (R_FlashErase(i) != FLASH_SUCCESS) {
-                        return UDS_EC_GPF;
-                    }
-                    while (R_FlashGetStatus() != FLASH_SUCCESS) {
-                        ;
-                    }
-                    if (
-                        R_FlashDataAreaBlankCheck(
-                            g_flash_BlockAddresses[i],
-                            BLANK_CHECK_ENTIRE_BLOCK
-                        ) != FLASH_BLANK
-                    ) { // Erase failed 
-                        return UDS_EC_GPF;
-                    }
-                }
-            }
+        if ((adr & 0x000007FF) == 0) { // Erase 
+            sb  = UDS_E2_BLOCK + (int)((adr - UDS_E2_TOP) >> 11); // Erase block 
+            cnt = (siz + 0x07FF) >> 11;
         }
     } else if (adr >= 0xFFE00000ul) { // Program Flash ROM 
         if (uds_security_access < 2 && (adr >= 0xFFF40000ul || (adr + (unsigned long)siz) >= 0xFFF40000ul)) {
@@ -653,40 +1734,29 @@ int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len)
             if (adr < 0xFFF00000ul) {  // Erase failed 64K block (data ROM area) 
                 sb = BLOCK_69 - ((adr - 0xFFE00000ul) >> 16);
                 eb = sb - ((siz + 0xFFFF) >> 16);
-                bs = 0x10000;
                 if (eb < BLOCK_53) {
                     return UDS_EC_CNC; // Range error 
                 }
             } else if (adr < 0xFFF80000ul) { // 32K block (program ROM area) 
                 sb = BLOCK_53 - ((adr - 0xFFF00000ul) >> 15);
                 eb = sb - ((siz + 0x7FFF) >> 15);
-                bs = 0x8000;
                 if (eb < BLOCK_37) {
                     return UDS_EC_CNC; // Range error 
                 }
             } else if (adr < 0xFFFF8000ul) { // 16K block (boot loader ROM area) 
                 sb = BLOCK_37 - ((adr - 0xFFF80000ul) >> 14);
                 eb = sb - ((siz + 0x3FFF) >> 14);
-                bs = 0x4000;
                 if (eb < BLOCK_7) {
                     return UDS_EC_CNC; // Range error 
                 }
             } else { // 4K block (boot initialization ROM area) 
                 sb = BLOCK_7 - ((adr - 0xFFFF8000ul) >> 12);
                 eb = sb - ((siz + 0x0FFF) >> 12);
-                bs = 0x1000;
                 if (eb < -1) {
                     return UDS_EC_CNC;  // Range error 
                 }
             }
-            for (i = sb, j = siz; j > 0; j -= bs, i--) { // Erase block to be written first 
-                _di();
-                if (R_FlashErase(i) != FLASH_SUCCESS) {
-                    _ei();
-                    return UDS_EC_GPF;
-                }
-                _ei();
-            }
+            cnt = sb - eb;
         }
     } else { // Program range error 
         return UDS_EC_CNC;
@@ -694,6 +1764,23 @@ int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len)
     // Download status 
     uds_load.ADDR   = adr;
     uds_load.SIZE   = siz;
+    uds_load.DFI    = req[1];
+    if (cnt > 0) { // Erase block to be written first in uds_erase_job 
+        uds_erase.BLK   = sb;
+        uds_erase.CNT   = cnt;
+        uds_erase.STEP  = 0;
+        uds_erase.ERR   = 0;
+        uds_load.MODE   = UDS_TD_ERASE;
+        return UDS_EC_RCR;  // Response pending until the erase is completed 
+    }
+    return uds_sid_34_accept(req, res, len);
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x34 Request Download acceptance
+ * ---------------------------------------------------------------------------------------- */
+int uds_sid_34_accept(unsigned char *req, unsigned char *res, int *len)
+{
     uds_load.MODE   = UDS_TD_DOWNLOAD;
     uds_load.BLKL   = 1 + 128;  // SID + Data[128] 
     uds_load.CNT    = 0;
@@ -791,42 +1878,34 @@ int uds_sid_36(unsigned char *req, int sz, unsigned char *res, int *len)
             uds_load.MODE = UDS_TD_NONE;    // Cancel transfer 
             return UDS_EC_IML_IF;
         }
+        if (uds_prog_err != 0) {            // Programming of a previous block failed 
+            uds_load.MODE = UDS_TD_NONE;
+            return UDS_EC_GPF;
+        }
         sz--;   // Reduce by command code byte 
+        if (uds_load.DFI == UDS_DFI_LZSS) { // Compressed (memorySize is the decompressed size) 
+            if (uds_lzss_job(&req[1], sz) < 0) { // Staging buffers are full 
+                return UDS_EC_RCR;  // Response pending 
+            }
+            sz = 0;
+        }
         if ((uds_load.CNT + sz) > uds_load.SIZE) {
             sz = uds_load.SIZE - uds_load.CNT;
         }
-        if ((uds_load.ADDR & 0xFFFC0000) == 0) { // Write to RAM 
+        if (sz == 0) { // Decompressed or nothing remaining 
+            ;
+        } else if ((uds_load.ADDR & 0xFFFC0000) == 0) { // Write to RAM 
             p = (unsigned char *)uds_load.ADDR;
             uds_load.ADDR += sz;
             uds_load.CNT  += sz;
             memcpy(p, &req[1], sz);
-        } else if ((uds_load.ADDR & 0xFFFF8000ul) == 0x00100000ul) { // E2Data 
-            i = sz;
-            if ((i & (DF_PROGRAM_SIZE_SMALL - 1)) != 0) { // Fill with 00 if the minimum write byte has not been reached 
-                for (; (i & (DF_PROGRAM_SIZE_SMALL - 1)) != 0; i++) {
-                    req[1 + i] = 0;
-                }
-            }
-            if (R_FlashWrite(uds_load.ADDR, (int)&req[1], i) != FLASH_SUCCESS) { // Write failed 
-                uds_load.MODE = UDS_TD_NONE;
-                return UDS_EC_GPF;
-            }
-            uds_load.ADDR += sz;
-            uds_load.CNT  += sz;
-        } else if (uds_load.ADDR >= 0xFFE00000ul) { // Program Flash ROM 
-            i = sz;
-            if (i < ROM_PROGRAM_SIZE) { // Fill in the program unit shortfall with FF 
-                for (; i < ROM_PROGRAM_SIZE; i++) {
-                    req[1 + i] = 0xFF;
-                }
-            }
-            _di();
-            if (R_FlashWrite(uds_load.ADDR, (int)&req[1], i) != FLASH_SUCCESS) { // Write failed 
-                _ei();
-                uds_load.MODE = UDS_TD_NONE;
-                return UDS_EC_GPF;
+        } else if (
+            (uds_load.ADDR & 0xFFFF8000ul) == 0x00100000ul ||   // E2Data 
+            uds_load.ADDR >= 0xFFE00000ul                       // Program Flash ROM 
+        ) { // Stack in the staging buffer and program from uds_pending_job while the next block is received 
+            if (uds_prog_stack(uds_load.ADDR, &req[1], sz) < 0) { // Both buffers are waiting for the FCU 
+                return UDS_EC_RCR;  // Response pending 
             }
-            _ei();
             uds_load.ADDR   += sz;
             uds_load.CNT    += sz;
         }
@@ -874,6 +1953,14 @@ int uds_sid_37(unsigned char *req, int sz, unsigned char *res, int *len)
     if (uds_security_access == 0) { // Lock status 
         return UDS_EC_UDNA;
     }
+    if (uds_prog_busy()) { // Wait until the stacked blocks are programmed 
+        return UDS_EC_RCR;  // Response pending 
+    }
+    if (uds_prog_err != 0) { // Programming failed 
+        uds_prog_err  = 0;
+        uds_load.MODE = UDS_TD_NONE;
+        return UDS_EC_GPF;
+    }
     if (uds_load.MODE != UDS_TD_NONE) {
         if (uds_load.MODE == UDS_TD_DOWNLOAD) { // Downloading (Tools-> ECU) 
             if (uds_load.ADDR >= 0xFFF00000ul && uds_load.ADDR < 0xFFF20000ul) { // Erase ROM to interrupt user firmware area 
@@ -899,55 +1986,69 @@ int uds_sid_37(unsigned char *req, int sz, unsigned char *res, int *len)
 }
 
 /* ----------------------------------------------------------------------------------------
- * UDS processing
+ * UDS service execution
  * ---------------------------------------------------------------------------------------- */
-int uds_job(unsigned char *msg, int len, unsigned char *res)    //int ch, int id, void *frame) 
+int uds_service(unsigned char *msg, int len, unsigned char *res, int *size)
 {
-    int size = 0;
-    int ercd = UDS_EC_NONE;
     // Execute service 
     switch (msg[0]) {
     default: // Service not supported 
-        res[0] = UDS_ERR_SID;
-        res[1] = msg[0];
-        res[2] = UDS_EC_SNS;
-        return 3;
+        return UDS_EC_SNS;
     case 0x10: // Diagnostic Session Control 
-        ercd = uds_sid_10(msg, len, res, &size);
-        break;
+        return uds_sid_10(msg, len, res, size);
     case 0x11: // ECU Reset 
-        ercd = uds_sid_11(msg, len, res, &size);
-        break;
+        return uds_sid_11(msg, len, res, size);
     case 0x27: // Security Access 
-        ercd = uds_sid_27(msg, len, res, &size);
-        break;
+        return uds_sid_27(msg, len, res, size);
     case 0x3E: // Tester Present 
-        ercd = uds_sid_3e(msg, len, res, &size);
-        break;
+        return uds_sid_3e(msg, len, res, size);
+    case 0x19: // Read DTC Information 
+        return uds_sid_19(msg, len, res, size);
+    case 0x14: // Clear Diagnostic Information 
+        return uds_sid_14(msg, len, res, size);
+    case 0x31: // Routine Control 
+        return uds_sid_31(msg, len, res, size);
     case 0x22: // Read Data By Identifier 
-        ercd = uds_sid_22(msg, len, res, &size);
-        break;
+        return uds_sid_22(msg, len, res, size);
     case 0x23: // Read Memory By Address 
-        ercd = uds_sid_23(msg, len, res, &size);
-        break;
+        return uds_sid_23(msg, len, res, size);
+    case 0x2A: // Read Data By Periodic Identifier 
+        return uds_sid_2a(msg, len, res, size);
+    case 0x2C: // Dynamically Define Data Identifier 
+        return uds_sid_2c(msg, len, res, size);
     case 0x2E: // Write Data By Identifier 
-        ercd = uds_sid_2e(msg, len, res, &size);
-        break;
+        return uds_sid_2e(msg, len, res, size);
     case 0x3D: // Write Memory By Address 
-        ercd = uds_sid_3d(msg, len, res, &size);
-        break;
+        return uds_sid_3d(msg, len, res, size);
     case 0x34: // Request Download 
-        ercd = uds_sid_34(msg, len, res, &size);
-        break;
+        return uds_sid_34(msg, len, res, size);
     case 0x35: // Request Upload 
-        ercd = uds_sid_35(msg, len, res, &size);
-        break;
+        return uds_sid_35(msg, len, res, size);
     case 0x36: // Transfer Data 
-        ercd = uds_sid_36(msg, len, res, &size);
-        break;
+        return uds_sid_36(msg, len, res, size);
     case 0x37: // Request Transfer Exit 
-        ercd = uds_sid_37(msg, len, res, &size);
-        break;
+        return uds_sid_37(msg, len, res, size);
+    }
+}
+
+/* ----------------------------------------------------------------------------------------
+ * UDS processing
+ * ---------------------------------------------------------------------------------------- */
+int uds_job(unsigned char *msg, int len, unsigned char *res)    //int ch, int id, void *frame) 
+{
+    int size = 0;
+    int ercd = UDS_EC_NONE;
+
+    if (uds_pend.SID != 0 && msg[0] != 0x3E) { // Previous request still pending 
+        ercd = UDS_EC_BRR;
+    } else { // Execute service 
+        ercd = uds_service(msg, len, res, &size);
+    }
+    if (ercd == UDS_EC_RCR) { // Response pending : Hold the request and complete it in uds_pending_job 
+        uds_pend.SID    = msg[0];
+        uds_pend.SIZE   = (len < CAN_TP_MAX_BUF) ? len : CAN_TP_MAX_BUF;
+        memcpy(uds_pend.REQ, msg, uds_pend.SIZE);
+        start_timer(UDS_TIMER_ID, UDS_PENDING_TIME);
     }
     if (ercd != UDS_EC_NONE) { // With error 
         res[0] = UDS_ERR_SID;
@@ -958,3 +2059,52 @@ int uds_job(unsigned char *msg, int len, unsigned char *res)    //int ch, int id
     after_call(DTC_TIMER_ID, 10000, uds_timeup); // Connection maintaining 10 seconds timer 
     return size;
 }
+
+/* ----------------------------------------------------------------------------------------
+ * UDS deferred processing (call from main)
+ *  The response is built in the idle CAN-TP transmit buffer, same as uds_job.
+ * ---------------------------------------------------------------------------------------- */
+void uds_pending_job(void)
+{
+    int             size = 0;
+    int             ercd;
+    unsigned char   *res = tp_pack.TXD.BUF;
+
+    uds_erase_job(); // Download area erase 
+    uds_prog_job();  // Flash programming 
+    if (uds_cfg_reload != 0 && ecu_fjob.STAT == ECU_FS_IDLE) { // Deferred transaction abort 
+        uds_cfg_reload = 0;
+        ecu_config_load();
+        ecu_event_start();
+    }
+
+    if (uds_pend.SID == 0) {  // No pending request 
+        return;
+    }
+    if (tp_pack.MODE != 0) {  // Wait for the end of the previous transmission 
+        return;
+    }
+    ercd = uds_service(uds_pend.REQ, uds_pend.SIZE, res, &size);
+    if (ercd == UDS_EC_RCR) { // Still in progress 
+        if (check_timer(UDS_TIMER_ID)) { // Repeat response pending before P2*server expires 
+            res[0] = UDS_ERR_SID;
+            res[1] = uds_pend.SID;
+            res[2] = UDS_EC_RCR;
+            can_tp_response(res, 3);
+            start_timer(UDS_TIMER_ID, UDS_PENDING_TIME);
+            after_call(DTC_TIMER_ID, 10000, uds_timeup); // Connection maintaining 10 seconds timer 
+        }
+        return;
+    }
+    if (ercd != UDS_EC_NONE) { // With error 
+        res[0] = UDS_ERR_SID;
+        res[1] = uds_pend.SID;
+        res[2] = ercd;
+        size   = 3;
+    } else {
+        after_call(DTC_TIMER_ID, 10000, uds_timeup); // Connection maintaining 10 seconds timer 
+    }
+    uds_pend.SID = 0;
+    stop_timer(UDS_TIMER_ID);
+    can_tp_response(res, size); // Final response 
+}
@@ -153,31 +153,202 @@ extern int uds_security_access;    // Security access
 #define UDS_TD_NONE     0 // Waiting for upload / download request 
 #define UDS_TD_DOWNLOAD 1 // Downloading 
 #define UDS_TD_UPLOAD   2 // Uploading 
+#define UDS_TD_ERASE    3 // Erasing before download (response pending) 
 typedef struct  __uds_load_control_str__ {
     int           MODE; // Transfer mode 
     unsigned long ADDR; // Address 
     int           SIZE; // Size 
     int           BLKL; // Block size 
     int           CNT;  // Transfer counter 
+    int           DFI;  // Data format identifier (compression method) 
 }   UDS_LOAD_STR;
 
 extern UDS_LOAD_STR uds_load; // Download / upload management 
 
 #define UDS_BUFFER_MAX (128+1) // Maximum data size that can be sent and received by UDS 
+#define UDS_READ_MAX   (CAN_TP_MAX_BUF-2) // Maximum 0x23 read size (CAN-TP 12bit length - SID) 
+
+// Flash programming staging buffer (0x36 double buffer) 
+#define UDS_PROG_BUFS 2 // Number of staging buffers 
+#define UDS_PB_FREE   0 // Empty 
+#define UDS_PB_QUEUED 1 // Waiting for programming 
+#define UDS_PB_BUSY   2 // Programming in progress (BGO) 
+typedef struct  __uds_prog_buffer_str__ {
+    int           STAT;                // Buffer status 
+    unsigned long ADDR;                // Programming address 
+    int           SIZE;                // Programming size (padded to the program unit) 
+    volatile unsigned char RES;        // E2Data write result (FLASH_BUSY while running) 
+    unsigned char BUF[UDS_BUFFER_MAX]; // Block data 
+}   UDS_PROG_BUF;
+
+extern UDS_PROG_BUF uds_prog[UDS_PROG_BUFS]; // Flash programming staging buffers 
+extern int          uds_prog_err;            // Programming failure latch 
+
+// Response pending (NRC 0x78) management structure 
+#define UDS_PENDING_TIME 2000 // Response pending re-transmission interval (ms) < P2*server 5000ms 
+typedef struct  __uds_pending_str__ {
+    int           SID;                 // Held service (0=none) 
+    int           SIZE;                // Request size 
+    unsigned char REQ[CAN_TP_MAX_BUF]; // Held request (whole CAN-TP message) 
+}   UDS_PEND_STR;
+
+extern UDS_PEND_STR uds_pend; // Response pending request 
+
+// Download area erase management structure (0x34 background erase) 
+/*
+ *  ROM blocks are erased with R_FlashEraseSlice : interrupts are disabled only for one
+ *  step (UDS_ERASE_SLICE plus the FCU suspend delay), the erase is suspended between
+ *  the steps and between the main loop passes.
+ *  At 500kbps the shortest CAN frame takes 94us (47bit) and the receive FIFO holds
+ *  4 frames, so CAN reception (and forwarding from the main loop) goes on during
+ *  the erase.
+ */
+#define UDS_ERASE_SLICE 100 // ROM erase step (us) 
+#define UDS_ERASE_STEPS 10  // ROM erase steps per main loop pass 
+typedef struct  __uds_erase_str__ {
+    int BLK;  // Block being erased 
+    int CNT;  // Remaining blocks 
+    int STEP; // 0=Next block / 1=Waiting for erase completion (E2Data BGO / ROM suspended) 
+    int ERR;  // Erase failure 
+    volatile unsigned char RES; // E2Data erase result (FLASH_BUSY while running) 
+}   UDS_ERASE_STR;
+
+extern UDS_ERASE_STR uds_erase; // Download area erase 
+
+// Memory CRC32 routine (0x31 RID 0x0202, calculated in slices with response pending) 
+#define UDS_RID_CRC32   0x0202  // Routine identifier 
+#define UDS_CRC_SLICE   4096    // Bytes per main loop pass 
+#define UDS_CRC_NONE    0       // No result 
+#define UDS_CRC_RUN     1       // Calculating 
+#define UDS_CRC_DONE    2       // Result available 
+typedef struct  __uds_crc_str__ {
+    int           STAT; // Routine status 
+    unsigned long ADR;  // Next address 
+    unsigned long REM;  // Remaining bytes 
+    unsigned long VAL;  // CRC register (inverted at completion) 
+}   UDS_CRC_STR;
+
+extern UDS_CRC_STR uds_crc; // Memory CRC32 routine 
+
+/*
+ *  Compressed download (0x34 dataFormatIdentifier)
+ *
+ *  0x00 : No compression
+ *  0x10 : LZSS 256 byte window (memorySize is the size after decompression)
+ *         [Flag] [Token]*8 [Flag] [Token]*8 ...
+ *         Flag  : bit0 first, 1=Literal / 0=Match
+ *         Token : Literal = [Data] / Match = [Distance-1] [Length-3]
+ *         The window is cleared to 00 at 0x34, the stream may be split at any byte by 0x36
+ */
+#define UDS_DFI_NONE      0x00 // No compression 
+#define UDS_DFI_LZSS      0x10 // LZSS 
+#define UDS_LZ_WINDOW     256  // Sliding window size (power of 2) 
+#define UDS_LZ_MIN_MATCH  3    // Minimum match length 
+#define UDS_LZ_UNIT       128  // Programming unit assembled from the decompressed data 
+typedef struct  __uds_lzss_str__ {
+    int           FLAG;                // Flag bits (0x100 terminated, 1=next byte is a flag) 
+    int           STEP;                // 0=Token / 1=Match length 
+    int           DIST;                // Match distance 
+    int           LEN;                 // Remaining match bytes 
+    int           WP;                  // Window write position 
+    int           IPOS;                // Input position in the current 0x36 block 
+    int           OCNT;                // Bytes in the programming unit 
+    unsigned char WIN[UDS_LZ_WINDOW];  // Sliding window 
+    unsigned char OBUF[UDS_LZ_UNIT];   // Programming unit 
+}   UDS_LZSS_STR;
+
+extern UDS_LZSS_STR uds_lzss; // Download decompression 
+
+/*
+ *  Dynamically defined DID (0x2C) / Periodic transmission (0x2A)
+ *
+ *  DDDID 0xF280 to 0xF287 = Periodic DID 0x80 to 0x87
+ *  Source DID (0x2C 01) : 0xF100 to 0xF104 ECU information
+ *                         0xC000 to 0xC7FF CAN data buffer (can_buf 8 byte)
+ *                         0xD000 to 0xD03F External I/O status (exiosts 4 byte)
+ *  Periodic response    : Single frame on the diagnostic response ID [PCI][PDID][Data 0 to 6]
+ */
+#define UDS_DDDID_TOP     0xF280 // First dynamically defined DID 
+#define UDS_DDDID_MAX     8      // Number of dynamically defined DIDs 
+#define UDS_DDDID_ELMS    8      // Source elements per DID 
+#define UDS_DDDID_SIZE    32     // Maximum data size per DID 
+#define UDS_PDID_SIZE     6      // Maximum periodic data size (single frame) 
+#define UDS_PERIOD_SLOW   1000   // Slow rate (ms) 
+#define UDS_PERIOD_MEDIUM 200    // Medium rate (ms) 
+#define UDS_PERIOD_FAST   20     // Fast rate (ms) 
+typedef struct  __uds_dddid_element_str__ {
+    unsigned long ADDR; // Source address 
+    int           SIZE; // Source size 
+}   UDS_DDDID_ELM;
+typedef struct  __uds_dddid_str__ {
+    int           CNT;                 // Number of elements (0=Undefined) 
+    int           SIZE;                // Total data size 
+    int           TIME;                // Periodic rate (ms, 0=Stop) 
+    int           TCNT;                // Periodic remaining time (ms) 
+    int           CH;                  // Periodic transmission CAN channel 
+    UDS_DDDID_ELM ELM[UDS_DDDID_ELMS]; // Source elements 
+}   UDS_DDDID_STR;
+
+extern UDS_DDDID_STR uds_dddid[UDS_DDDID_MAX]; // Dynamically defined DIDs 
+
+#define UDS_F1_PREP     5           // Prepared ECU information responses (0xF100 to 0xF104) 
+#define UDS_F1_RSIZE    (3 + 16)    // [0x62][0xF1][0x0n][16 byte] 
+extern unsigned char uds_f1_resp[UDS_F1_PREP][UDS_F1_RSIZE]; // Prepared 0x22 F1xx responses 
+
+/*
+ *  Parameter DIDs (0x22 / 0x2E)
+ *
+ *  F300 to F303 [Index]              Routing map / Period-event list / I/O checklist / CAN-ID -> EX-I/O-ID
+ *  FD00 to FD03 [First index][Count] Same tables by range (system supplier specific DIDs)
+ *  F400 to F4FF are OBD PIDs, used by the DTC snapshot records (0x19 04).
+ *
+ *  Configuration transaction (0x2E / 0x3D bulk write)
+ *
+ *  0x2E F510        Open transaction
+ *  0x2E F3xx / FDxx Write elements / ranges, 0x3D write memory (derived information is not updated)
+ *  0x2E F511        Commit : Rebuild derived information once and save only the changed blocks
+ *  0x2E F512        Abort  : Reload the saved configuration
+ *  Changes are marked only while a transaction is open.
+ *  F303 / FD03 (CAN-ID -> EX-I/O-ID table) is derived information and cannot be written.
+ */
+extern int uds_cfg_trans; // Transaction (0=None / 1=Open) 
+extern int uds_cfg_dirty; // Changed area (ECU_DATA_MAP / ECU_DATA_CONF / ECU_DATA_IO) 
+extern int uds_cfg_reload; // Abort waiting for the data flash job (reload in uds_pending_job) 
+#define UDS_CFG_DIRTY(m) (uds_cfg_dirty |= (uds_cfg_trans != 0) ? (m) : 0)
 
 /*
  *  Repro regulations
  *
  *  ROM area setting
  *  E2DataFlash
- *  0x00100000 to 0x00107FFF  8K*4  Parameter      <--- 0x00100000 to 0x00107FFF Download permission  / Erase size 0x00002000
+ *  0x00100000 to 0x001067FF  2K*13 Parameter      <--- 0x00100000 to 0x001067FF Download prohibition / Erase size 0x00000800
+ *  0x00106800 to 0x00107FFF  2K*3  Free           <--- 0x00106800 to 0x00107FFF Download permission  / Erase size 0x00000800
  *  Program Block
  *  0xFFE00000 to 0xFFEFFFFF 64K*16 Data Area      <--- 0xFFE00000 to 0xFFEFFFFF Download permission  / Erase size 0x00010000
  *  0xFFF00000 to 0xFFF3FFFF 32K*8  Download F/W   <--- 0xFFF00000 to 0xFFF3FFFF Download permission  / Erase size 0x00008000
  *  0xFFF40000 to 0xFFF7FFFF 32K*8  Default F/W    <--- 0xFFF40000 to 0xFFF7FFFF Download prohibition / Erase size 0x00008000
  *  0xFFF80000 to 0xFFFF7FFF 16K*29 Bootloader F/W <--- 0xFFF80000 to 0xFFFEFFFF Download prohibition / Erase size 0x00004000
  *  0xFFFF8000 to 0xFFFFFFFF  4K*8  Configuration  <--- 0xFFFF0000 to 0xFFFFFFFF Download prohibition / Erase size 0x00001000
+ *
+ *  The lower E2DataFlash blocks belong to the configuration slots, journal, DTC log and
+ *  freeze frames (see ecu.h / obd2.h) and are only written through their own jobs.
+ *  0x34 is refused with BRR while a data flash job (ecu_fjob) is queued or running.
+ */
+#define UDS_E2_TOP      0x00106800ul    // Download area top (BLOCK_DB13) 
+#define UDS_E2_END      0x00108000ul    // Download area end 
+#define UDS_E2_BLOCK    BLOCK_DB13      // First erase block of the download area 
+
+/*
+ *  Memory map readable by 0x23 / 0x2C / 0x31 (uds_mem_check)
+ *  0x00000000 to 0x0001FFFF  On-chip SRAM (128KB)
+ *  0x00100000 to 0x00107FFF  E2DataFlash (refused while the FCU is busy with data flash)
+ *  0xFFE00000 to 0xFFFFFFFF  Program ROM
  */
+#define UDS_RAM_TOP     0x00000000ul    // RAM top 
+#define UDS_RAM_END     0x00020000ul    // RAM end 
+#define UDS_DF_TOP      0x00100000ul    // E2DataFlash top 
+#define UDS_DF_END      0x00108000ul    // E2DataFlash end 
+#define UDS_ROM_TOP     0xFFE00000ul    // ROM top (end is 0xFFFFFFFF) 
 
 /* ----------------------------------------------------------------------------------------
  * CAN-UDS Variable initialization
@@ -195,10 +366,34 @@ extern int uds_sid_11(unsigned char *req, int sz, unsigned char *res, int *len);
  * UDS 0x27 Security Access
  * ---------------------------------------------------------------------------------------- */
 extern int uds_sid_27(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x19 Read DTC Information
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_19(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x14 Clear Diagnostic Information
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_14(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * CRC32 (IEEE 802.3) update, crc starts from 0xFFFFFFFF and is inverted at the end
+ * ---------------------------------------------------------------------------------------- */
+extern unsigned long uds_crc32(unsigned long crc, const unsigned char *dp, unsigned long sz);
+/* ----------------------------------------------------------------------------------------
+ * Memory range check (UDS_EC_NONE=Readable / UDS_EC_ROOR=Out of map or busy data flash)
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_mem_check(unsigned long adr, unsigned long sz);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x31 Routine Control
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_31(unsigned char *req, int sz, unsigned char *res, int *len);
 /* ----------------------------------------------------------------------------------------
  * UDS 0x3E Tester Present
  * ---------------------------------------------------------------------------------------- */
 extern int uds_sid_3e(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * DID data acquisition
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_did_read(unsigned char *req, int rsz, unsigned char *res, int *len, int max);
 /* ----------------------------------------------------------------------------------------
  * UDS 0x22 Read Data By Identifier
  * ---------------------------------------------------------------------------------------- */
@@ -207,6 +402,46 @@ extern int uds_sid_22(unsigned char *req, int sz, unsigned char *res, int *len);
  * UDS 0x23 Read Memory By Address
  * ---------------------------------------------------------------------------------------- */
 extern int uds_sid_23(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * Source DID address acquisition
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_did_source(int did, unsigned long *adr);
+/* ----------------------------------------------------------------------------------------
+ * Dynamically defined DID element addition
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_dddid_add(UDS_DDDID_STR *dd, unsigned long adr, int sz);
+/* ----------------------------------------------------------------------------------------
+ * Dynamically defined DID data acquisition
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_dddid_read(UDS_DDDID_STR *dd, unsigned char *dp);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x2A Read Data By Periodic Identifier
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_2a(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x2C Dynamically Define Data Identifier
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_2c(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * UDS periodic transmission processing (1ms cycle)
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_periodic_job(int tcnt);
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction change marking
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_cfg_mark(unsigned long adr, int sz);
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction commit
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_cfg_commit(void);
+/* ----------------------------------------------------------------------------------------
+ * Configuration transaction abort
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_cfg_abort(void);
+/* ----------------------------------------------------------------------------------------
+ * Prepared ECU information response generation
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_f1_prepare(void);
 /* ----------------------------------------------------------------------------------------
  * UDS 0x2E Write Data By Identifier
  * ---------------------------------------------------------------------------------------- */
@@ -219,6 +454,10 @@ extern int uds_sid_3d(unsigned char *req, int sz, unsigned char *res, int *len);
  * UDS 0x34 Request Download
  * ---------------------------------------------------------------------------------------- */
 extern int uds_sid_34(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * UDS 0x34 Request Download acceptance
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_sid_34_accept(unsigned char *req, unsigned char *res, int *len);
 /* ----------------------------------------------------------------------------------------
  * UDS 0x35 Request Upload
  * ---------------------------------------------------------------------------------------- */
@@ -231,9 +470,41 @@ extern int uds_sid_36(unsigned char *req, int sz, unsigned char *res, int *len);
  * UDS 0x37 Request Transfer Exit
  * ---------------------------------------------------------------------------------------- */
 extern int uds_sid_37(unsigned char *req, int sz, unsigned char *res, int *len);
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer stacking
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_prog_stack(unsigned long adr, unsigned char *dp, int sz);
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer busy check
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_prog_busy(void);
+/* ----------------------------------------------------------------------------------------
+ * Flash programming buffer processing
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_prog_job(void);
+/* ----------------------------------------------------------------------------------------
+ * Download area erase processing
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_erase_job(void);
+/* ----------------------------------------------------------------------------------------
+ * Compressed download decompression output
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_lzss_put(int c);
+/* ----------------------------------------------------------------------------------------
+ * Compressed download decompression
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_lzss_job(unsigned char *dp, int sz);
+/* ----------------------------------------------------------------------------------------
+ * UDS service execution
+ * ---------------------------------------------------------------------------------------- */
+extern int uds_service(unsigned char *msg, int len, unsigned char *res, int *size);
 /* ----------------------------------------------------------------------------------------
  * UDS processing
  * ---------------------------------------------------------------------------------------- */
 extern int uds_job(unsigned char *msg, int len, unsigned char *res);
+/* ----------------------------------------------------------------------------------------
+ * UDS deferred processing (call from main)
+ * ---------------------------------------------------------------------------------------- */
+extern void uds_pending_job(void);
 
 #endif //__CAN_UDS_PROTOCOL__
@@ -0,0 +1,161 @@
+/*
+ * Console command dispatch benchmark (host build, see README.md)
+ *
+ * Runs the switch dispatcher (old.inc) and the table dispatcher (new.inc) on the
+ * same synthetic trace (gen_trace.py). Every line is checked for identical
+ * can_buf / exiosts / reply text, then both are timed over the whole trace.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+// altypes.h defines int8_t / int32_t with other types than the host C library 
+#define int8_t  fw_int8_t
+#define int32_t fw_int32_t
+#include "altypes.h"
+#undef int8_t
+#undef int32_t
+#include "iodefine.h"
+#include "timer.h"
+#include "sci.h"
+#include "r_can_api.h"
+#include "flash_data.h"
+#include "r_Flash_API_RX600.h"
+#include "ecu.h"
+#include "ecu_io.h"
+#include "cantp.h"
+#include "uds.h"
+
+typedef struct {
+    const char *NAME;
+    const char *ARGS;
+    int         MIN;
+    void      (*FUNC)(int, CMD_ARG *);
+} CONSOLE_CMD;
+
+#define RAM_BUFFER_MAX  128
+#define TRACE_LINES     20000
+#define TRACE_PASSES    200
+
+unsigned char comm_ram_buffer[RAM_BUFFER_MAX];
+const char    HEX_CHAR[] = "0123456789ABCDEF";
+CAN_FRAME_BUF can_buf;
+EXT_IO_STATUS exiosts;
+ECU_ROUT_MAP  rout_map;
+int           retport, cmd_reply;
+
+// Reply capture 
+static char reply[4096];
+static int  reply_len;
+
+void SendPC(char *msg)
+{
+    int n = (int)strlen(msg);
+
+    cmd_reply++;
+    if (reply_len + n < (int)sizeof(reply) - 1) {
+        memcpy(&reply[reply_len], msg, n);
+        reply_len += n;
+        reply[reply_len] = 0;
+    }
+}
+
+void logging(char *fmt, ...) { SendPC(fmt); }
+
+// Firmware functions outside the dispatch code 
+int  can_tp_job(int ch, int id, void *p) { return 0; }
+int  can_id_event(int id, int tp) { return 0; }
+void can_send_proc(ECU_CYC_EVE *m) { }
+void ecu_status(char *c) { }
+void ecu_put_message(int id, int s, unsigned char *b) { }
+void send_var(int c) { }
+void wdt_init(void) { }
+void rtc_command_job(char *c, int l) { }
+int  ecu_data_write(void) { return 1; }
+static void old_rtc(char *c) { }
+// Commands not in the trace (linked only) 
+CYCLE_EVENTS  conf_ecu, wait_tup;
+short         ds_conect_active[2];
+int           led_monit_id, led_monit_first, led_monit_slow, led_monit_time;
+int           led_monit_count, led_monit_sample;
+unsigned char led_monit_ch;
+int  add_cyceve_list(int rtr, int id, int dlc, int enb, int rep, int time, int cnt) { return 0; }
+void delete_cyceve_list(int id) { }
+void delete_waiting_list(int id) { }
+int  bootcopy(void) { return 0; }
+int  bootclear(void) { return 0; }
+int  cmt1_stop(void) { return 0; }
+void _di(void) { }
+void _ei(void) { }
+uint8_t R_FlashWrite(uint32_t flash_addr, uint32_t buffer_addr, uint16_t bytes) { return FLASH_SUCCESS; }
+
+#include "new.inc"
+#define rtc_command_job(x) old_rtc(x)
+#include "old.inc"
+#undef rtc_command_job
+
+static char lines[TRACE_LINES][200];
+
+int main(int argc, char **argv)
+{
+    static char     w[200];
+    static char     o[sizeof(reply)];
+    CAN_FRAME_BUF   cb;
+    EXT_IO_STATUS   es;
+    FILE *          f;
+    char            b[256];
+    int             nl = 0, i, r, pass, diff = 0;
+    long            ops;
+    clock_t         t;
+    double          s;
+
+    f = fopen((argc > 1) ? argv[1] : "trace.txt", "r");
+    if (f == NULL) {
+        perror("trace");
+        return 1;
+    }
+    while (nl < TRACE_LINES && fgets(b, sizeof(b), f)) {
+        b[strcspn(b, "\r\n")] = 0;
+        strcpy(lines[nl++], b);
+    }
+    fclose(f);
+    // Same state and reply on every line 
+    for (i = 0; i < nl; i++) {
+        reply_len = 0; reply[0] = 0;
+        strcpy(w, lines[i]);
+        old_command_job(w);
+        memcpy(&cb, &can_buf, sizeof(cb));
+        memcpy(&es, &exiosts, sizeof(es));
+        strcpy(o, reply);
+        reply_len = 0; reply[0] = 0;
+        strcpy(w, lines[i]);
+        command_job(w);
+        if (memcmp(&cb, &can_buf, sizeof(cb)) || memcmp(&es, &exiosts, sizeof(es)) || strcmp(o, reply)) {
+            if (diff < 5) {
+                printf("DIFF line %d [%s]\n old=[%s]\n new=[%s]\n", i, lines[i], o, reply);
+            }
+            diff++;
+        }
+    }
+    printf("lines=%d diffs=%d\n", nl, diff);
+    // Throughput 
+    for (pass = 0; pass < 2; pass++) {
+        t   = clock();
+        ops = 0;
+        for (r = 0; r < TRACE_PASSES; r++) {
+            for (i = 0; i < nl; i++) {
+                strcpy(w, lines[i]);
+                reply_len = 0;
+                if (pass) {
+                    command_job(w);
+                } else {
+                    old_command_job(w);
+                }
+                ops++;
+            }
+        }
+        s = (double)(clock() - t) / CLOCKS_PER_SEC;
+        printf("%-18s : %.2f M commands/s\n", pass ? "table dispatcher" : "switch dispatcher", ops / s / 1e6);
+    }
+    return (diff != 0) ? 1 : 0;
+}
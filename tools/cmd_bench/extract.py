@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# Extracts the console dispatch code of two firmware revisions for bench.c
+#   extract.py <repo> <old rev> <new rev> <out dir>
+#   old.inc : switch dispatcher (command_job and the ecu_*_command parsers), renamed old_*
+#   new.inc : table dispatcher (cmd_table, tokenizer, handlers and the ecu_*_command handlers)
+import re
+import subprocess
+import sys
+
+repo, old_rev, new_rev, out = sys.argv[1:5]
+
+def show(rev, path):
+    s = subprocess.run(['git', '-C', repo, 'show', '%s:%s' % (rev, path)],
+                       check=True, stdout=subprocess.PIPE).stdout
+    return s.decode('latin-1').replace('\r', '')
+
+def fn(src, sig):
+    a = src.index(sig)
+    b = src.index('\n}\n', a) + 3
+    return src[a:b]
+
+def span(src, top, end):
+    return src[src.index(top):src.index(end)]
+
+om, oe = show(old_rev, 'ecu-fw/main.c'), show(old_rev, 'ecu-fw/ecu.c')
+nm, ne = show(new_rev, 'ecu-fw/main.c'), show(new_rev, 'ecu-fw/ecu.c')
+names = ['ecu_get_command', 'ecu_set_command', 'ecu_put_command', 'ecu_input_update']
+
+old = ''.join(fn(oe, 'void %s(char *cmd)' % n) for n in names)
+old += fn(om, 'void command_job(char *cmd)')
+for n in names + ['command_job']:
+    old = re.sub(r'\b%s\b' % n, 'old_' + n, old)
+
+new = ''.join(fn(ne, 'void %s(int' % n) for n in names)
+banner = '/* ----------------------------------------------------------------------------------------\n'
+new += span(nm, 'const signed char cmd_hex_code[', banner + ' * byte_to_ulong')
+new += span(nm, 'void cmd_unit(', banner + ' * comm_bin_byte')
+
+open(out + '/old.inc', 'w').write(old)
+open(out + '/new.inc', 'w').write(new)
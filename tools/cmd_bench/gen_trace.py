@@ -0,0 +1,20 @@
+#!/usr/bin/env python3
+# Console trace for bench.c : 10000 SET / GET / EXD / PUT / MAP lines (fixed seed)
+#   gen_trace.py > trace.txt  (synthetic, run.sh generates it)
+import random
+
+random.seed(1)
+L = []
+for i in range(10000):
+    r = random.random()
+    if r < 0.4:
+        L.append("SET " + " ".join("%03X" % random.randrange(0x800) + "".join("%02X" % random.randrange(256) for _ in range(8)) for _ in range(random.randint(1, 3))))
+    elif r < 0.6:
+        L.append("GET " + " ".join("%03X" % random.randrange(0x800) for _ in range(random.randint(1, 4))))
+    elif r < 0.8:
+        L.append("EXD " + " ".join("%02X%X" % (random.randrange(64), random.randrange(1 << 24)) for _ in range(random.randint(1, 4))))
+    elif r < 0.9:
+        L.append("PUT %03X" % random.randrange(0x800) + "".join("%02X" % random.randrange(256) for _ in range(random.randint(0, 8))))
+    else:
+        L.append("MAP %X %X" % (random.randrange(0x800), random.randrange(16)))
+print("\n".join(L))
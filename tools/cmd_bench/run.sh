@@ -0,0 +1,16 @@
+#!/bin/sh
+# Console command dispatch benchmark (see README.md)
+#   run.sh [table dispatcher revision]   (default: the commit that added cmd_table)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+REPO=$(git -C "$DIR" rev-parse --show-toplevel)
+NEW=${1:-$(git -C "$REPO" log -1 --format=%H --grep='Dispatch console commands from a sorted keyword table')}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+python3 "$DIR/gen_trace.py" > "$OUT/trace.txt"
+python3 "$DIR/extract.py" "$REPO" "$NEW~1" "$NEW" "$OUT"
+git -C "$REPO" archive "$NEW" ecu-fw | tar -x -C "$OUT"
+${CC:-cc} -O2 -w -D__LFY_RX63N__ -I"$OUT" -I"$DIR/host" -I"$OUT/ecu-fw" \
+    "$DIR/bench.c" -o "$OUT/bench"
+"$OUT/bench" "$OUT/trace.txt"
@@ -0,0 +1,183 @@
+/*
+ * External I/O checklist entry benchmark (host build, see README.md)
+ *
+ * Runs extern_io_entry before the compiled checklist (old.inc) and the compiled
+ * operation records (new.inc) on the same random checklist. Every update is checked
+ * for identical can_buf / exiosts / change counters / dirty marks / CAN events,
+ * then the cost per entry of both is timed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+// altypes.h defines int8_t / int32_t with other types than the host C library 
+#define int8_t  fw_int8_t
+#define int32_t fw_int32_t
+#include "altypes.h"
+#undef int8_t
+#undef int32_t
+#include "iodefine.h"
+#include "timer.h"
+#include "ecu.h"
+#include "ecu_io.h"
+
+// Unit selection is read from the DIP switch on the target : use the powertrain 
+#undef  SELECT_ECU_UNIT
+#define SELECT_ECU_UNIT ECU_UNIT_POWERTRAIN
+#ifndef ECU_UNIT_PTBD
+#define ECU_UNIT_PTBD   3
+#endif
+
+#define CHECK_UPDATES   200000  // Random updates compared between old and new 
+#define TIME_PASSES     200000  // Whole checklist passes timed 
+#define BENCH_IDS       12      // CAN-IDs used by the checklist 
+
+// Operation mode send ID tables (ecu_def_config.h), not used by the entries 
+const short CARLA_POWERTRAIN_SEND_ID[] = { 0 };
+const short CARLA_CHASSIS_SEND_ID[]    = { 0 };
+const short CARLA_BODY_SEND_ID[]       = { 0 };
+const short CARLA_PTBD_SEND_ID[]       = { 0 };
+const short VI_POWERTRAIN_SEND_ID[]    = { 0 };
+
+EXTERNUL_IO   ext_list[ECU_EXT_MAX];
+int           ext_list_count;
+CAN_FRAME_BUF can_buf;
+EXT_IO_STATUS exiosts;
+unsigned char exio_chg[EX_IO_MAX];
+int           exio_chg_mark;
+unsigned long exio_dirty[(EX_IO_MAX + 31) / 32];
+unsigned long canid_dirty[CAN_ID_MAX / 32];
+unsigned long canid_dirty_sum[(CAN_ID_MAX / 32 + 31) / 32];
+int           ext_rescan;
+unsigned char ext_nm_ofs[EX_IO_MAX + 1];
+unsigned char ext_nm_slot[ECU_EXT_MAX];
+unsigned char ext_id_ofs[CAN_ID_MAX + 1];
+unsigned char ext_id_slot[ECU_EXT_MAX];
+unsigned char can_to_exio[CAN_ID_MAX];
+unsigned long ext_mode_set[ECU_OPMODE_MAX][(ECU_EXT_MAX + 31) / 32];
+unsigned long ext_mode_clr[ECU_OPMODE_MAX][(ECU_EXT_MAX + 31) / 32];
+EXT_IO_OP     ext_op[ECU_EXT_MAX];
+
+static long events;
+
+int can_id_event(int id, int tp)
+{
+    events++;
+    return tp + 1;
+}
+
+#include "old.inc"
+#include "new.inc"
+
+// State compared after every update 
+typedef struct {
+    CAN_FRAME_BUF   CAN;
+    EXT_IO_STATUS   IO;
+    unsigned char   CHG[EX_IO_MAX];
+    int             MARK;
+    unsigned long   NMD[(EX_IO_MAX + 31) / 32];
+    unsigned long   IDD[CAN_ID_MAX / 32];
+    unsigned long   SUM[(CAN_ID_MAX / 32 + 31) / 32];
+    long            EVT;
+} BENCH_STATE;
+
+static void save(BENCH_STATE *s)
+{
+    s->CAN  = can_buf;
+    s->IO   = exiosts;
+    memcpy(s->CHG, exio_chg, sizeof(exio_chg));
+    s->MARK = exio_chg_mark;
+    memcpy(s->NMD, exio_dirty, sizeof(exio_dirty));
+    memcpy(s->IDD, canid_dirty, sizeof(canid_dirty));
+    memcpy(s->SUM, canid_dirty_sum, sizeof(canid_dirty_sum));
+    s->EVT  = events;
+}
+
+static void load(const BENCH_STATE *s)
+{
+    can_buf = s->CAN;
+    exiosts = s->IO;
+    memcpy(exio_chg, s->CHG, sizeof(exio_chg));
+    exio_chg_mark = s->MARK;
+    memcpy(exio_dirty, s->NMD, sizeof(exio_dirty));
+    memcpy(canid_dirty, s->IDD, sizeof(canid_dirty));
+    memcpy(canid_dirty_sum, s->SUM, sizeof(canid_dirty_sum));
+    events = s->EVT;
+}
+
+int main(void)
+{
+    static const int    width[8] = { 1, 1, 2, 4, 1, 1, 2, 4 };
+    static BENCH_STATE  sa, sb;
+    int                 ids[BENCH_IDS];
+    int                 it, i, r, id, nm, b, md, tp;
+    unsigned long       v;
+    unsigned char       bv;
+    clock_t             t0, t1, t2;
+    double              ns_old, ns_new;
+
+    srand(7);
+    ext_list_count = ECU_EXT_MAX;
+    for (i = 0; i < BENCH_IDS; i++) {
+        ids[i] = rand() % CAN_ID_MAX;
+    }
+    for (i = 0; i < ext_list_count; i++) { // Fields inside the 8 byte frame 
+        md = rand() % 8;
+        ext_list[i].SID             = ids[rand() % BENCH_IDS];
+        ext_list[i].PORT.BIT.MODE   = md;
+        ext_list[i].PORT.BIT.BPOS   = rand() % (9 - width[md]);
+        ext_list[i].PORT.BIT.MSK    = 1 << (rand() % 8);
+        ext_list[i].PORT.BIT.NOM    = rand() % EX_IO_MAX;
+    }
+    extern_io_compile();
+    save(&sa);
+    save(&sb);
+    // Same result after every random update 
+    for (it = 0; it < CHECK_UPDATES; it++) {
+        r   = rand() % 3;
+        id  = ids[rand() % BENCH_IDS];
+        nm  = rand() % EX_IO_MAX;
+        v   = (unsigned long)rand();
+        b   = rand() % 8;
+        bv  = (unsigned char)rand();
+        for (md = 0; md < 2; md++) {
+            load(md ? &sb : &sa);
+            if (r == 0) {
+                can_buf.ID[id].BYTE[b] = bv;
+            } else if (r == 1) {
+                exiosts.DATA[nm].LONG = v;
+            }
+            for (i = 0, tp = 0; i < ext_list_count; i++) {
+                tp = md ? extern_io_entry(i, tp) : old_extern_io_entry(i, tp);
+            }
+            save(md ? &sb : &sa);
+        }
+        if (memcmp(&sa, &sb, sizeof(sa)) != 0) {
+            printf("diverged at update %d\n", it);
+            return 1;
+        }
+    }
+    printf("updates=%d identical events=%ld\n", CHECK_UPDATES, sa.EVT);
+    // Cost per entry, some values changed between the passes 
+    t0 = clock();
+    for (it = 0, tp = 0; it < TIME_PASSES; it++) {
+        for (i = 0; i < ext_list_count; i++) {
+            tp = old_extern_io_entry(i, tp);
+        }
+        exiosts.DATA[it % EX_IO_MAX].LONG ^= (unsigned long)it;
+        can_buf.ID[ids[it % BENCH_IDS]].BYTE[it & 7] ^= 1;
+    }
+    t1 = clock();
+    for (it = 0, tp = 0; it < TIME_PASSES; it++) {
+        for (i = 0; i < ext_list_count; i++) {
+            tp = extern_io_entry(i, tp);
+        }
+        exiosts.DATA[it % EX_IO_MAX].LONG ^= (unsigned long)it;
+        can_buf.ID[ids[it % BENCH_IDS]].BYTE[it & 7] ^= 1;
+    }
+    t2 = clock();
+    ns_old = (double)(t1 - t0) * 1e9 / CLOCKS_PER_SEC / ((double)TIME_PASSES * ext_list_count);
+    ns_new = (double)(t2 - t1) * 1e9 / CLOCKS_PER_SEC / ((double)TIME_PASSES * ext_list_count);
+    printf("old %.1f ns/entry  new %.1f ns/entry  (%.1fx)\n", ns_old, ns_new, ns_old / ns_new);
+    return 0;
+}
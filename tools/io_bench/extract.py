@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+# Extracts the checklist entry processing of two firmware revisions for bench.c
+#   extract.py <repo> <old rev> <new rev> <out dir>
+#   old.inc : extern_io_entry with port_input_ex / port_output_ex, renamed old_*
+#   new.inc : extern_io_compile, extern_io_index, extern_io_set and extern_io_entry
+import re
+import subprocess
+import sys
+
+repo, old_rev, new_rev, out = sys.argv[1:5]
+
+def show(rev, path):
+    s = subprocess.run(['git', '-C', repo, 'show', '%s:%s' % (rev, path)],
+                       check=True, stdout=subprocess.PIPE).stdout
+    return s.decode('latin-1').replace('\r', '')
+
+def fn(src, sig):
+    # Definition only (skips the prototypes at the top of the file)
+    a = re.search(r'^%s[^;\n]*\n\{' % re.escape(sig), src, re.M).start()
+    b = src.index('\n}\n', a) + 3
+    return src[a:b]
+
+oe, ne = show(old_rev, 'ecu-fw/ecu.c'), show(new_rev, 'ecu-fw/ecu.c')
+
+names = ['port_input_ex', 'port_output_ex', 'extern_io_entry']
+old = fn(oe, 'int port_input_ex(') + fn(oe, 'void port_output_ex(') + fn(oe, 'int extern_io_entry(')
+for n in names:
+    old = re.sub(r'\b%s\b' % n, 'old_' + n, old)
+
+new = ''.join(fn(ne, s) for s in [
+    'void extern_io_compile(', 'void extern_io_index(', 'void extern_io_set(', 'int extern_io_entry('])
+
+open(out + '/old.inc', 'w').write(old)
+open(out + '/new.inc', 'w').write(new)
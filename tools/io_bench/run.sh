@@ -0,0 +1,16 @@
+#!/bin/sh
+# External I/O checklist entry benchmark (see README.md)
+#   run.sh [revision]   (default: HEAD, compared with the version before the compiled checklist)
+set -e
+DIR=$(cd "$(dirname "$0")" && pwd)
+REPO=$(git -C "$DIR" rev-parse --show-toplevel)
+NEW=${1:-HEAD}
+OLD=$(git -C "$REPO" log -1 --format=%H --grep='Compile the I/O checklist into operation records')~1
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+python3 "$DIR/extract.py" "$REPO" "$OLD" "$NEW" "$OUT"
+git -C "$REPO" archive "$NEW" ecu-fw | tar -x -C "$OUT"
+${CC:-cc} -O2 -w -I"$OUT" -I"$DIR/host" -I"$OUT/ecu-fw" \
+    "$DIR/bench.c" -o "$OUT/bench"
+"$OUT/bench"